@@ -47,12 +47,15 @@ class FDeformation : public FGlobalShader
 		OutEnvironment.SetDefine(TEXT("THREADS_X"), NUM_THREADS_Deformation_X);
 		OutEnvironment.SetDefine(TEXT("THREADS_Y"), NUM_THREADS_Deformation_Y);
 		OutEnvironment.SetDefine(TEXT("THREADS_Z"), NUM_THREADS_Deformation_Z);
+		OutEnvironment.SetDefine(TEXT("DELTA_BRICK_SIZE"), voxelDeltaBrickSize);
 	}
 };
 
 IMPLEMENT_GLOBAL_SHADER(FDeformation, "/ComputeDispatchersShaders/Deformation.usf", "Deformation", SF_Compute);
 
-void AddDeformationPass(FRDGBuilder& GraphBuilder, const FVoxelComputeUpdateNodeData& nodeData, FVoxelComputeUpdateData& updateData) {
+void AddDeformationPass(FRDGBuilder& GraphBuilder, const FVoxelComputeUpdateNodeData& nodeData, const FVoxelComputeUpdateData& updateData) {
+	const VoxelRenderResources* resources = VoxelRenderResourceTable::Get().Resolve(nodeData.renderResources);
+	if (!resources) return;
 
 	FShaderResourceViewRHIRef baseIsoValues = updateData.isoBuffer.Get()->bufferSRV;
 	FDeformation::FParameters* PassParams = GraphBuilder.AllocParameters<FDeformation::FParameters>();
@@ -66,11 +69,11 @@ void AddDeformationPass(FRDGBuilder& GraphBuilder, const FVoxelComputeUpdateNode
 
 	PassParams->isoValues = updateData.isoBuffer->bufferSRV;
 	PassParams->isoDeltaValues = updateData.deltaIsoBuffer->bufferSRV;
-	PassParams->isoCombinedValues = nodeData.isoBuffer->bufferUAV;
+	PassParams->isoCombinedValues = resources->isoBuffer->bufferUAV;
 
 	PassParams->typeValues = updateData.typeBuffer->bufferSRV;
 	PassParams->typeDeltaValues = updateData.deltaTypeBuffer->bufferSRV;
-	PassParams->typeCombinedValues = nodeData.typeBuffer->bufferUAV;
+	PassParams->typeCombinedValues = resources->typeBuffer->bufferUAV;
 
 	PassParams->voxelsPerAxis = voxelsPerAxis;
 	PassParams->highResVoxelsPerAxis = updateData.highResVoxelsPerAxis;
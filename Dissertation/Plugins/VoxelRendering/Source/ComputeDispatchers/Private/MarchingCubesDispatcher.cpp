@@ -61,23 +61,26 @@ class FMarchingCubes : public FGlobalShader
 
 IMPLEMENT_GLOBAL_SHADER(FMarchingCubes, "/ComputeDispatchersShaders/MarchingCubes.usf", "MarchingCubes", SF_Compute);
 
-void AddOctreeMarchingPass(FRDGBuilder& GraphBuilder, const FVoxelComputeUpdateNodeData& nodeData, FMarchingCubesDispatchParams& Params) {
+void AddOctreeMarchingPass(FRDGBuilder& GraphBuilder, const FVoxelComputeUpdateNodeData& nodeData, const FMarchingCubesDispatchParams& Params) {
+	const VoxelRenderResources* resources = VoxelRenderResourceTable::Get().Resolve(nodeData.renderResources);
+	if (!resources) return;
+
 	FMarchingCubes::FParameters* PassParams = GraphBuilder.AllocParameters<FMarchingCubes::FParameters>();
 	int voxelsPerAxis = Params.Input.updateData.voxelsPerAxis;
 
 	PassParams->leafPosition = nodeData.boundsCenter;
 	PassParams->leafDepth = nodeData.leafDepth;
 	PassParams->nodeIndex = 0; // Shader supports single vertex buffer for mesh, however as each LOD has its own vertex factory we can ignore this.
-	PassParams->isoValues = nodeData.isoBuffer->bufferSRV; 
+	PassParams->isoValues = resources->isoBuffer->bufferSRV;
 	PassParams->marchLookUp = Params.Input.updateData.marchLookUpResource->marchLookUpBufferSRV;
-	PassParams->outInfo = nodeData.vertexFactory->GetVertexUAV();
-	PassParams->outNormalInfo = nodeData.vertexFactory->GetVertexNormalsUAV();
+	PassParams->outInfo = resources->vertexFactory->GetVertexUAV();
+	PassParams->outNormalInfo = resources->vertexFactory->GetVertexNormalsUAV();
 	PassParams->voxelsPerAxis = voxelsPerAxis;
 	PassParams->baseDepthScale = Params.Input.updateData.scale;
 	PassParams->isoLevel = Params.Input.updateData.isoLevel;
 
-	PassParams->typeValues = nodeData.typeBuffer->bufferSRV;
-	PassParams->outTypeInfo = nodeData.vertexFactory->GetVertexTypeUAV();
+	PassParams->typeValues = resources->typeBuffer->bufferSRV;
+	PassParams->outTypeInfo = resources->vertexFactory->GetVertexTypeUAV();
 
 	const auto ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
 	const TShaderMapRef<FMarchingCubes> ComputeShader(ShaderMap);
@@ -88,7 +91,7 @@ void AddOctreeMarchingPass(FRDGBuilder& GraphBuilder, const FVoxelComputeUpdateN
 			FComputeShaderUtils::Dispatch(RHICmdList, ComputeShader, *PassParams, GroupCount); });
 }
 
-void FMarchingCubesInterface::DispatchRenderThread(FRHICommandListImmediate& RHICmdList, FMarchingCubesDispatchParams Params, TFunction<void(FMarchingCubesOutput OutputVal)> AsyncCallback) {
+void FMarchingCubesInterface::DispatchRenderThread(FRHICommandListImmediate& RHICmdList, const FMarchingCubesDispatchParams& Params, TFunction<void(FMarchingCubesOutput OutputVal)> AsyncCallback) {
 	FRDGBuilder GraphBuilder(RHICmdList);
 	{
 		SCOPE_CYCLE_COUNTER(STAT_MarchingCubes_Execute);
@@ -110,22 +113,28 @@ void FMarchingCubesInterface::DispatchRenderThread(FRHICommandListImmediate& RHI
 
 
 		if (bIsShaderValid && bIsDefShaderValid && bIsTVMCShaderValid) {
-			for (const FVoxelComputeUpdateNodeData& nodeData : Params.Input.updateData.nodeData)
-				AddDeformationPass(GraphBuilder, nodeData, Params.Input.updateData);
+			for (const FVoxelComputeUpdateNodeData& nodeData : Params.Input.updateData.nodeData) {
+				if (nodeData.applyDeformation)
+					AddDeformationPass(GraphBuilder, nodeData, Params.Input.updateData);
+			}
 
-			for (const FVoxelComputeUpdateNodeData& nodeData : Params.Input.updateData.nodeData)
-				AddOctreeMarchingPass(GraphBuilder, nodeData, Params);
+			for (const FVoxelComputeUpdateNodeData& nodeData : Params.Input.updateData.nodeData) {
+				if (nodeData.generateMesh)
+					AddOctreeMarchingPass(GraphBuilder, nodeData, Params);
+			}
 
 			for (const FVoxelTransVoxelNodeData& nodeData : Params.Input.updateData.transVoxelNodeData)
 				AddTransvoxelMarchingCubesPass(GraphBuilder, nodeData, Params.Input.updateData);
 
-			auto RunnerFunc = [AsyncCallback](auto&& RunnerFunc) ->
-				void {
-					FMarchingCubesOutput OutVal;
-					AsyncTask(ENamedThreads::GameThread, [AsyncCallback, OutVal]() {AsyncCallback(OutVal); });
-				};
-			AsyncTask(ENamedThreads::ActualRenderingThread, [RunnerFunc]() {
-				RunnerFunc(RunnerFunc); });
+			if (AsyncCallback) {
+				auto RunnerFunc = [AsyncCallback](auto&& RunnerFunc) ->
+					void {
+						FMarchingCubesOutput OutVal;
+						AsyncTask(ENamedThreads::GameThread, [AsyncCallback, OutVal]() {AsyncCallback(OutVal); });
+					};
+				AsyncTask(ENamedThreads::ActualRenderingThread, [RunnerFunc]() {
+					RunnerFunc(RunnerFunc); });
+			}
 		}
 		else {}
 	}
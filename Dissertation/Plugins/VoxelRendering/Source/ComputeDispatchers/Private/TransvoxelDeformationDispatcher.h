@@ -47,12 +47,15 @@ class FTransvoxelDeformation : public FGlobalShader
 		OutEnvironment.SetDefine(TEXT("THREADS_X"), NUM_THREADS_TransvoxelDeformation_X);
 		OutEnvironment.SetDefine(TEXT("THREADS_Y"), NUM_THREADS_TransvoxelDeformation_Y);
 		OutEnvironment.SetDefine(TEXT("THREADS_Z"), NUM_THREADS_TransvoxelDeformation_Z);
+		OutEnvironment.SetDefine(TEXT("DELTA_BRICK_SIZE"), voxelDeltaBrickSize);
 	}
 };
 
 IMPLEMENT_GLOBAL_SHADER(FTransvoxelDeformation, "/ComputeDispatchersShaders/TransvoxelDeformation.usf", "TransvoxelDeformation", SF_Compute);
 
 void AddTransvoxelDeformationPass(FRDGBuilder& GraphBuilder, FVoxelComputeUpdateNodeData& nodeData, FVoxelComputeUpdateData& updateData) {
+	const VoxelRenderResources* resources = VoxelRenderResourceTable::Get().Resolve(nodeData.renderResources);
+	if (!resources) return;
 
 	FShaderResourceViewRHIRef baseIsoValues = updateData.isoBuffer.Get()->bufferSRV;
 	FTransvoxelDeformation::FParameters* PassParams = GraphBuilder.AllocParameters<FTransvoxelDeformation::FParameters>();
@@ -66,11 +69,11 @@ void AddTransvoxelDeformationPass(FRDGBuilder& GraphBuilder, FVoxelComputeUpdate
 
 	PassParams->isoValues = updateData.isoBuffer->bufferSRV;
 	PassParams->isoDeltaValues = updateData.deltaIsoBuffer->bufferSRV;
-	PassParams->isoCombinedValues = nodeData.isoBuffer->bufferUAV;
+	PassParams->isoCombinedValues = resources->isoBuffer->bufferUAV;
 
 	PassParams->typeValues = updateData.typeBuffer->bufferSRV;
 	PassParams->typeDeltaValues = updateData.deltaTypeBuffer->bufferSRV;
-	PassParams->typeCombinedValues = nodeData.typeBuffer->bufferUAV;
+	PassParams->typeCombinedValues = resources->typeBuffer->bufferUAV;
 
 	PassParams->voxelsPerAxis = voxelsPerAxis;
 	PassParams->highResVoxelsPerAxis = updateData.highResVoxelsPerAxis;
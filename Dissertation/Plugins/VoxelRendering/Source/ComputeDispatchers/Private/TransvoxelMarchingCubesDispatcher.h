@@ -67,7 +67,7 @@ class FTransvoxelMC : public FGlobalShader
 
 IMPLEMENT_GLOBAL_SHADER(FTransvoxelMC, "/ComputeDispatchersShaders/TransvoxelMarchingCubes.usf", "TransvoxelMarchingCubes", SF_Compute);
 
-void AddTransvoxelMarchingCubesPass(FRDGBuilder& GraphBuilder, const FVoxelTransVoxelNodeData& transVoxelNodeData, FVoxelComputeUpdateData& updateData) {
+void AddTransvoxelMarchingCubesPass(FRDGBuilder& GraphBuilder, const FVoxelTransVoxelNodeData& transVoxelNodeData, const FVoxelComputeUpdateData& updateData) {
 	
 	FTransvoxelMC::FParameters* PassParams = GraphBuilder.AllocParameters<FTransvoxelMC::FParameters>();
 	const FVoxelComputeUpdateNodeData& nodeData = transVoxelNodeData.lowResolutionData;
@@ -75,29 +75,40 @@ void AddTransvoxelMarchingCubesPass(FRDGBuilder& GraphBuilder, const FVoxelTrans
 	int voxelsPerAxis = updateData.voxelsPerAxis;
 	bool useZeroData = transVoxelNodeData.zeroNode;
 
+	// Zero data cells only write the owning node, the adjacent handles are never built for them
+	const VoxelRenderResourceTable& resourceTable = VoxelRenderResourceTable::Get();
+	const VoxelRenderResources* resources = resourceTable.Resolve(nodeData.renderResources);
+	if (!resources) return;
+
+	const VoxelRenderResources* adjResources[4] = {};
+	for (int i = 0; i < 4 && !useZeroData; i++) {
+		adjResources[i] = resourceTable.Resolve(transVoxelNodeData.highResolutionData[i].renderResources);
+		if (!adjResources[i]) return;
+	}
+
 	PassParams->leafPosition = nodeData.boundsCenter;
 	PassParams->leafDepth = nodeData.leafDepth;
 	PassParams->nodeIndex = 0; // Shader supports single vertex buffer for mesh, however as each LOD has its own vertex factory we can ignore this.
 
-	PassParams->isoValues = useZeroData ? updateData.zeroIsoBuffer->bufferSRV : nodeData.isoBuffer->bufferSRV;
-	PassParams->typeValues = useZeroData ? updateData.zeroTypeBuffer->bufferSRV : nodeData.typeBuffer->bufferSRV;
+	PassParams->isoValues = useZeroData ? updateData.zeroIsoBuffer->bufferSRV : resources->isoBuffer->bufferSRV;
+	PassParams->typeValues = useZeroData ? updateData.zeroTypeBuffer->bufferSRV : resources->typeBuffer->bufferSRV;
 
-	PassParams->isoAdjValuesA = useZeroData ? updateData.zeroIsoBuffer->bufferSRV : transVoxelNodeData.highResolutionData[0].isoBuffer->bufferSRV;
-	PassParams->isoAdjValuesB = useZeroData ? updateData.zeroIsoBuffer->bufferSRV : transVoxelNodeData.highResolutionData[1].isoBuffer->bufferSRV;
-	PassParams->isoAdjValuesC = useZeroData ? updateData.zeroIsoBuffer->bufferSRV : transVoxelNodeData.highResolutionData[2].isoBuffer->bufferSRV;
-	PassParams->isoAdjValuesD = useZeroData ? updateData.zeroIsoBuffer->bufferSRV : transVoxelNodeData.highResolutionData[3].isoBuffer->bufferSRV;
+	PassParams->isoAdjValuesA = useZeroData ? updateData.zeroIsoBuffer->bufferSRV : adjResources[0]->isoBuffer->bufferSRV;
+	PassParams->isoAdjValuesB = useZeroData ? updateData.zeroIsoBuffer->bufferSRV : adjResources[1]->isoBuffer->bufferSRV;
+	PassParams->isoAdjValuesC = useZeroData ? updateData.zeroIsoBuffer->bufferSRV : adjResources[2]->isoBuffer->bufferSRV;
+	PassParams->isoAdjValuesD = useZeroData ? updateData.zeroIsoBuffer->bufferSRV : adjResources[3]->isoBuffer->bufferSRV;
 
-	PassParams->typeAdjValuesA = useZeroData ? updateData.zeroTypeBuffer->bufferSRV : transVoxelNodeData.highResolutionData[0].typeBuffer->bufferSRV;
-	PassParams->typeAdjValuesB = useZeroData ? updateData.zeroTypeBuffer->bufferSRV : transVoxelNodeData.highResolutionData[1].typeBuffer->bufferSRV;
-	PassParams->typeAdjValuesC = useZeroData ? updateData.zeroTypeBuffer->bufferSRV : transVoxelNodeData.highResolutionData[2].typeBuffer->bufferSRV;
-	PassParams->typeAdjValuesD = useZeroData ? updateData.zeroTypeBuffer->bufferSRV : transVoxelNodeData.highResolutionData[3].typeBuffer->bufferSRV;
+	PassParams->typeAdjValuesA = useZeroData ? updateData.zeroTypeBuffer->bufferSRV : adjResources[0]->typeBuffer->bufferSRV;
+	PassParams->typeAdjValuesB = useZeroData ? updateData.zeroTypeBuffer->bufferSRV : adjResources[1]->typeBuffer->bufferSRV;
+	PassParams->typeAdjValuesC = useZeroData ? updateData.zeroTypeBuffer->bufferSRV : adjResources[2]->typeBuffer->bufferSRV;
+	PassParams->typeAdjValuesD = useZeroData ? updateData.zeroTypeBuffer->bufferSRV : adjResources[3]->typeBuffer->bufferSRV;
 
 	PassParams->transitionLookup = updateData.marchLookUpResource->transVoxelLookUpBufferSRV;
 	PassParams->flatTransitionVertexData = updateData.marchLookUpResource->transVoxelVertexLookUpBufferSRV;
 
-	PassParams->outVertexInfo = nodeData.vertexFactory->GetVertexUAV();
-	PassParams->outNormalInfo = nodeData.vertexFactory->GetVertexNormalsUAV();
-	PassParams->outTypeInfo = nodeData.vertexFactory->GetVertexTypeUAV();
+	PassParams->outVertexInfo = resources->vertexFactory->GetVertexUAV();
+	PassParams->outNormalInfo = resources->vertexFactory->GetVertexNormalsUAV();
+	PassParams->outTypeInfo = resources->vertexFactory->GetVertexTypeUAV();
 
 	PassParams->voxelsPerAxis = voxelsPerAxis;
 	PassParams->baseDepthScale = updateData.scale;
@@ -39,8 +39,9 @@ struct COMPUTEDISPATCHERS_API FMarchingCubesDispatchParams
 
 class COMPUTEDISPATCHERS_API FMarchingCubesInterface {
 public:
+	// AsyncCallback may be unset when the caller does not need to hear back
 	static void DispatchRenderThread(FRHICommandListImmediate& RHICmdList,
-		FMarchingCubesDispatchParams Params,TFunction<void(FMarchingCubesOutput OutputVal)> AsyncCallback);
+		const FMarchingCubesDispatchParams& Params,TFunction<void(FMarchingCubesOutput OutputVal)> AsyncCallback);
 
 	static void DispatchGameThread(FMarchingCubesDispatchParams Params,TFunction<void(FMarchingCubesOutput OutputVal)> AsyncCallback)
 	{
@@ -56,6 +57,14 @@ public:
 		else
 			DispatchGameThread(Params, AsyncCallback);
 	}
+
+	// The render command only holds a reference, so the caller can refill the params once it is the last owner
+	static void DispatchShared(TSharedPtr<const FMarchingCubesDispatchParams> Params)
+	{
+		ENQUEUE_RENDER_COMMAND(SceneDrawCompletion)(
+			[Params](FRHICommandListImmediate& RHICmdList)
+				{ DispatchRenderThread(RHICmdList, *Params, nullptr);});
+	}
 };
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnMarchingCubesLibrary_AsyncExecutionCompleted, const FMarchingCubesOutput, Value);
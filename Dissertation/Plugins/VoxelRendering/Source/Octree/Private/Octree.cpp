@@ -1,20 +1,96 @@
 #include "Octree.h"
 #include "OctreeModule.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "VoxelBrushKernel.h"
+
+DECLARE_STATS_GROUP(TEXT("Octree"), STATGROUP_Octree, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Octree Construct"), STAT_Octree_Construct, STATGROUP_Octree);
+DECLARE_CYCLE_STAT(TEXT("Octree Destruct"), STAT_Octree_Destruct, STATGROUP_Octree);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Octree Nodes"), STAT_Octree_Nodes, STATGROUP_Octree);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Topology Snapshots"), STAT_Octree_TopologySnapshots, STATGROUP_Octree);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Topology Pages Copied"), STAT_Octree_TopologyPagesCopied, STATGROUP_Octree);
+DECLARE_CYCLE_STAT(TEXT("Edit Batch"), STAT_Octree_EditBatch, STATGROUP_Octree);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Edit Clusters"), STAT_Octree_EditClusters, STATGROUP_Octree);
+
+DECLARE_STATS_GROUP(TEXT("VoxelResidency"), STATGROUP_VoxelResidency, STATCAT_Advanced);
+DECLARE_MEMORY_STAT(TEXT("Resident Bytes"), STAT_VoxelResidency_Resident, STATGROUP_VoxelResidency);
+DECLARE_MEMORY_STAT(TEXT("Pooled Bytes"), STAT_VoxelResidency_Pooled, STATGROUP_VoxelResidency);
+DECLARE_MEMORY_STAT(TEXT("Resident Bytes Depth 0"), STAT_VoxelResidency_Depth0, STATGROUP_VoxelResidency);
+DECLARE_MEMORY_STAT(TEXT("Resident Bytes Depth 1"), STAT_VoxelResidency_Depth1, STATGROUP_VoxelResidency);
+DECLARE_MEMORY_STAT(TEXT("Resident Bytes Depth 2"), STAT_VoxelResidency_Depth2, STATGROUP_VoxelResidency);
+DECLARE_MEMORY_STAT(TEXT("Resident Bytes Depth 3"), STAT_VoxelResidency_Depth3, STATGROUP_VoxelResidency);
+DECLARE_MEMORY_STAT(TEXT("Resident Bytes Depth 4"), STAT_VoxelResidency_Depth4, STATGROUP_VoxelResidency);
+DECLARE_MEMORY_STAT(TEXT("Resident Bytes Depth 5"), STAT_VoxelResidency_Depth5, STATGROUP_VoxelResidency);
+DECLARE_MEMORY_STAT(TEXT("Resident Bytes Depth 6"), STAT_VoxelResidency_Depth6, STATGROUP_VoxelResidency);
+DECLARE_MEMORY_STAT(TEXT("Resident Bytes Depth 7+"), STAT_VoxelResidency_Depth7, STATGROUP_VoxelResidency);
+
+static TAutoConsoleVariable<int32> CVarOctreeBuildWorkers(
+    TEXT("voxel.OctreeBuildWorkers"), 0,
+    TEXT("Number of workers used to build octree subtrees, 0 uses every task graph worker."));
+
+static TAutoConsoleVariable<int32> CVarParallelEditSamples(
+    TEXT("voxel.ParallelEditSamples"), 64 * 64 * 64,
+    TEXT("Edit clusters covering at least this many samples are applied across z slices in parallel."));
+
+static TAutoConsoleVariable<int32> CVarSmoothKernelRadius(
+    TEXT("voxel.SmoothKernelRadius"), 2,
+    TEXT("Taps either side of the centre in each 1D pass of the smoothing filter, 1 to 8."));
+
+static TAutoConsoleVariable<int32> CVarDetectDetachedChunks(
+    TEXT("voxel.DetectDetachedChunks"), 1,
+    TEXT("Track the connectivity of solid voxels across edits and report pieces cut off from the body."));
+
+// Density change per sample across the plane a flatten brush pulls towards
+static constexpr float FlattenSlope = 0.25f;
+
+static int32 GetSmoothKernelRadius() {
+    return FMath::Clamp(CVarSmoothKernelRadius.GetValueOnAnyThread(), 1, 8);
+}
 
-Octree::Octree(AActor* inParent, float inIsoLevel, float inScale, int inVoxelsPerAxis, int inDepth, int inBufferSizePerAxis, const TArray<float>& isoBuffer, const TArray<uint32>& typeBuffer) :
-    parent(inParent), maxDepth(inDepth), bIsoValuesDirty(false), bTypeValuesDirty(false), scale(inScale), isoLevel(inIsoLevel),voxelsPerAxisMaxRes(inBufferSizePerAxis), voxelsPerAxis(inVoxelsPerAxis) { 
-    float scaleHalfed = inScale / 2;
-    AABB bounds = { FVector3f(-scaleHalfed), FVector3f(scaleHalfed) };
+// Normalised Gaussian taps with sigma half the kernel radius
+static void MakeSmoothWeights(TArray<float, TInlineAllocator<17>>& outWeights) {
+    int32 radius = GetSmoothKernelRadius();
+    float sigma = FMath::Max(radius * 0.5f, 0.5f);
+    float sum = 0.0f;
+    outWeights.SetNumUninitialized(radius * 2 + 1);
+    for (int32 tap = -radius; tap <= radius; tap++) {
+        outWeights[tap + radius] = FMath::Exp(-(tap * tap) / (2.0f * sigma * sigma));
+        sum += outWeights[tap + radius];
+    }
+    for (float& weight : outWeights)
+        weight /= sum;
+}
+
+// Depth below which construction is fanned out, one task per surface subtree
+static constexpr int ParallelBuildDepth = 2;
 
-    root = new OctreeNode(inParent, nullptr, bounds, isoCount, voxelsPerAxis, 0, inDepth, true);
-    root->AssignChildNeighboursAsRoot();
+static constexpr uint64 DefaultResidencyBudgetBytes = 512ull * 1024 * 1024;
+static constexpr uint32 DefaultResidencyGraceFrames = 120;
+
+// The original brush only painted on the additive side, so paintOnly without additive changed nothing and stays a no-op
+static bool GetDeformationOp(bool additive, bool paintOnly, EVoxelEditOp& outOp) {
+    if (paintOnly && !additive) return false;
+    outOp = paintOnly ? EVoxelEditOp::Paint : (additive ? EVoxelEditOp::Add : EVoxelEditOp::Subtract);
+    return true;
+}
+
+Octree::Octree(AActor* inParent, float inIsoLevel, float inScale, int inVoxelsPerAxis, int inDepth, int inBufferSizePerAxis, const TArray<float>& isoBuffer, const TArray<uint32>& typeBuffer) :
+    parent(inParent), maxDepth(inDepth), visibilityEpoch(1), editVersion(0), residencyFrame(0), residencyGraceFrames(DefaultResidencyGraceFrames), residencyBudgetBytes(DefaultResidencyBudgetBytes),
+    bIsoValuesDirty(false), bTypeValuesDirty(false), scale(inScale), isoLevel(inIsoLevel),voxelsPerAxisMaxRes(inBufferSizePerAxis), voxelsPerAxis(inVoxelsPerAxis) { 
+    SCOPE_CYCLE_COUNTER(STAT_Octree_Construct);
+    double constructStart = FPlatformTime::Seconds();
 
     int bufferSize = (inBufferSizePerAxis + 1) * (inBufferSizePerAxis + 1) * (inBufferSizePerAxis + 1);
     int isoBufferCount = isoCount;
+    // The delta buffers are brick major and padded to whole bricks, the CPU side arrays stay flat
+    deltaUploader = MakeUnique<VoxelDeltaUploader>(isoValuesPerAxisMaxRes);
+    int deltaBufferSize = deltaUploader->GetPaddedCount();
+
     isoUniformBuffer = MakeShareable(new FIsoUniformBuffer(bufferSize));
-    deltaIsoBuffer = MakeShareable(new FIsoDynamicBuffer(bufferSize));
+    deltaIsoBuffer = MakeShareable(new FIsoDynamicBuffer(deltaBufferSize));
     typeUniformBuffer = MakeShareable(new FTypeUniformBuffer(bufferSize));
-    deltaTypeBuffer = MakeShareable(new FTypeDynamicBuffer(bufferSize));
+    deltaTypeBuffer = MakeShareable(new FTypeDynamicBuffer(deltaBufferSize));
     marchingCubeLookUpTable = MakeShareable(new FMarchingCubesLookUpResource());
 
     zeroIsoBuffer = MakeShareable(new FIsoDynamicBuffer(isoCount));
@@ -25,23 +101,51 @@ Octree::Octree(AActor* inParent, float inIsoLevel, float inScale, int inVoxelsPe
 
     initIsoArray.SetNum(bufferSize);
     FMemory::Memcpy(initIsoArray.GetData(), isoBuffer.GetData(), bufferSize * sizeof(float));
+    initTypeArray.SetNum(bufferSize);
+    FMemory::Memcpy(initTypeArray.GetData(), typeBuffer.GetData(), bufferSize * sizeof(uint32));
+
+    nodeVertexBufferSize = ((voxelsPerAxis * voxelsPerAxis * voxelsPerAxis) * 15) + (3 * (voxelsPerAxis * voxelsPerAxis * 36));
+    resourcePool = MakeUnique<VoxelResourcePool>(isoCount, nodeVertexBufferSize);
+    residentBytesPerDepth.Init(0, inDepth + 1);
+
+    // Only nodes whose density range crosses the iso level are refined, homogeneous regions stay as coarse leaves.
+    // Node GPU resources are not created here, UpdateResidency acquires them once a node is first visible.
+    int32 buildWorkers = BuildNodes();
+    INC_DWORD_STAT_BY(STAT_Octree_Nodes, nodeKeys.Num());
+    if (CVarDetectDetachedChunks.GetValueOnGameThread() != 0)
+        LaunchConnectivityBuild();
 
     ENQUEUE_RENDER_COMMAND(InitVoxelResources)(
-        [this, bufferSize, isoBuffer, typeBuffer, isoBufferCount](FRHICommandListImmediate& RHICmdList)
+        [this, bufferSize, deltaBufferSize, isoBuffer, typeBuffer, isoBufferCount](FRHICommandListImmediate& RHICmdList)
         {
             isoUniformBuffer->Initialize(isoBuffer, bufferSize);
-            deltaIsoBuffer->Initialize(bufferSize);
+            deltaIsoBuffer->Initialize(deltaBufferSize);
             typeUniformBuffer->Initialize(typeBuffer, bufferSize);
-            deltaTypeBuffer->Initialize(bufferSize);
+            deltaTypeBuffer->Initialize(deltaBufferSize);
             marchingCubeLookUpTable->Initialize();
             zeroIsoBuffer->Initialize(isoBufferCount);
             zeroTypeBuffer->Initialize(isoBufferCount);
         });
+
+    UE_LOG(LogTemp, Verbose, TEXT("Octree depth %d: built %d nodes in %.3f ms on %d workers"),
+        inDepth, nodeKeys.Num(), (FPlatformTime::Seconds() - constructStart) * 1000.0, buildWorkers);
 }
 
 Octree::~Octree() {
-	Release();
+    SCOPE_CYCLE_COUNTER(STAT_Octree_Destruct);
+    double destructStart = FPlatformTime::Seconds();
+    int32 nodeCount = nodeKeys.Num();
+    CancelConnectivityBuild();
+
+    // One batched release for the whole tree and a single flush, rather than a flush per node
+    Release();
     FlushRenderingCommands();
+    nodes.Empty();
+    resourcePool.Reset();
+    deltaUploader.Reset();
+    connectivity.Reset();
+    DEC_DWORD_STAT_BY(STAT_Octree_Nodes, nodeCount);
+
     isoUniformBuffer.Reset();
     typeUniformBuffer.Reset();
     deltaIsoBuffer.Reset();
@@ -49,14 +153,24 @@ Octree::~Octree() {
     marchingCubeLookUpTable.Reset();
     deltaIsoArray.Reset();
     deltaTypeArray.Reset();
+    initTypeArray.Reset();
 
     zeroIsoBuffer.Reset();
     zeroTypeBuffer.Reset();
     initIsoArray.Reset();
+
+    UE_LOG(LogTemp, Verbose, TEXT("Octree depth %d: destroyed %d nodes in %.3f ms"), maxDepth, nodeCount, (FPlatformTime::Seconds() - destructStart) * 1000.0);
 }
 
 void Octree::Release() {
-    ENQUEUE_RENDER_COMMAND(ReleaseIsoBufferCmd)(
+    for (int32 i = residentNodes.Num() - 1; i >= 0; i--)
+        EvictResidentNode(i);
+
+    // Node resource sets go back to the resource table in one batch, ahead of the tree wide buffers
+    DEC_MEMORY_STAT_BY(STAT_VoxelResidency_Pooled, resourcePool->GetPooledBytes());
+    resourcePool->ReleasePooled();
+
+    ENQUEUE_RENDER_COMMAND(ReleaseOctreeResources)(
         [this](FRHICommandListImmediate& RHICmdList) {
             if (isoUniformBuffer.IsValid())
                 isoUniformBuffer->ReleaseResource();
@@ -75,6 +189,621 @@ void Octree::Release() {
         });
 }
 
+int32 Octree::AllocateNode(uint64 key) {
+    int32 index = nodeKeys.Add(key);
+    nodeDepths.Add((uint8)MortonCode::GetDepth(key));
+    nodeFirstChild.Add(INDEX_NONE);
+    nodeBoundsMin.AddUninitialized();
+    nodeBoundsMax.AddUninitialized();
+    ComputeNodeBounds(index);
+    nodeLookUp.Add(key, index);
+    nodeEdited.Add(false);
+    nodeMinIso.Add(0.0f);
+    nodeMaxIso.Add(0.0f);
+    nodeType.Add(MixedNodeType);
+    nodeResidentSlot.Add(INDEX_NONE);
+    nodeLastVisibleFrame.Add(0);
+    nodePinned.Add(false);
+    nodeVisibleEpoch.Add(0);
+    nodeRefined.Add(false);
+    nodeContentVersion.Add(1);
+    nodeMeshedVersion.Add(0);
+    nodeDeformedVersion.Add(0);
+    nodeEditedVersion.Add(0);
+    nodeTransitionSignature.Add(0);
+
+    int32 nodeIndex = nodes.Add(1);
+    check(nodeIndex == index);
+    nodes[index].Bind(this, index);
+    MarkTopologyDirty(index, index);
+    return index;
+}
+
+// The levels above ParallelBuildDepth are refined breadth first on the calling thread. Every surface node reached
+// at that depth then has its subtree built on a worker, and the subtrees are appended one after another so each
+// sibling group stays contiguous and children are always stored after their parent.
+int32 Octree::BuildNodes() {
+    AllocateNode(MortonCode::RootKey);
+
+    int splitDepth = FMath::Min(maxDepth, ParallelBuildDepth);
+    TArray<int32> subtreeRoots;
+    for (int32 i = 0; i < nodeKeys.Num(); i++) {
+        ComputeNodeSummary(i);
+        if (nodeDepths[i] >= maxDepth || ClassifyNode(i) != EVoxelNodeClass::Surface) continue;
+
+        if (nodeDepths[i] < splitDepth) SubdivideNode(i);
+        else subtreeRoots.Add(i);
+    }
+    if (subtreeRoots.Num() == 0) return 1;
+
+    int32 workerCount = CVarOctreeBuildWorkers.GetValueOnAnyThread();
+    if (workerCount <= 0) workerCount = FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+    workerCount = FMath::Clamp(workerCount, 1, subtreeRoots.Num());
+
+    TArray<uint64> rootKeys;
+    for (int32 root : subtreeRoots)
+        rootKeys.Add(nodeKeys[root]);
+    TArray<SubtreeBuild> subtrees;
+    BuildSubtrees(rootKeys, workerCount, subtrees);
+
+    for (int32 i = 0; i < subtreeRoots.Num(); i++)
+        AppendSubtree(subtreeRoots[i], subtrees[i]);
+    return workerCount;
+}
+
+void Octree::BuildSubtrees(TConstArrayView<uint64> rootKeys, int32 workerCount, TArray<SubtreeBuild>& outSubtrees) const {
+    outSubtrees.SetNum(rootKeys.Num());
+    ParallelFor(workerCount, [&](int32 worker) {
+        for (int32 i = worker; i < rootKeys.Num(); i += workerCount)
+            BuildSubtree(rootKeys[i], outSubtrees[i]);
+    }, workerCount == 1);
+}
+
+// The refinement above the split depth and the append run on the calling thread whatever the worker count, so only the
+// subtree builds are timed
+void Octree::BenchmarkBuild(int32 iterations, TArray<BuildTiming>& outTimings) const {
+    outTimings.Reset();
+    int splitDepth = FMath::Min(maxDepth, ParallelBuildDepth);
+    TArray<uint64> rootKeys;
+    for (int32 i = 0; i < nodeKeys.Num(); i++) {
+        if (nodeDepths[i] == splitDepth && splitDepth < maxDepth && ClassifyNode(i) == EVoxelNodeClass::Surface)
+            rootKeys.Add(nodeKeys[i]);
+    }
+    if (rootKeys.Num() == 0) return;
+
+    int32 maxWorkers = FMath::Clamp(FTaskGraphInterface::Get().GetNumWorkerThreads() + 1, 1, rootKeys.Num());
+    for (int32 workers = 1; ; workers = FMath::Min(workers * 2, maxWorkers)) {
+        BuildTiming& timing = outTimings.Add_GetRef({ workers, 0.0, 0 });
+        for (int32 i = 0; i < iterations; i++) {
+            TArray<SubtreeBuild> subtrees;
+            double start = FPlatformTime::Seconds();
+            BuildSubtrees(rootKeys, workers, subtrees);
+            timing.seconds += FPlatformTime::Seconds() - start;
+
+            timing.nodeCount = 0;
+            for (const SubtreeBuild& subtree : subtrees)
+                timing.nodeCount += subtree.keys.Num();
+        }
+        timing.seconds /= iterations;
+        if (workers == maxWorkers) break;
+    }
+}
+
+// Breadth first over the descendants of rootKey, touching only the shared density arrays (read only)
+void Octree::BuildSubtree(uint64 rootKey, SubtreeBuild& outSubtree) const {
+    for (int i = 0; i < 8; i++)
+        outSubtree.keys.Add(MortonCode::GetChild(rootKey, i));
+
+    for (int32 i = 0; i < outSubtree.keys.Num(); i++) {
+        uint64 key = outSubtree.keys[i];
+        float minIso, maxIso;
+        uint32 type;
+        ComputeRegionSummary(key, minIso, maxIso, type);
+
+        outSubtree.minIso.Add(minIso);
+        outSubtree.maxIso.Add(maxIso);
+        outSubtree.type.Add(type);
+        outSubtree.firstChild.Add(INDEX_NONE);
+
+        if (MortonCode::GetDepth(key) < maxDepth && ClassifyIsoRange(minIso, maxIso) == EVoxelNodeClass::Surface) {
+            outSubtree.firstChild[i] = outSubtree.keys.Num();
+            for (int j = 0; j < 8; j++)
+                outSubtree.keys.Add(MortonCode::GetChild(key, j));
+        }
+    }
+}
+
+void Octree::AppendSubtree(int32 rootIndex, const SubtreeBuild& subtree) {
+    int32 baseIndex = nodeKeys.Num();
+    int32 count = subtree.keys.Num();
+    nodeFirstChild[rootIndex] = baseIndex;
+    MarkTopologyDirty(rootIndex, rootIndex);
+    MarkTopologyDirty(baseIndex, baseIndex + count - 1);
+
+    nodeKeys.Append(subtree.keys);
+    nodeMinIso.Append(subtree.minIso);
+    nodeMaxIso.Append(subtree.maxIso);
+    nodeType.Append(subtree.type);
+    nodeDepths.AddUninitialized(count);
+    nodeFirstChild.AddUninitialized(count);
+    nodeBoundsMin.AddUninitialized(count);
+    nodeBoundsMax.AddUninitialized(count);
+    nodeResidentSlot.AddUninitialized(count);
+    nodeLastVisibleFrame.AddZeroed(count);
+    nodePinned.Add(false, count);
+    nodeVisibleEpoch.AddZeroed(count);
+    nodeEdited.Add(false, count);
+    nodeRefined.Add(false, count);
+    nodeContentVersion.AddUninitialized(count);
+    nodeMeshedVersion.AddZeroed(count);
+    nodeDeformedVersion.AddZeroed(count);
+    nodeEditedVersion.AddZeroed(count);
+    nodeTransitionSignature.AddZeroed(count);
+
+    nodeLookUp.Reserve(baseIndex + count);
+    for (int32 i = 0; i < count; i++)
+        nodeLookUp.Add(subtree.keys[i], baseIndex + i);
+
+    int32 firstNode = nodes.Add(count);
+    check(firstNode == baseIndex);
+
+    // Post pass over the appended range, every node only writes its own slots
+    ParallelFor(count, [&](int32 i) {
+        int32 index = baseIndex + i;
+        int depth = MortonCode::GetDepth(nodeKeys[index]);
+        nodeDepths[index] = (uint8)depth;
+        nodeFirstChild[index] = subtree.firstChild[i] == INDEX_NONE ? INDEX_NONE : baseIndex + subtree.firstChild[i];
+        nodeResidentSlot[index] = INDEX_NONE;
+        nodeContentVersion[index] = 1;
+        ComputeNodeBounds(index);
+        nodes[index].Bind(this, index);
+    });
+}
+
+void Octree::ComputeNodeBounds(int32 index) {
+    uint64 key = nodeKeys[index];
+    float nodeSize = scale / (1 << MortonCode::GetDepth(key));
+    FIntVector coord = MortonCode::Decode(key);
+    nodeBoundsMin[index] = FVector3f(-scale / 2) + FVector3f(coord.X, coord.Y, coord.Z) * nodeSize;
+    nodeBoundsMax[index] = nodeBoundsMin[index] + FVector3f(nodeSize);
+}
+
+void Octree::SubdivideNode(int32 index) {
+    if (!IsLeafIndex(index)) return;
+
+    // A node split again after it was collapsed takes back its old children, so edits that keep crossing the same
+    // region don't keep appending nodes
+    int32 retired;
+    if (retiredChildren.RemoveAndCopyValue(index, retired)) {
+        for (int32 child = retired; child < retired + 8; child++) {
+            nodeLookUp.Add(nodeKeys[child], child);
+            nodeContentVersion[child]++;
+            nodeRefined[child] = false;
+        }
+        nodeFirstChild[index] = retired;
+        MarkTopologyDirty(index, index);
+        MarkTopologyDirty(retired, retired + 7);
+        return;
+    }
+
+    uint64 key = nodeKeys[index];
+    int32 firstChild = AllocateNode(MortonCode::GetChild(key, 0));
+    for (int i = 1; i < 8; ++i)
+        AllocateNode(MortonCode::GetChild(key, i));
+    nodeFirstChild[index] = firstChild;
+    MarkTopologyDirty(index, index);
+}
+
+// The children leave the lookup and can no longer be reached from the root, but keep their storage: a selection made
+// from an older snapshot may still hold them, and the owner pins them until it stops drawing them.
+void Octree::CollapseNode(int32 index) {
+    int32 firstChild = nodeFirstChild[index];
+    for (int32 child = firstChild; child < firstChild + 8; child++)
+        nodeLookUp.Remove(nodeKeys[child]);
+    retiredChildren.Add(index, firstChild);
+    nodeFirstChild[index] = INDEX_NONE;
+    MarkTopologyDirty(index, index);
+}
+
+void Octree::MarkTopologyDirty(int32 firstIndex, int32 lastIndex) {
+    if (lastIndex < firstIndex) return;
+    int32 firstPage = firstIndex >> VoxelTopologySnapshot::PageShift;
+    int32 lastPage = lastIndex >> VoxelTopologySnapshot::PageShift;
+    if (lastPage >= topologyDirtyPages.Num())
+        topologyDirtyPages.Add(true, lastPage + 1 - topologyDirtyPages.Num());
+    topologyDirtyPages.SetRange(firstPage, lastPage - firstPage + 1, true);
+}
+
+void Octree::MakeNodeResident(int32 index) {
+    if (nodes[index].IsResident()) return;
+
+    uint64 pooledBefore = resourcePool->GetPooledBytes();
+    nodes[index].AcquireResources(*resourcePool);
+    DEC_MEMORY_STAT_BY(STAT_VoxelResidency_Pooled, pooledBefore - resourcePool->GetPooledBytes());
+
+    // Fresh or recycled buffers hold nothing of this node, so it has to be deformed and meshed again
+    nodeMeshedVersion[index] = 0;
+    nodeDeformedVersion[index] = 0;
+
+    nodeResidentSlot[index] = residentNodes.Add(index);
+    AdjustResidentBytes(nodeDepths[index], resourcePool->GetBytesPerResourceSet());
+}
+
+void Octree::EvictResidentNode(int32 residentIndex) {
+    int32 index = residentNodes[residentIndex];
+    nodes[index].ReturnResources(*resourcePool);
+    INC_MEMORY_STAT_BY(STAT_VoxelResidency_Pooled, resourcePool->GetBytesPerResourceSet());
+
+    residentNodes.RemoveAtSwap(residentIndex, EAllowShrinking::No);
+    if (residentIndex < residentNodes.Num())
+        nodeResidentSlot[residentNodes[residentIndex]] = residentIndex;
+    nodeResidentSlot[index] = INDEX_NONE;
+    AdjustResidentBytes(nodeDepths[index], -(int64)resourcePool->GetBytesPerResourceSet());
+}
+
+void Octree::AdjustResidentBytes(int depth, int64 deltaBytes) {
+    residentBytesPerDepth[depth] += deltaBytes;
+
+#if STATS
+    static const FName depthStats[] = {
+        GET_STATFNAME(STAT_VoxelResidency_Depth0), GET_STATFNAME(STAT_VoxelResidency_Depth1),
+        GET_STATFNAME(STAT_VoxelResidency_Depth2), GET_STATFNAME(STAT_VoxelResidency_Depth3),
+        GET_STATFNAME(STAT_VoxelResidency_Depth4), GET_STATFNAME(STAT_VoxelResidency_Depth5),
+        GET_STATFNAME(STAT_VoxelResidency_Depth6), GET_STATFNAME(STAT_VoxelResidency_Depth7)
+    };
+    FName depthStat = depthStats[FMath::Min(depth, (int)UE_ARRAY_COUNT(depthStats) - 1)];
+    if (deltaBytes >= 0) {
+        INC_MEMORY_STAT_BY_FName(depthStat, deltaBytes);
+        INC_MEMORY_STAT_BY(STAT_VoxelResidency_Resident, deltaBytes);
+    }
+    else {
+        DEC_MEMORY_STAT_BY_FName(depthStat, -deltaBytes);
+        DEC_MEMORY_STAT_BY(STAT_VoxelResidency_Resident, -deltaBytes);
+    }
+#endif
+}
+
+void Octree::SetResidencyBudget(uint64 inBudgetBytes, uint32 inGraceFrames) {
+    residencyBudgetBytes = inBudgetBytes;
+    residencyGraceFrames = inGraceFrames;
+}
+
+void Octree::UpdateResidency(const TArray<OctreeNode*>& visibleNodes) {
+    residencyFrame++;
+    for (OctreeNode* node : visibleNodes) {
+        int32 index = node->GetIndex();
+        MakeNodeResident(index);
+        nodeLastVisibleFrame[index] = residencyFrame;
+    }
+    resourcePool->SubmitPendingInit();
+
+    for (int32 i = residentNodes.Num() - 1; i >= 0; i--) {
+        int32 index = residentNodes[i];
+        if (!nodePinned[index] && residencyFrame - nodeLastVisibleFrame[index] > residencyGraceFrames)
+            EvictResidentNode(i);
+    }
+
+    uint64 residentBytes = GetResidentBytes();
+    if (residentBytes + resourcePool->GetPooledBytes() <= residencyBudgetBytes) return;
+
+    // Over budget: evict out of view nodes, least recently visible first. Visible and pinned nodes are never evicted,
+    // so the budget is a soft limit when those alone exceed it.
+    if (residentBytes > residencyBudgetBytes) {
+        evictionCandidates.Reset();
+        for (int32 index : residentNodes) {
+            if (nodeLastVisibleFrame[index] != residencyFrame && !nodePinned[index])
+                evictionCandidates.Add(index);
+        }
+        evictionCandidates.Sort([this](int32 a, int32 b) { return nodeLastVisibleFrame[a] < nodeLastVisibleFrame[b]; });
+
+        for (int32 index : evictionCandidates) {
+            if (GetResidentBytes() <= residencyBudgetBytes) break;
+            EvictResidentNode(nodeResidentSlot[index]);
+        }
+    }
+
+    uint64 pooledBefore = resourcePool->GetPooledBytes();
+    uint64 totalBytes = GetResidentBytes() + pooledBefore;
+    if (totalBytes > residencyBudgetBytes) {
+        resourcePool->TrimPooled(totalBytes - residencyBudgetBytes);
+        DEC_MEMORY_STAT_BY(STAT_VoxelResidency_Pooled, pooledBefore - resourcePool->GetPooledBytes());
+    }
+}
+
+void Octree::GetNodeIsoRegion(int32 index, FIntVector& outMin, FIntVector& outMax) const {
+    GetKeyIsoRegion(nodeKeys[index], outMin, outMax);
+}
+
+void Octree::GetKeyIsoRegion(uint64 key, FIntVector& outMin, FIntVector& outMax) const {
+    int span = voxelsPerAxisMaxRes >> MortonCode::GetDepth(key);
+    outMin = MortonCode::Decode(key) * span;
+    outMax = outMin + FIntVector(span);
+}
+
+bool Octree::NodeOverlapsIsoRegion(int32 index, const FIntVector& regionMin, const FIntVector& regionMax) const {
+    FIntVector nodeMin, nodeMax;
+    GetNodeIsoRegion(index, nodeMin, nodeMax);
+    return !(nodeMax.X < regionMin.X || nodeMax.Y < regionMin.Y || nodeMax.Z < regionMin.Z ||
+        nodeMin.X > regionMax.X || nodeMin.Y > regionMax.Y || nodeMin.Z > regionMax.Z);
+}
+
+void Octree::ComputeNodeSummary(int32 index) {
+    ComputeRegionSummary(nodeKeys[index], nodeMinIso[index], nodeMaxIso[index], nodeType[index]);
+}
+
+// Exact min/max density and material summary over every max resolution sample the key's region covers
+void Octree::ComputeRegionSummary(uint64 key, float& outMinIso, float& outMaxIso, uint32& outType) const {
+    FIntVector regionMin, regionMax;
+    GetKeyIsoRegion(key, regionMin, regionMax);
+    ComputeBoxSummary(regionMin, regionMax.ComponentMin(FIntVector(isoValuesPerAxisMaxRes - 1)), outMinIso, outMaxIso, outType);
+}
+
+void Octree::ComputeBoxSummary(const FIntVector& regionMin, const FIntVector& regionMax, float& outMinIso, float& outMaxIso, uint32& outType) const {
+    int sliceSize = isoValuesPerAxisMaxRes * isoValuesPerAxisMaxRes;
+    float minIso = TNumericLimits<float>::Max();
+    float maxIso = TNumericLimits<float>::Lowest();
+    uint32 firstType = GetCombinedType(regionMin.X + (regionMin.Y * isoValuesPerAxisMaxRes) + (regionMin.Z * sliceSize));
+    bool bSingleType = true;
+
+    for (int z = regionMin.Z; z <= regionMax.Z; z++) {
+        for (int y = regionMin.Y; y <= regionMax.Y; y++) {
+            int rowIndex = (y * isoValuesPerAxisMaxRes) + (z * sliceSize);
+            for (int x = regionMin.X; x <= regionMax.X; x++) {
+                float density = GetCombinedIso(rowIndex + x);
+                minIso = FMath::Min(minIso, density);
+                maxIso = FMath::Max(maxIso, density);
+                bSingleType &= GetCombinedType(rowIndex + x) == firstType;
+            }
+        }
+    }
+
+    outMinIso = minIso;
+    outMaxIso = maxIso;
+    outType = bSingleType ? firstType : MixedNodeType;
+}
+
+void Octree::MergeChildSummaries(int32 index) {
+    int32 firstChild = nodeFirstChild[index];
+    float minIso = nodeMinIso[firstChild];
+    float maxIso = nodeMaxIso[firstChild];
+    uint32 type = nodeType[firstChild];
+
+    for (int i = 1; i < 8; i++) {
+        int32 child = firstChild + i;
+        minIso = FMath::Min(minIso, nodeMinIso[child]);
+        maxIso = FMath::Max(maxIso, nodeMaxIso[child]);
+        if (nodeType[child] != type) type = MixedNodeType;
+    }
+
+    nodeMinIso[index] = minIso;
+    nodeMaxIso[index] = maxIso;
+    nodeType[index] = type;
+}
+
+// Children are always stored after their parent, so a reverse sweep visits every child before it is merged
+void Octree::RebuildNodeSummaries() {
+    for (int32 i = nodeKeys.Num() - 1; i >= 0; i--) {
+        if (IsLeafIndex(i)) ComputeNodeSummary(i);
+        else MergeChildSummaries(i);
+    }
+}
+
+EVoxelNodeClass Octree::ClassifyNode(int32 index) const {
+    return ClassifyIsoRange(nodeMinIso[index], nodeMaxIso[index]);
+}
+
+EVoxelNodeClass Octree::ClassifyIsoRange(float minIso, float maxIso) const {
+    if (minIso >= isoLevel) return EVoxelNodeClass::Empty;
+    if (maxIso < isoLevel) return EVoxelNodeClass::Solid;
+    return EVoxelNodeClass::Surface;
+}
+
+// Walks the edited path only. A coarse leaf rescans just the part of it the edit covers and is split only if that
+// leaves a surface in it, so paint, carving in empty space or a brush larger than the tree does not refine anything.
+// Max depth nodes are rescanned whole, every ancestor on the path merges its children's summaries and collapses them
+// again if they all came back homogeneous.
+void Octree::UpdateEditedNode(int32 index, const FIntVector& editMin, const FIntVector& editMax) {
+    if (!NodeOverlapsIsoRegion(index, editMin, editMax)) return;
+
+    nodeEdited[index] = true;
+    nodeContentVersion[index]++;
+    nodeEditedVersion[index] = editVersion;
+    if (nodeDepths[index] >= maxDepth) {
+        ComputeNodeSummary(index);
+        return;
+    }
+
+    if (IsLeafIndex(index)) {
+        FIntVector nodeMin, nodeMax;
+        GetNodeIsoRegion(index, nodeMin, nodeMax);
+        nodeMax = nodeMax.ComponentMin(FIntVector(isoValuesPerAxisMaxRes - 1));
+        FIntVector boxMin = nodeMin.ComponentMax(editMin);
+        FIntVector boxMax = nodeMax.ComponentMin(editMax);
+        float minIso, maxIso;
+        uint32 type;
+        ComputeBoxSummary(boxMin, boxMax, minIso, maxIso, type);
+
+        // The rest of a leaf is untouched and still holds the homogeneous range it had before
+        float previousMinIso = nodeMinIso[index];
+        float previousMaxIso = nodeMaxIso[index];
+        uint32 previousType = nodeType[index];
+        if (boxMin != nodeMin || boxMax != nodeMax) {
+            minIso = FMath::Min(minIso, previousMinIso);
+            maxIso = FMath::Max(maxIso, previousMaxIso);
+            if (type != previousType) type = MixedNodeType;
+        }
+        nodeMinIso[index] = minIso;
+        nodeMaxIso[index] = maxIso;
+        nodeType[index] = type;
+        if (ClassifyIsoRange(minIso, maxIso) != EVoxelNodeClass::Surface) return;
+
+        SubdivideNode(index);
+        for (int i = 0; i < 8; i++) {
+            // Untouched children inherit the homogeneous summary of the leaf they were split from
+            int32 child = nodeFirstChild[index] + i;
+            nodeMinIso[child] = previousMinIso;
+            nodeMaxIso[child] = previousMaxIso;
+            nodeType[child] = previousType;
+        }
+    }
+
+    for (int i = 0; i < 8; i++)
+        UpdateEditedNode(nodeFirstChild[index] + i, editMin, editMax);
+    MergeChildSummaries(index);
+
+    // Only surface nodes are ever split, so children that came back homogeneous are leaves themselves
+    if (ClassifyNode(index) == EVoxelNodeClass::Surface) return;
+    for (int i = 0; i < 8; i++) {
+        if (!IsLeafIndex(nodeFirstChild[index] + i)) return;
+    }
+    CollapseNode(index);
+}
+
+int32 Octree::FindDeepestNodeAt(const FVector& isoPosition) const {
+    if (isoPosition.X < 0 || isoPosition.Y < 0 || isoPosition.Z < 0) return INDEX_NONE;
+
+    FIntVector coord((int)isoPosition.X, (int)isoPosition.Y, (int)isoPosition.Z);
+    if (coord.X >= voxelsPerAxisMaxRes || coord.Y >= voxelsPerAxisMaxRes || coord.Z >= voxelsPerAxisMaxRes) return INDEX_NONE;
+
+    int32 index = 0;
+    while (!IsLeafIndex(index)) {
+        int span = voxelsPerAxisMaxRes >> (nodeDepths[index] + 1);
+        int childIndex = ((coord.X / span) & 1) | (((coord.Y / span) & 1) << 1) | (((coord.Z / span) & 1) << 2);
+        index = nodeFirstChild[index] + childIndex;
+    }
+    return index;
+}
+
+int32 Octree::FindNodeIndex(uint64 key) const {
+    const int32* index = nodeLookUp.Find(key);
+    return index ? *index : INDEX_NONE;
+}
+
+OctreeNode* Octree::FindNode(uint64 key) {
+    int32 index = FindNodeIndex(key);
+    return index == INDEX_NONE ? nullptr : &nodes[index];
+}
+
+// Returns the same depth neighbour if it exists, otherwise the closest coarser node covering that face
+int32 Octree::GetFaceNeighbourIndex(int32 index, int direction) const {
+    if (direction < 0 || direction > 5) return INDEX_NONE;
+
+    uint64 neighbourKey = MortonCode::GetNeighbour(nodeKeys[index], neighborOffsets[direction]);
+    while (neighbourKey >= MortonCode::RootKey) {
+        int32 neighbourIndex = FindNodeIndex(neighbourKey);
+        if (neighbourIndex != INDEX_NONE) return neighbourIndex;
+        neighbourKey = MortonCode::GetParent(neighbourKey);
+    }
+    return INDEX_NONE;
+}
+
+OctreeNode* Octree::GetFaceNeighbour(int32 index, int direction) {
+    int32 neighbourIndex = GetFaceNeighbourIndex(index, direction);
+    return neighbourIndex == INDEX_NONE ? nullptr : &nodes[neighbourIndex];
+}
+
+// Splitting, collapsing and appending all mark the pages they touch, so with no dirty page the last snapshot is current.
+// Otherwise clean pages are shared with it and only the dirty ones are copied.
+TSharedPtr<const VoxelTopologySnapshot> Octree::GetTopologySnapshot() {
+    if (topologySnapshot.IsValid() && topologySnapshot->Num() == nodeKeys.Num() && topologyDirtyPages.Find(true) == INDEX_NONE)
+        return topologySnapshot;
+
+    constexpr int32 PageSize = VoxelTopologySnapshot::PageSize;
+    TSharedPtr<VoxelTopologySnapshot> snapshot = MakeShared<VoxelTopologySnapshot>();
+    snapshot->nodeCount = nodeKeys.Num();
+    snapshot->voxelsPerAxis = voxelsPerAxis;
+    int32 pageCount = FMath::DivideAndRoundUp(snapshot->nodeCount, PageSize);
+    snapshot->pages.Reserve(pageCount);
+
+    int32 copiedPages = 0;
+    for (int32 page = 0; page < pageCount; page++) {
+        if (topologySnapshot.IsValid() && topologySnapshot->pages.IsValidIndex(page) && !topologyDirtyPages[page]) {
+            snapshot->pages.Add(topologySnapshot->pages[page]);
+            continue;
+        }
+        int32 first = page * PageSize;
+        int32 count = FMath::Min(PageSize, snapshot->nodeCount - first);
+        TSharedPtr<VoxelTopologySnapshot::Page> pageData = MakeShared<VoxelTopologySnapshot::Page>();
+        pageData->keys.Append(nodeKeys.GetData() + first, count);
+        pageData->depths.Append(nodeDepths.GetData() + first, count);
+        pageData->firstChild.Append(nodeFirstChild.GetData() + first, count);
+        pageData->boundsMin.Append(nodeBoundsMin.GetData() + first, count);
+        pageData->boundsMax.Append(nodeBoundsMax.GetData() + first, count);
+        snapshot->pages.Add(pageData);
+        copiedPages++;
+    }
+    topologyDirtyPages.SetRange(0, topologyDirtyPages.Num(), false);
+
+    topologySnapshot = snapshot;
+    INC_DWORD_STAT(STAT_Octree_TopologySnapshots);
+    INC_DWORD_STAT_BY(STAT_Octree_TopologyPagesCopied, copiedPages);
+    return topologySnapshot;
+}
+
+// Nodes split after the snapshot was taken only gain children, so the selected cut still covers the tree. Children
+// collapsed since keep their storage and key, so a cut holding them still meshes their region until the next selection.
+void Octree::ApplyLODSelection(const TArray<int32>& visibleIndices, TArray<OctreeNode*>& outVisibleNodes) {
+    BeginVisibilityEpoch();
+    outVisibleNodes.Reserve(outVisibleNodes.Num() + visibleIndices.Num());
+    for (int32 index : visibleIndices) {
+        SetNodeVisible(index, true);
+        outVisibleNodes.Add(&nodes[index]);
+    }
+
+    for (int32 index : visibleIndices)
+        AssignTransitionCells(index);
+}
+
+// Links a visible node to the visible children of each same depth neighbour, one level finer, that touch its faces.
+// The adjacency index is the child's position on the face: bit 0 along (axis + 1) % 3, bit 1 along (axis + 2) % 3.
+void Octree::AssignTransitionCells(int32 index) {
+    OctreeNode& node = nodes[index];
+    node.ResetTransVoxelData();
+    if (IsLeafIndex(index)) return;
+
+    for (int direction = 0; direction < 6; direction++) {
+        uint64 neighbourKey = MortonCode::GetNeighbour(nodeKeys[index], neighborOffsets[direction]);
+        if (neighbourKey == 0) continue;
+
+        int32 neighbourIndex = FindNodeIndex(neighbourKey);
+        if (neighbourIndex == INDEX_NONE || IsNodeVisible(neighbourIndex) || IsLeafIndex(neighbourIndex)) continue;
+
+        int mainAxis = direction / 2;
+        int facingBit = (direction & 1) ? 0 : 1;
+        int32 firstChild = nodeFirstChild[neighbourIndex];
+
+        // A transition cell needs all four children on the face, a partly refined face gets no cell
+        int32 faceChildren[4];
+        int faceCount = 0;
+        for (int i = 0; i < 8; i++) {
+            if (((i >> mainAxis) & 1) != facingBit) continue;
+            if (!IsNodeVisible(firstChild + i)) break;
+            int adjIndex = ((i >> ((mainAxis + 1) % 3)) & 1) + (2 * ((i >> ((mainAxis + 2) % 3)) & 1));
+            faceChildren[adjIndex] = firstChild + i;
+            faceCount++;
+        }
+        if (faceCount != 4) continue;
+
+        // Cell directions follow the convention of AreAdjacent and the shader: cell d holds the neighbour on the side
+        // of -neighborOffsets[d], so the neighbour found through neighborOffsets[d] goes in cell d ^ 1
+        for (int adjIndex = 0; adjIndex < 4; adjIndex++)
+            node.AssignTransVoxelData(direction ^ 1, &nodes[faceChildren[adjIndex]], adjIndex);
+    }
+}
+
+void Octree::UpdateTransitionSignature(int32 index, uint32 signature) {
+    if (nodeTransitionSignature[index] == (uint16)signature) return;
+    nodeTransitionSignature[index] = (uint16)signature;
+    nodeContentVersion[index]++;
+}
+
+void Octree::BeginVisibilityEpoch() {
+    if (++visibilityEpoch == 0) {
+        FMemory::Memzero(nodeVisibleEpoch.GetData(), nodeVisibleEpoch.Num() * sizeof(uint32));
+        visibilityEpoch = 1;
+    }
+}
+
 FBoxSphereBounds Octree::GetBoxSphereBoundsBounds() {
     float halfSize = scale / 2;
     return FBoxSphereBounds(FBox(FVector(-halfSize), FVector(halfSize)));
@@ -166,6 +895,22 @@ bool Octree::RaycastToVoxelBody(FHitResult& hit, FVector& start, FVector& end)
 
         if (FVector::DotProduct((endPosition - voxelPosition), direction) <= 0) break;
 
+        // Nodes whose every sample is outside the body cannot be hit, step straight to where the ray leaves them
+        int32 skipIndex = FindDeepestNodeAt(voxelPosition);
+        if (skipIndex != INDEX_NONE && ClassifyNode(skipIndex) == EVoxelNodeClass::Empty) {
+            FIntVector regionMin, regionMax;
+            GetNodeIsoRegion(skipIndex, regionMin, regionMax);
+
+            float exitDistance = TNumericLimits<float>::Max();
+            for (int axis = 0; axis < 3; axis++) {
+                if (FMath::IsNearlyZero(direction[axis])) continue;
+                float boundary = direction[axis] > 0 ? regionMax[axis] : regionMin[axis];
+                exitDistance = FMath::Min(exitDistance, (boundary - voxelPosition[axis]) / (float)direction[axis]);
+            }
+            voxelPosition += direction * FMath::Max(exitDistance, 1.0f);
+            continue;
+        }
+
         float isoA, isoB, isoC, isoD;
         FVector posA, posB, posC, posD;
        
@@ -237,81 +982,224 @@ bool Octree::RaycastToVoxelBody(FHitResult& hit, FVector& start, FVector& end)
     return false;
 }
 
+// Only the bricks the brush touched since the last upload are copied, into a snapshot the render command owns, so the
+// live arrays can be edited again straight away
 void Octree::UpdateValuesDirty() {
-    UpdateTypeValuesDirty();
-    UpdateIsoValuesDirty();
+    deltaUploader->Upload(deltaIsoArray, deltaTypeArray, deltaIsoBuffer, deltaTypeBuffer);
+    bIsoValuesDirty = false;
+    bTypeValuesDirty = false;
 }
 
+// Cleared on the game thread so the node summaries can be rebuilt straight away, the GPU copy follows
+// as one full snapshot through the delta uploader
 void Octree::ResetDeformation() {
-    if (deltaTypeBuffer.IsValid() && deltaIsoBuffer.IsValid()) {
+    FMemory::Memzero(deltaTypeArray.GetData(), deltaTypeArray.Num() * sizeof(uint32));
+    FMemory::Memzero(deltaIsoArray.GetData(), deltaIsoArray.Num() * sizeof(float));
+    RebuildNodeSummaries();
+    if (connectivity.IsValid() || connectivityBuild.IsValid())
+        LaunchConnectivityBuild();
+    editVersion++;
+    for (uint32& version : nodeContentVersion)
+        version++;
+
+    deltaUploader->MarkAllDirty();
+    bIsoValuesDirty = true;
+    bTypeValuesDirty = true;
+}
 
-        int bufferSize = deltaTypeBuffer->GetCapacity();
-        float* isoPtr = deltaIsoArray.GetData();
-        uint32* typePtr = deltaTypeArray.GetData();
+int Octree::GetIsoValueFromIndex(FIntVector coord, int axisSize) {
 
-        ENQUEUE_RENDER_COMMAND(CopyTypeDelta)(
-            [deltaIsoBuffer = deltaIsoBuffer, deltaTypeBuffer = deltaTypeBuffer, typePtr, isoPtr, bufferSize](FRHICommandListImmediate& RHICmdList)
-            {
-                FMemory::Memzero(typePtr, bufferSize * sizeof(uint32));
-                FMemory::Memzero(isoPtr, bufferSize * sizeof(float));
+    int maxIsoCount = (axisSize) * (axisSize) * (axisSize);
+    int index = coord.X + coord.Y * (axisSize)+coord.Z * (axisSize) * (axisSize);
+    return FMath::Max(0, FMath::Min(index, maxIsoCount + 1));
+}
 
-                void* LockedData = RHICmdList.LockBuffer(deltaTypeBuffer->buffer, 0, bufferSize * sizeof(uint32), RLM_WriteOnly);
-                FMemory::Memzero(LockedData, bufferSize * sizeof(uint32));
-                RHICmdList.UnlockBuffer(deltaTypeBuffer->buffer);
+bool Octree::ApplyDeformationAtPosition(FVector inPosition, float radius, float influence, uint32 paintType, bool additive, bool paintOnly) {
+    VoxelEditCommand command;
+    if (!GetDeformationOp(additive, paintOnly, command.op)) return false;
+    command.position = inPosition;
+    command.radius = radius;
+    command.influence = influence;
+    command.paintType = paintType;
+
+    if (ApplyEditBatch(MakeArrayView(&command, 1)) == 0)
+        return false;
+    return bIsoValuesDirty;
+}
 
-                void* LockedIsoData = RHICmdList.LockBuffer(deltaIsoBuffer->buffer, 0, bufferSize * sizeof(float), RLM_WriteOnly);
-                FMemory::Memzero(LockedIsoData, bufferSize * sizeof(float));
-                RHICmdList.UnlockBuffer(deltaIsoBuffer->buffer);
-            });
-    }
+bool Octree::ApplySweptDeformation(FVector start, FVector end, float radius, float influence, uint32 paintType, bool additive, bool paintOnly) {
+    VoxelEditCommand command;
+    if (!GetDeformationOp(additive, paintOnly, command.op)) return false;
+    command.shape = EVoxelEditShape::Capsule;
+    command.position = end;
+    command.sweepStart = start;
+    command.radius = radius;
+    command.influence = influence;
+    command.paintType = paintType;
+
+    if (ApplyEditBatch(MakeArrayView(&command, 1)) == 0)
+        return false;
+    return bIsoValuesDirty;
 }
 
-void Octree::UpdateTypeValuesDirty() {
-    if (!bTypeValuesDirty) return;
+// Brushes whose iso space boxes overlap are grouped into clusters as they arrive; cluster boxes only grow, so two
+// overlapping brushes always end up in the same cluster and clusters never share a touched voxel. Each cluster is
+// applied in one pass over its box, reading and writing every voxel once with its brushes applied in command order,
+// and its region is committed to the node summaries, delta uploader and connectivity once.
+int32 Octree::ApplyEditBatch(TConstArrayView<VoxelEditCommand> commands) {
+    SCOPE_CYCLE_COUNTER(STAT_Octree_EditBatch);
+    // A tree without an actor, as built by the automation tests, edits in its own local space
+    FTransform parentTransform = parent ? parent->GetTransform() : FTransform::Identity;
+
+    // Launched at construction, until it is adopted the edited regions are only recorded. Turning
+    // voxel.DetectDetachedChunks on later has no base-only labels to start from, so that batch labels the whole grid.
+    if (CVarDetectDetachedChunks.GetValueOnGameThread() == 0) {
+        CancelConnectivityBuild();
+        connectivity.Reset();
+    }
+    else if (!FinishConnectivityBuild(false) && !connectivityBuild.IsValid()) {
+        connectivity = MakeUnique<VoxelConnectivity>(initIsoArray, deltaIsoArray, isoValuesPerAxisMaxRes, isoLevel);
+        connectivity->Build();
+    }
+
+    TArray<EditBrush> brushes;
+    TArray<EditCluster> clusters;
+    bool bRemovesSolid = false;
+    brushes.Reserve(commands.Num());
+    for (const VoxelEditCommand& command : commands) {
+        EditBrush brush;
+        if (!MakeEditBrush(command, parentTransform, brush)) continue;
+        brushes.Add(brush);
+        bRemovesSolid |= command.op == EVoxelEditOp::Subtract || command.IsFilter();
+
+        int32 brushIndex = brushes.Num() - 1;
+        int32 target = INDEX_NONE;
+        for (int32 c = clusters.Num() - 1; c >= 0; c--) {
+            EditCluster& cluster = clusters[c];
+            if (!BoxesOverlap(brush.min, brush.max, cluster.min, cluster.max)) continue;
+            if (target == INDEX_NONE) {
+                target = c;
+                continue;
+            }
+            // The brush bridges two clusters, fold the later one into this earlier one
+            cluster.min = cluster.min.ComponentMin(clusters[target].min);
+            cluster.max = cluster.max.ComponentMax(clusters[target].max);
+            cluster.brushes.Append(clusters[target].brushes);
+            clusters.RemoveAtSwap(target, EAllowShrinking::No);
+            target = c;
+        }
 
-    if (deltaTypeBuffer.IsValid()) {
-        uint32* typePtr = deltaTypeArray.GetData();
-        int bufferSize = deltaTypeBuffer->GetCapacity();
+        if (target == INDEX_NONE) clusters.Add({ brush.min, brush.max, { brushIndex } });
+        else {
+            EditCluster& cluster = clusters[target];
+            cluster.min = cluster.min.ComponentMin(brush.min);
+            cluster.max = cluster.max.ComponentMax(brush.max);
+            cluster.brushes.Add(brushIndex);
+        }
+    }
 
-        ENQUEUE_RENDER_COMMAND(CopyTypeDelta)(
-            [deltaTypeBuffer = deltaTypeBuffer, typePtr, bufferSize, bTypeValuesDirty = bTypeValuesDirty](FRHICommandListImmediate& RHICmdList)
-            {
-                void* LockedData = RHICmdList.LockBuffer(deltaTypeBuffer->buffer, 0, bufferSize * sizeof(uint32), RLM_WriteOnly);
-                FMemory::Memcpy(LockedData, typePtr, bufferSize * sizeof(uint32));
-                RHICmdList.UnlockBuffer(deltaTypeBuffer->buffer);
-            });
+    bool bVersionStamped = false;
+    for (EditCluster& cluster : clusters) {
+        cluster.brushes.Sort();
+        bool bIsoEdited = false;
+        bool bTypeEdited = false;
+        ApplyEditClusterInOrder(brushes, cluster, bIsoEdited, bTypeEdited);
+        if (!bIsoEdited && !bTypeEdited) continue;
+
+        if (!bVersionStamped) {
+            editVersion++;
+            bVersionStamped = true;
+        }
+        UpdateEditedNode(0, cluster.min, cluster.max);
+        deltaUploader->MarkDirty(cluster.min, cluster.max, bIsoEdited, bTypeEdited);
+        if (!bIsoEdited) continue;
+        if (connectivity.IsValid()) connectivity->MarkDirty(cluster.min, cluster.max);
+        else if (connectivityBuild.IsValid()) pendingConnectivityRegions.Add({ cluster.min, cluster.max });
     }
-    bTypeValuesDirty = false;
+    bPendingConnectivityRemovesSolid |= connectivityBuild.IsValid() && bRemovesSolid;
+    INC_DWORD_STAT_BY(STAT_Octree_EditClusters, clusters.Num());
+
+    // Only carving can cut a piece off, batches that only add or paint just relabel
+    if (connectivity.IsValid()) {
+        TArray<VoxelSolidComponent> detached;
+        connectivity->Update(bRemovesSolid, detached);
+        AppendDetachedChunks(detached, parentTransform);
+    }
+    return brushes.Num();
 }
 
-void Octree::UpdateIsoValuesDirty() {
-    if (!bIsoValuesDirty) return;
+// Only exact while the delta is all zero, at construction and straight after a reset. The task reads the base
+// densities alone, so edits can write the delta while it runs.
+void Octree::LaunchConnectivityBuild() {
+    CancelConnectivityBuild();
+    connectivity.Reset();
+    pendingConnectivity = MakeUnique<VoxelConnectivity>(initIsoArray, deltaIsoArray, isoValuesPerAxisMaxRes, isoLevel);
+    bCancelConnectivityBuild = false;
+    connectivityBuild = UE::Tasks::Launch(UE_SOURCE_LOCATION, [building = pendingConnectivity.Get(), &cancel = bCancelConnectivityBuild]() {
+        building->BuildFromBase(cancel);
+    });
+}
 
-    if (deltaIsoBuffer.IsValid()) {
-        float* isoPtr = deltaIsoArray.GetData();
-        int bufferSize = deltaIsoBuffer->GetCapacity();
+void Octree::CancelConnectivityBuild() {
+    if (!connectivityBuild.IsValid()) return;
+    bCancelConnectivityBuild = true;
+    connectivityBuild.Wait();
+    connectivityBuild = {};
+    pendingConnectivity.Reset();
+    pendingConnectivityRegions.Reset();
+    bPendingConnectivityRemovesSolid = false;
+}
 
-        ENQUEUE_RENDER_COMMAND(CopyIsoDelta)(
-            [deltaIsoBuffer = deltaIsoBuffer, isoPtr, bufferSize](FRHICommandListImmediate& RHICmdList)
-            {
-                void* LockedData = RHICmdList.LockBuffer(deltaIsoBuffer->buffer, 0, bufferSize * sizeof(float), RLM_WriteOnly);
-                FMemory::Memcpy(LockedData, isoPtr, bufferSize * sizeof(float));
-                RHICmdList.UnlockBuffer(deltaIsoBuffer->buffer);
-            });
+// The regions edited while it ran are relabelled as one batch, so a piece cut off before it was ready is reported now
+// rather than by whichever later edit happens to reach it
+bool Octree::FinishConnectivityBuild(bool bWait) {
+    if (connectivityBuild.IsValid()) {
+        if (!bWait && !connectivityBuild.IsCompleted()) return false;
+        connectivityBuild.Wait();
+        connectivityBuild = {};
+        connectivity = MoveTemp(pendingConnectivity);
+        for (const TPair<FIntVector, FIntVector>& region : pendingConnectivityRegions)
+            connectivity->MarkDirty(region.Key, region.Value);
+        TArray<VoxelSolidComponent> detached;
+        connectivity->Update(bPendingConnectivityRemovesSolid, detached);
+        AppendDetachedChunks(detached, parent ? parent->GetTransform() : FTransform::Identity);
+        pendingConnectivityRegions.Reset();
+        bPendingConnectivityRemovesSolid = false;
     }
-    bIsoValuesDirty = false;
+    return connectivity.IsValid();
 }
 
-int Octree::GetIsoValueFromIndex(FIntVector coord, int axisSize) {
+// A solid sample stands for the cell of one iso step around it
+void Octree::AppendDetachedChunks(TConstArrayView<VoxelSolidComponent> components, const FTransform& parentTransform) {
+    float isoScale = scale / isoValuesPerAxisMaxRes;
+    FVector minCorner = FVector(GetOctreePosition().X, GetOctreePosition().Y, GetOctreePosition().Z) - FVector(scale / 2.0);
+    FVector parentScale = parentTransform.GetScale3D();
+    float sampleVolume = isoScale * isoScale * isoScale * FMath::Abs(parentScale.X * parentScale.Y * parentScale.Z);
 
-    int maxIsoCount = (axisSize) * (axisSize) * (axisSize);
-    int index = coord.X + coord.Y * (axisSize)+coord.Z * (axisSize) * (axisSize);
-    return FMath::Max(0, FMath::Min(index, maxIsoCount + 1));
+    for (const VoxelSolidComponent& component : components) {
+        FBox localBounds(minCorner + (FVector(component.min) - 0.5) * isoScale, minCorner + (FVector(component.max) + 0.5) * isoScale);
+        detachedChunks.Add({ localBounds.TransformBy(parentTransform), component.sampleCount * sampleVolume, component.sampleCount });
+    }
 }
 
-bool Octree::ApplyDeformationAtPosition(FVector inPosition, float radius, float influence, uint32 paintType, bool additive, bool paintOnly) {
-    FTransform parentTransform = parent->GetTransform();
-    inPosition = parentTransform.InverseTransformPosition(inPosition);
+bool Octree::ApplyShapeDeformation(TSharedPtr<const VoxelSDFBrush> brush, FVector position, FQuat rotation, float influence, uint32 paintType, bool additive, bool paintOnly) {
+    VoxelEditCommand command;
+    if (!GetDeformationOp(additive, paintOnly, command.op)) return false;
+    command.shape = EVoxelEditShape::SDF;
+    command.position = position;
+    command.rotation = rotation;
+    command.sdfBrush = brush;
+    command.influence = influence;
+    command.paintType = paintType;
+
+    if (ApplyEditBatch(MakeArrayView(&command, 1)) == 0)
+        return false;
+    return bIsoValuesDirty;
+}
+
+bool Octree::MakeEditBrush(const VoxelEditCommand& command, const FTransform& parentTransform, EditBrush& outBrush) const {
+    if (command.shape == EVoxelEditShape::SDF && !command.IsFilter())
+        return MakeSDFEditBrush(command, parentTransform, outBrush);
 
     float ratio = scale / 2.0;
     FVector nodeCenter = FVector(GetOctreePosition().X, GetOctreePosition().Y, GetOctreePosition().Z);
@@ -320,77 +1208,673 @@ bool Octree::ApplyDeformationAtPosition(FVector inPosition, float radius, float
 
     FBox bounds = FBox();
     bounds = bounds.BuildAABB(nodeCenter, extent);
+    FVector position = parentTransform.InverseTransformPosition(command.position);
+    FVector sweepStart = command.shape == EVoxelEditShape::Capsule && !command.IsFilter() ? parentTransform.InverseTransformPosition(command.sweepStart) : position;
+    if (!bounds.IsInsideOrOnXY(position) && !bounds.IsInsideOrOnXY(sweepStart)) return false;
 
-    if (!bounds.IsInsideOrOnXY(inPosition))
-        return false;
+    float isoScale = scale / isoValuesPerAxisMaxRes;
+    outBrush.command = &command;
+    outBrush.center = (position - minCorner) / isoScale;
+    outBrush.sweepStart = (sweepStart - minCorner) / isoScale;
+    outBrush.sweepAxis = FVector3f(outBrush.center - outBrush.sweepStart);
+    float sweepLengthSquared = outBrush.sweepAxis.SizeSquared();
+    // A segment shorter than a hundredth of a sample is stamped as the sphere at its end
+    outBrush.bSwept = sweepLengthSquared > 1e-4f;
+    outBrush.invSweepLengthSquared = outBrush.bSwept ? 1.0f / sweepLengthSquared : 0.0f;
+    outBrush.isoRadius = command.radius / isoScale;
+    outBrush.invRadius = 1.0f / outBrush.isoRadius;
+    outBrush.signedInfluence = command.op == EVoxelEditOp::Add ? -command.influence : command.influence;
+    outBrush.sdf = nullptr;
+
+    FVector boundsMin = outBrush.bSwept ? outBrush.center.ComponentMin(outBrush.sweepStart) : outBrush.center;
+    FVector boundsMax = outBrush.bSwept ? outBrush.center.ComponentMax(outBrush.sweepStart) : outBrush.center;
+    outBrush.min = FIntVector(FMath::FloorToInt(boundsMin.X - outBrush.isoRadius), FMath::FloorToInt(boundsMin.Y - outBrush.isoRadius), FMath::FloorToInt(boundsMin.Z - outBrush.isoRadius));
+    outBrush.max = FIntVector(FMath::CeilToInt(boundsMax.X + outBrush.isoRadius), FMath::CeilToInt(boundsMax.Y + outBrush.isoRadius), FMath::CeilToInt(boundsMax.Z + outBrush.isoRadius));
+
+    // Filters read a kernel radius past what they write, edits there have to stay ordered with them
+    if (command.IsFilter()) {
+        outBrush.min -= FIntVector(GetSmoothKernelRadius());
+        outBrush.max += FIntVector(GetSmoothKernelRadius());
+    }
+    return true;
+}
+
+// The brush's bounds are taken into iso space and cut into bricks, and only bricks whose centre lies within half a brick
+// diagonal of the surface or inside it are kept. CSG of distance fields never changes faster than the distance
+// itself, so a brick whose centre is further out than that cannot hold a sample inside the brush.
+bool Octree::MakeSDFEditBrush(const VoxelEditCommand& command, const FTransform& parentTransform, EditBrush& outBrush) const {
+    if (!command.sdfBrush.IsValid() || command.sdfBrush->IsEmpty()) return false;
+    const VoxelSDFBrush& sdf = *command.sdfBrush;
 
+    float ratio = scale / 2.0;
+    FVector minCorner = FVector(GetOctreePosition().X, GetOctreePosition().Y, GetOctreePosition().Z) - FVector(ratio, ratio, ratio);
     float isoScale = scale / isoValuesPerAxisMaxRes;
-    float isoRadius = radius / isoScale;
-    FVector localInPosition = (inPosition - minCorner) / isoScale;
-
-    int zMin = FMath::FloorToInt(localInPosition.Z - isoRadius);
-    int zMax = FMath::CeilToInt(localInPosition.Z + isoRadius);
-    int yMin = FMath::FloorToInt(localInPosition.Y - isoRadius);
-    int yMax = FMath::CeilToInt(localInPosition.Y + isoRadius);
-    int xMin = FMath::FloorToInt(localInPosition.X - isoRadius);
-    int xMax = FMath::CeilToInt(localInPosition.X + isoRadius);
-
-    for (int dz = zMin; dz <= zMax; dz++) {
-        if (dz < 0 || dz >= isoValuesPerAxisMaxRes) continue;
-        for (int dy = yMin; dy <= yMax; dy++) {
-            if (dy < 0 || dy >= isoValuesPerAxisMaxRes) continue;
-            for (int dx = xMin; dx <= xMax; dx++) {
-                if (dx < 0 || dx >= isoValuesPerAxisMaxRes) continue;
-
-                int flatIndex = GetIsoValueFromIndex(FIntVector3(dx, dy, dz), isoValuesPerAxisMaxRes);
-
-                if (!paintOnly) {
-                    float innitIsoValue = deltaIsoArray[flatIndex];
-                    float modifiedIsoValue = innitIsoValue;
-
-                    float distance = FVector::Distance(FVector(dx, dy, dz), FVector(localInPosition.X, localInPosition.Y, localInPosition.Z));
-                    float t = FMath::Clamp(1.0f - (distance / isoRadius), 0.0f, 1.0f);
-                    float weightedInfluence = influence * t * t;
-
-                    additive ? modifiedIsoValue -= weightedInfluence : modifiedIsoValue += weightedInfluence;
-                    modifiedIsoValue = FMath::Clamp(modifiedIsoValue, -1.0f, 1.0f);
-
-                    if (innitIsoValue != modifiedIsoValue) {
-                        deltaIsoArray[flatIndex] = modifiedIsoValue;
-                        bIsoValuesDirty = true;
+    int axis = isoValuesPerAxisMaxRes;
+
+    FTransform brushTransform(command.rotation, command.position);
+    auto ToBrushSpace = [&](const FVector& sample) {
+        return brushTransform.InverseTransformPosition(parentTransform.TransformPosition(minCorner + sample * isoScale));
+    };
+    FVector origin = ToBrushSpace(FVector::ZeroVector);
+    outBrush.sdfOrigin = FVector3f(origin);
+    outBrush.sdfStepX = FVector3f(ToBrushSpace(FVector(1.0, 0.0, 0.0)) - origin);
+    outBrush.sdfStepY = FVector3f(ToBrushSpace(FVector(0.0, 1.0, 0.0)) - origin);
+    outBrush.sdfStepZ = FVector3f(ToBrushSpace(FVector(0.0, 0.0, 1.0)) - origin);
+
+    FIntVector sampleMin(0);
+    FIntVector sampleMax(axis - 1);
+    FBox3f brushBounds;
+    if (sdf.GetBounds(brushBounds)) {
+        if (!brushBounds.IsValid) return false;
+        FBox treeBounds = FBox(brushBounds).TransformBy(brushTransform).InverseTransformBy(parentTransform);
+        FVector isoMin = (treeBounds.Min - minCorner) / isoScale;
+        FVector isoMax = (treeBounds.Max - minCorner) / isoScale;
+        sampleMin = sampleMin.ComponentMax(FIntVector(FMath::FloorToInt(isoMin.X), FMath::FloorToInt(isoMin.Y), FMath::FloorToInt(isoMin.Z)));
+        sampleMax = sampleMax.ComponentMin(FIntVector(FMath::CeilToInt(isoMax.X), FMath::CeilToInt(isoMax.Y), FMath::CeilToInt(isoMax.Z)));
+        if (sampleMin.X > sampleMax.X || sampleMin.Y > sampleMax.Y || sampleMin.Z > sampleMax.Z) return false;
+    }
+
+    outBrush.brickMin = sampleMin / EditBrickSize;
+    outBrush.brickCount = sampleMax / EditBrickSize - outBrush.brickMin + FIntVector(1);
+    outBrush.activeBricks.Init(false, outBrush.brickCount.X * outBrush.brickCount.Y * outBrush.brickCount.Z);
+    float stepLength = FMath::Max3(outBrush.sdfStepX.Size(), outBrush.sdfStepY.Size(), outBrush.sdfStepZ.Size());
+    float halfDiagonal = (EditBrickSize - 1) * 0.5f * UE_SQRT_3 * stepLength;
+    float brickCenterOffset = (EditBrickSize - 1) * 0.5f;
+
+    FIntVector activeMin(MAX_int32);
+    FIntVector activeMax(MIN_int32);
+    int32 bit = 0;
+    for (int32 bz = 0; bz < outBrush.brickCount.Z; bz++) {
+        for (int32 by = 0; by < outBrush.brickCount.Y; by++) {
+            for (int32 bx = 0; bx < outBrush.brickCount.X; bx++, bit++) {
+                FIntVector brickStart = (outBrush.brickMin + FIntVector(bx, by, bz)) * EditBrickSize;
+                FVector3f brickCenter = outBrush.sdfOrigin
+                    + outBrush.sdfStepX * (brickStart.X + brickCenterOffset)
+                    + outBrush.sdfStepY * (brickStart.Y + brickCenterOffset)
+                    + outBrush.sdfStepZ * (brickStart.Z + brickCenterOffset);
+                if (sdf.Evaluate(brickCenter) >= halfDiagonal) continue;
+
+                outBrush.activeBricks[bit] = true;
+                activeMin = activeMin.ComponentMin(brickStart.ComponentMax(sampleMin));
+                activeMax = activeMax.ComponentMax((brickStart + FIntVector(EditBrickSize - 1)).ComponentMin(sampleMax));
+            }
+        }
+    }
+    if (activeMin.X > activeMax.X) return false;
+
+    outBrush.command = &command;
+    outBrush.sdf = &sdf;
+    outBrush.invFalloff = 1.0f / FMath::Max(sdf.falloff, UE_KINDA_SMALL_NUMBER);
+    outBrush.signedInfluence = command.op == EVoxelEditOp::Add ? -command.influence : command.influence;
+    outBrush.bSwept = false;
+    outBrush.min = activeMin;
+    outBrush.max = activeMax;
+    outBrush.center = FVector(activeMin + activeMax) * 0.5;
+    return true;
+}
+
+// Evaluates the brush over the runs of active bricks along one row and applies it from the distances
+void Octree::ApplySDFBrushRow(const EditBrush& brush, int dy, int dz, int32 xMin, int32 xMax, float* isoRow, uint32* typeRow, float* distances, bool& outIsoEdited, bool& outTypeEdited) {
+    int32 brickY = dy / EditBrickSize - brush.brickMin.Y;
+    int32 brickZ = dz / EditBrickSize - brush.brickMin.Z;
+    if (brickY < 0 || brickY >= brush.brickCount.Y || brickZ < 0 || brickZ >= brush.brickCount.Z) return;
+
+    const VoxelEditCommand& command = *brush.command;
+    int32 rowBricks = brush.brickCount.X * (brickY + brush.brickCount.Y * brickZ);
+    FVector3f rowStart = brush.sdfOrigin + brush.sdfStepY * dy + brush.sdfStepZ * dz;
+    for (int32 brickX = 0; brickX < brush.brickCount.X; brickX++) {
+        if (!brush.activeBricks[rowBricks + brickX]) continue;
+        int32 runEnd = brickX;
+        while (runEnd + 1 < brush.brickCount.X && brush.activeBricks[rowBricks + runEnd + 1])
+            runEnd++;
+        int32 runMin = FMath::Max(xMin, (brush.brickMin.X + brickX) * EditBrickSize);
+        int32 runMax = FMath::Min(xMax, (brush.brickMin.X + runEnd + 1) * EditBrickSize - 1);
+        brickX = runEnd;
+        if (runMin > runMax) continue;
+
+        int32 count = runMax - runMin + 1;
+        brush.sdf->EvaluateRow(distances, count, rowStart + brush.sdfStepX * runMin, brush.sdfStepX);
+        if (command.WritesIso() && VoxelBrushKernel::ApplyDistanceIsoRow(isoRow + runMin, distances, count, brush.invFalloff, brush.signedInfluence))
+            outIsoEdited = true;
+        if (command.WritesType() && VoxelBrushKernel::FillTypeRowInside(typeRow + runMin, distances, count, command.paintType))
+            outTypeEdited = true;
+    }
+}
+
+// The x range of row (dy, dz) that can lie inside a capsule: the stretch of the segment whose yz distance to the row is
+// within the radius, widened by the radius. Conservative, samples in it but outside the capsule get no iso weight,
+// and swept paint covers it rather than the capsule's whole box.
+bool Octree::GetSweepRowRange(const EditBrush& brush, int dy, int dz, int32& outMin, int32& outMax) {
+    float offsetY = brush.sweepStart.Y - dy;
+    float offsetZ = brush.sweepStart.Z - dz;
+    float a = brush.sweepAxis.Y * brush.sweepAxis.Y + brush.sweepAxis.Z * brush.sweepAxis.Z;
+    float b = offsetY * brush.sweepAxis.Y + offsetZ * brush.sweepAxis.Z;
+    float c = offsetY * offsetY + offsetZ * offsetZ - brush.isoRadius * brush.isoRadius;
+
+    float tMin = 0.0f;
+    float tMax = 1.0f;
+    if (a < KINDA_SMALL_NUMBER) {
+        if (c > 0.0f) return false;
+    }
+    else {
+        float discriminant = b * b - a * c;
+        if (discriminant < 0.0f) return false;
+        float root = FMath::Sqrt(discriminant);
+        tMin = FMath::Max((-b - root) / a, 0.0f);
+        tMax = FMath::Min((-b + root) / a, 1.0f);
+        if (tMin > tMax) return false;
+    }
+
+    float xA = brush.sweepStart.X + brush.sweepAxis.X * tMin;
+    float xB = brush.sweepStart.X + brush.sweepAxis.X * tMax;
+    outMin = FMath::FloorToInt(FMath::Min(xA, xB) - brush.isoRadius);
+    outMax = FMath::CeilToInt(FMath::Max(xA, xB) + brush.isoRadius);
+    return true;
+}
+
+// Times one sphere and one capsule ending at the centre of the tree for each radius through the per sample
+// reference, the row kernel on one thread and the row kernel across z slices. The delta grid is restored after every run, so the world is untouched.
+void Octree::BenchmarkBrushKernel(TConstArrayView<float> radii, int32 iterations) {
+    TArray<float> savedIso = deltaIsoArray;
+    TArray<uint32> savedType = deltaTypeArray;
+    bool bSavedIsoDirty = bIsoValuesDirty;
+    bool bSavedTypeDirty = bTypeValuesDirty;
+    FTransform parentTransform = parent->GetTransform();
+    FVector3f center = GetOctreePosition();
+
+    for (int32 run = 0; run < radii.Num() * 2; run++) {
+        float radius = radii[run / 2];
+        bool bCapsule = run % 2 == 1;
+        VoxelEditCommand command;
+        command.op = EVoxelEditOp::Add;
+        command.shape = bCapsule ? EVoxelEditShape::Capsule : EVoxelEditShape::Sphere;
+        command.position = parentTransform.TransformPosition(FVector(center.X, center.Y, center.Z));
+        command.sweepStart = parentTransform.TransformPosition(FVector(center.X - radius * 2.0f, center.Y - radius, center.Z));
+        command.radius = radius;
+        command.influence = 0.01f;
+        command.paintType = 1;
+
+        EditBrush brush;
+        if (!MakeEditBrush(command, parentTransform, brush)) continue;
+        TArray<EditBrush> brushes = { brush };
+        EditCluster cluster = { brush.min, brush.max, { 0 } };
+
+        double seconds[3] = {};
+        TArray<float> resultIso[2];
+        for (int mode = 0; mode < 3; mode++) {
+            for (int32 i = 0; i < iterations; i++) {
+                bool bIso = false, bType = false;
+                double start = FPlatformTime::Seconds();
+                if (mode == 0) ApplyEditClusterReference(brushes, cluster, bIso, bType);
+                else ApplyEditCluster(brushes, cluster, bIso, bType, mode == 2);
+                seconds[mode] += FPlatformTime::Seconds() - start;
+            }
+            if (mode < 2) resultIso[mode] = deltaIsoArray;
+            deltaIsoArray = savedIso;
+            deltaTypeArray = savedType;
+        }
+
+        float maxError = 0.0f;
+        for (int32 i = 0; i < resultIso[0].Num(); i++)
+            maxError = FMath::Max(maxError, FMath::Abs(resultIso[0][i] - resultIso[1][i]));
+
+        FIntVector size = brush.max - brush.min + FIntVector(1);
+        UE_LOG(LogTemp, Log, TEXT("Voxel %s brush radius %.0f (%dx%dx%d samples): reference %.3f ms, SIMD %.3f ms, SIMD parallel %.3f ms, max error %g"),
+            bCapsule ? TEXT("capsule") : TEXT("sphere"), radius, size.X, size.Y, size.Z, seconds[0] * 1000.0 / iterations, seconds[1] * 1000.0 / iterations, seconds[2] * 1000.0 / iterations, maxError);
+    }
+    bIsoValuesDirty = bSavedIsoDirty;
+    bTypeValuesDirty = bSavedTypeDirty;
+}
+
+// Times smoothing a sphere of each radius at the centre of the tree: the naive neighbourhood sum, the separable filter
+// on one thread and across workers, and the whole smooth brush. The delta grid is restored afterwards.
+void Octree::BenchmarkFilterKernel(TConstArrayView<float> radii, int32 iterations) {
+    TArray<float> savedIso = deltaIsoArray;
+    bool bSavedIsoDirty = bIsoValuesDirty;
+    TArray<float, TInlineAllocator<17>> weights;
+    MakeSmoothWeights(weights);
+    FTransform parentTransform = parent->GetTransform();
+    FVector3f center = GetOctreePosition();
+
+    for (float radius : radii) {
+        VoxelEditCommand command;
+        command.op = EVoxelEditOp::Smooth;
+        command.position = parentTransform.TransformPosition(FVector(center.X, center.Y, center.Z));
+        command.radius = radius;
+        command.influence = 1.0f;
+
+        EditBrush brush;
+        if (!MakeEditBrush(command, parentTransform, brush)) continue;
+        int axis = isoValuesPerAxisMaxRes;
+        FIntVector regionMin = FIntVector(FMath::FloorToInt(brush.center.X - brush.isoRadius), FMath::FloorToInt(brush.center.Y - brush.isoRadius), FMath::FloorToInt(brush.center.Z - brush.isoRadius)).ComponentMax(FIntVector(0));
+        FIntVector regionMax = FIntVector(FMath::CeilToInt(brush.center.X + brush.isoRadius), FMath::CeilToInt(brush.center.Y + brush.isoRadius), FMath::CeilToInt(brush.center.Z + brush.isoRadius)).ComponentMin(FIntVector(axis - 1));
+
+        double seconds[4] = {};
+        TArray<float> filtered[3];
+        for (int mode = 0; mode < 4; mode++) {
+            for (int32 i = 0; i < iterations; i++) {
+                bool bIso = false;
+                double start = FPlatformTime::Seconds();
+                if (mode == 0) FilterIsoRegionReference(regionMin, regionMax, weights, filtered[mode]);
+                else if (mode < 3) FilterIsoRegion(regionMin, regionMax, weights, filtered[mode], mode == 2);
+                else ApplyFilterBrush(brush, bIso);
+                seconds[mode] += FPlatformTime::Seconds() - start;
+            }
+        }
+        deltaIsoArray = savedIso;
+
+        float maxError = 0.0f;
+        for (int32 i = 0; i < filtered[0].Num(); i++)
+            maxError = FMath::Max(maxError, FMath::Max(FMath::Abs(filtered[0][i] - filtered[1][i]), FMath::Abs(filtered[0][i] - filtered[2][i])));
+
+        FIntVector size = regionMax - regionMin + FIntVector(1);
+        UE_LOG(LogTemp, Log, TEXT("Voxel smooth radius %.0f (%dx%dx%d samples, %d taps): naive %.3f ms, separable %.3f ms, separable parallel %.3f ms, full brush %.3f ms, max error %g"),
+            radius, size.X, size.Y, size.Z, weights.Num(), seconds[0] * 1000.0 / iterations, seconds[1] * 1000.0 / iterations,
+            seconds[2] * 1000.0 / iterations, seconds[3] * 1000.0 / iterations, maxError);
+    }
+    bIsoValuesDirty = bSavedIsoDirty;
+}
+
+// Times keeping connectivity up to date after carving a sphere of each radius into the surface straight up from the
+// centre of the grid, against labelling the whole grid again. Densities and connectivity are restored every iteration.
+void Octree::BenchmarkConnectivity(TConstArrayView<float> radii, int32 iterations) {
+    if (!FinishConnectivityBuild(true))
+        connectivity = MakeUnique<VoxelConnectivity>(initIsoArray, deltaIsoArray, isoValuesPerAxisMaxRes, isoLevel);
+    TArray<float> savedIso = deltaIsoArray;
+    TArray<uint32> savedType = deltaTypeArray;
+    bool bSavedIsoDirty = bIsoValuesDirty;
+    bool bSavedTypeDirty = bTypeValuesDirty;
+    FTransform parentTransform = parent->GetTransform();
+
+    double buildStart = FPlatformTime::Seconds();
+    connectivity->Build();
+    double buildSeconds = FPlatformTime::Seconds() - buildStart;
+
+    int axis = isoValuesPerAxisMaxRes;
+    int centre = axis / 2;
+    int surface = centre;
+    while (surface < axis - 1 && GetCombinedIso(centre + centre * axis + surface * axis * axis) < isoLevel)
+        surface++;
+    float isoScale = scale / axis;
+    FVector minCorner = FVector(GetOctreePosition().X, GetOctreePosition().Y, GetOctreePosition().Z) - FVector(scale / 2.0);
+    FVector surfacePosition = parentTransform.TransformPosition(minCorner + FVector(centre, centre, surface) * isoScale);
+
+    for (float radius : radii) {
+        VoxelEditCommand command;
+        command.op = EVoxelEditOp::Subtract;
+        command.position = surfacePosition;
+        command.radius = radius;
+        command.influence = 1.0f;
+
+        EditBrush brush;
+        if (!MakeEditBrush(command, parentTransform, brush)) continue;
+        TArray<EditBrush> brushes = { brush };
+        EditCluster cluster = { brush.min, brush.max, { 0 } };
+
+        double seconds = 0.0;
+        int32 relabelled = 0, searched = 0, detachedCount = 0;
+        TArray<VoxelSolidComponent> detached;
+        for (int32 i = 0; i < iterations; i++) {
+            bool bIso = false, bType = false;
+            ApplyEditCluster(brushes, cluster, bIso, bType);
+            connectivity->MarkDirty(cluster.min, cluster.max);
+            detached.Reset();
+            double start = FPlatformTime::Seconds();
+            connectivity->Update(true, detached);
+            seconds += FPlatformTime::Seconds() - start;
+            relabelled = connectivity->GetLastRelabelledBricks();
+            searched = connectivity->GetLastSearchedNodes();
+            detachedCount = detached.Num();
+
+            deltaIsoArray = savedIso;
+            deltaTypeArray = savedType;
+            connectivity->MarkDirty(cluster.min, cluster.max);
+            connectivity->Update(false, detached);
+        }
+
+        UE_LOG(LogTemp, Log, TEXT("Voxel connectivity carve radius %.0f: update %.3f ms (%d bricks relabelled, %d graph nodes searched, %d detached), full relabel %.3f ms over %d bricks"),
+            radius, seconds * 1000.0 / iterations, relabelled, searched, detachedCount,
+            buildSeconds * 1000.0, connectivity->GetBrickCount());
+    }
+    bIsoValuesDirty = bSavedIsoDirty;
+    bTypeValuesDirty = bSavedTypeDirty;
+}
+
+// Clusters are clipped to the grid and applied a row at a time, every brush of the cluster in command order while the
+// row is in cache. Large clusters are split across z slices, slices never share a sample.
+void Octree::ApplyEditCluster(const TArray<EditBrush>& brushes, const EditCluster& cluster, bool& outIsoEdited, bool& outTypeEdited, bool bAllowParallel) {
+    int axis = isoValuesPerAxisMaxRes;
+    FIntVector regionMin = cluster.min.ComponentMax(FIntVector(0));
+    FIntVector regionMax = cluster.max.ComponentMin(FIntVector(axis - 1));
+    if (regionMin.X > regionMax.X || regionMin.Y > regionMax.Y || regionMin.Z > regionMax.Z) return;
+
+    enum : uint8 { IsoEdited = 1, TypeEdited = 2 };
+    int32 sliceCount = regionMax.Z - regionMin.Z + 1;
+    TArray<uint8, TInlineAllocator<64>> sliceEdits;
+    sliceEdits.SetNumZeroed(sliceCount);
+
+    auto ApplySlice = [&](int32 slice) {
+        int dz = regionMin.Z + slice;
+        uint8 edits = 0;
+        TArray<float, TInlineAllocator<256>> rowDistances;
+        for (int dy = regionMin.Y; dy <= regionMax.Y; dy++) {
+            int32 rowStart = (dy * axis) + (dz * axis * axis);
+            float* isoRow = deltaIsoArray.GetData() + rowStart;
+            uint32* typeRow = deltaTypeArray.GetData() + rowStart;
+
+            for (int32 brushIndex : cluster.brushes) {
+                const EditBrush& brush = brushes[brushIndex];
+                if (dy < brush.min.Y || dy > brush.max.Y || dz < brush.min.Z || dz > brush.max.Z) continue;
+                int32 xMin = FMath::Max(brush.min.X, regionMin.X);
+                int32 xMax = FMath::Min(brush.max.X, regionMax.X);
+                if (xMin > xMax) continue;
+
+                // Samples outside the sphere get no weight, so the row is cut down to the sphere's chord
+                const VoxelEditCommand& command = *brush.command;
+                if (brush.sdf) {
+                    if (rowDistances.Num() == 0)
+                        rowDistances.SetNumUninitialized(regionMax.X - regionMin.X + 1);
+                    bool bIsoEdited = false;
+                    bool bTypeEdited = false;
+                    ApplySDFBrushRow(brush, dy, dz, xMin, xMax, isoRow, typeRow, rowDistances.GetData(), bIsoEdited, bTypeEdited);
+                    edits |= (bIsoEdited ? IsoEdited : 0) | (bTypeEdited ? TypeEdited : 0);
+                    continue;
+                }
+                if (brush.bSwept) {
+                    int32 sweepMin, sweepMax;
+                    if (!GetSweepRowRange(brush, dy, dz, sweepMin, sweepMax)) continue;
+                    xMin = FMath::Max(xMin, sweepMin);
+                    xMax = FMath::Min(xMax, sweepMax);
+                    if (xMin > xMax) continue;
+                    if (command.WritesIso() && VoxelBrushKernel::ApplyCapsuleIsoRow(isoRow, xMin, xMax, brush.sweepStart.X, dy - brush.sweepStart.Y, dz - brush.sweepStart.Z,
+                        brush.sweepAxis, brush.invSweepLengthSquared, brush.invRadius, brush.signedInfluence))
+                        edits |= IsoEdited;
+                    if (command.WritesType() && VoxelBrushKernel::FillTypeRow(typeRow, xMin, xMax, command.paintType))
+                        edits |= TypeEdited;
+                    continue;
+                }
+
+                float distanceY = dy - brush.center.Y;
+                float distanceZ = dz - brush.center.Z;
+                float distanceYZSquared = distanceY * distanceY + distanceZ * distanceZ;
+                float radiusSquared = brush.isoRadius * brush.isoRadius;
+                if (command.WritesIso() && distanceYZSquared < radiusSquared) {
+                    float halfChord = FMath::Sqrt(radiusSquared - distanceYZSquared);
+                    int32 chordMin = FMath::Max(xMin, FMath::CeilToInt(brush.center.X - halfChord));
+                    int32 chordMax = FMath::Min(xMax, FMath::FloorToInt(brush.center.X + halfChord));
+                    if (chordMin <= chordMax && VoxelBrushKernel::ApplySphereIsoRow(isoRow, chordMin, chordMax, brush.center.X, distanceYZSquared, brush.invRadius, brush.signedInfluence))
+                        edits |= IsoEdited;
+                }
+                if (command.WritesType() && VoxelBrushKernel::FillTypeRow(typeRow, xMin, xMax, command.paintType))
+                    edits |= TypeEdited;
+            }
+        }
+        sliceEdits[slice] = edits;
+    };
+
+    int64 sampleCount = (int64)sliceCount * (regionMax.Y - regionMin.Y + 1) * (regionMax.X - regionMin.X + 1);
+    bool bParallel = bAllowParallel && sliceCount > 1 && sampleCount >= CVarParallelEditSamples.GetValueOnAnyThread();
+    ParallelFor(sliceCount, ApplySlice, !bParallel);
+
+    uint8 edits = 0;
+    for (uint8 sliceEdit : sliceEdits)
+        edits |= sliceEdit;
+    if (edits & IsoEdited) {
+        bIsoValuesDirty = true;
+        outIsoEdited = true;
+    }
+    if (edits & TypeEdited) {
+        bTypeValuesDirty = true;
+        outTypeEdited = true;
+    }
+}
+
+// Filters read their neighbourhood, so they cannot share the row pass with the brushes around them. The brushes
+// between two filters still go through it together, and everything is applied in command order.
+void Octree::ApplyEditClusterInOrder(const TArray<EditBrush>& brushes, const EditCluster& cluster, bool& outIsoEdited, bool& outTypeEdited) {
+    if (!cluster.brushes.ContainsByPredicate([&](int32 brushIndex) { return brushes[brushIndex].command->IsFilter(); })) {
+        ApplyEditCluster(brushes, cluster, outIsoEdited, outTypeEdited);
+        return;
+    }
+
+    EditCluster run = { FIntVector(MAX_int32), FIntVector(MIN_int32), {} };
+    auto FlushRun = [&]() {
+        if (run.brushes.Num() == 0) return;
+        ApplyEditCluster(brushes, run, outIsoEdited, outTypeEdited);
+        run = { FIntVector(MAX_int32), FIntVector(MIN_int32), {} };
+    };
+    for (int32 brushIndex : cluster.brushes) {
+        const EditBrush& brush = brushes[brushIndex];
+        if (!brush.command->IsFilter()) {
+            run.min = run.min.ComponentMin(brush.min);
+            run.max = run.max.ComponentMax(brush.max);
+            run.brushes.Add(brushIndex);
+            continue;
+        }
+        FlushRun();
+        ApplyFilterBrush(brush, outIsoEdited);
+    }
+    FlushRun();
+}
+
+// Smooth blends the combined density inside the sphere towards its blurred self, flatten towards a plane through the
+// brush centre facing away from the centre of the grid, crossing the iso level on the plane. Both use the sphere
+// falloff, and the target is computed for the whole region before any sample is written.
+void Octree::ApplyFilterBrush(const EditBrush& brush, bool& outIsoEdited, bool bAllowParallel) {
+    int axis = isoValuesPerAxisMaxRes;
+    const VoxelEditCommand& command = *brush.command;
+    FVector center = brush.center;
+    float radius = brush.isoRadius;
+    FIntVector regionMin = FIntVector(FMath::FloorToInt(center.X - radius), FMath::FloorToInt(center.Y - radius), FMath::FloorToInt(center.Z - radius)).ComponentMax(FIntVector(0));
+    FIntVector regionMax = FIntVector(FMath::CeilToInt(center.X + radius), FMath::CeilToInt(center.Y + radius), FMath::CeilToInt(center.Z + radius)).ComponentMin(FIntVector(axis - 1));
+    if (regionMin.X > regionMax.X || regionMin.Y > regionMax.Y || regionMin.Z > regionMax.Z) return;
+    FIntVector regionSize = regionMax - regionMin + FIntVector(1);
+
+    TArray<float> filtered;
+    if (command.op == EVoxelEditOp::Smooth) {
+        TArray<float, TInlineAllocator<17>> weights;
+        MakeSmoothWeights(weights);
+        FilterIsoRegion(regionMin, regionMax, weights, filtered, bAllowParallel);
+    }
+
+    FVector3f up = FVector3f(center - FVector((axis - 1) * 0.5)).GetSafeNormal();
+    if (up.IsZero()) up = FVector3f::UpVector;
+    float strength = FMath::Min(command.influence, 1.0f);
+    float radiusSquared = radius * radius;
+
+    TArray<uint8, TInlineAllocator<64>> sliceEdits;
+    sliceEdits.SetNumZeroed(regionSize.Z);
+    auto BlendSlice = [&](int32 slice) {
+        int dz = regionMin.Z + slice;
+        TArray<float, TInlineAllocator<256>> planeRow;
+        for (int dy = regionMin.Y; dy <= regionMax.Y; dy++) {
+            float distanceY = dy - center.Y;
+            float distanceZ = dz - center.Z;
+            float distanceYZSquared = distanceY * distanceY + distanceZ * distanceZ;
+            if (distanceYZSquared >= radiusSquared) continue;
+            float halfChord = FMath::Sqrt(radiusSquared - distanceYZSquared);
+            int32 chordMin = FMath::Max(regionMin.X, FMath::CeilToInt(center.X - halfChord));
+            int32 chordMax = FMath::Min(regionMax.X, FMath::FloorToInt(center.X + halfChord));
+            if (chordMin > chordMax) continue;
+
+            const float* targetRow;
+            if (command.op == EVoxelEditOp::Smooth)
+                targetRow = filtered.GetData() + (chordMin - regionMin.X) + regionSize.X * ((dy - regionMin.Y) + regionSize.Y * slice);
+            else {
+                planeRow.SetNumUninitialized(chordMax - chordMin + 1, EAllowShrinking::No);
+                float height = (chordMin - center.X) * up.X + distanceY * up.Y + distanceZ * up.Z;
+                for (int32 i = 0; i < planeRow.Num(); i++)
+                    planeRow[i] = FMath::Clamp(isoLevel + (height + i * up.X) * FlattenSlope, 0.0f, 1.0f);
+                targetRow = planeRow.GetData();
+            }
+
+            int32 rowStart = (dy * axis) + (dz * axis * axis);
+            if (VoxelBrushKernel::BlendSphereIsoRow(deltaIsoArray.GetData() + rowStart, initIsoArray.GetData() + rowStart, targetRow,
+                chordMin, chordMax, center.X, distanceYZSquared, brush.invRadius, strength))
+                sliceEdits[slice] = 1;
+        }
+    };
+
+    int64 sampleCount = (int64)regionSize.X * regionSize.Y * regionSize.Z;
+    bool bParallel = bAllowParallel && regionSize.Z > 1 && sampleCount >= CVarParallelEditSamples.GetValueOnAnyThread();
+    ParallelFor(regionSize.Z, BlendSlice, !bParallel);
+
+    if (sliceEdits.Contains(1)) {
+        bIsoValuesDirty = true;
+        outIsoEdited = true;
+    }
+}
+
+// Blurs the combined density over the region with the separable kernel. Each tile loads itself and a halo of the
+// kernel radius into its worker's scratch brick, clamped to the grid edge, then runs the x, y and z passes in turn,
+// each pass dropping the halo of its own axis. Four outputs are computed per step in every pass, as rows are
+// contiguous in x whichever axis the taps run along.
+void Octree::FilterIsoRegion(const FIntVector& regionMin, const FIntVector& regionMax, TConstArrayView<float> weights, TArray<float>& outFiltered, bool bAllowParallel) const {
+    int axis = isoValuesPerAxisMaxRes;
+    int32 halo = (weights.Num() - 1) / 2;
+    FIntVector regionSize = regionMax - regionMin + FIntVector(1);
+    FIntVector tileCount = (regionSize + FIntVector(FilterTileSize - 1)) / FilterTileSize;
+    int32 tileTotal = tileCount.X * tileCount.Y * tileCount.Z;
+    outFiltered.SetNumUninitialized(regionSize.X * regionSize.Y * regionSize.Z);
+
+    TArray<FilterScratch> scratches;
+    ParallelForWithTaskContext(scratches, tileTotal, [&](FilterScratch& scratch, int32 tileIndex) {
+        FIntVector tile(tileIndex % tileCount.X, (tileIndex / tileCount.X) % tileCount.Y, tileIndex / (tileCount.X * tileCount.Y));
+        FIntVector tileMin = regionMin + tile * FilterTileSize;
+        FIntVector tileSize = (regionMax - tileMin + FIntVector(1)).ComponentMin(FIntVector(FilterTileSize));
+        FIntVector extent = tileSize + FIntVector(halo * 2);
+        int32 pitch = extent.X;
+        int32 slice = extent.X * extent.Y;
+        scratch.source.SetNumUninitialized(slice * extent.Z, EAllowShrinking::No);
+        scratch.target.SetNumUninitialized(slice * extent.Z, EAllowShrinking::No);
+        float* source = scratch.source.GetData();
+        float* target = scratch.target.GetData();
+
+        for (int32 z = 0; z < extent.Z; z++) {
+            int32 gridZ = FMath::Clamp(tileMin.Z - halo + z, 0, axis - 1);
+            for (int32 y = 0; y < extent.Y; y++) {
+                int32 gridY = FMath::Clamp(tileMin.Y - halo + y, 0, axis - 1);
+                int32 gridRow = (gridY * axis) + (gridZ * axis * axis);
+                float* row = source + y * pitch + z * slice;
+                for (int32 x = 0; x < extent.X; x++)
+                    row[x] = GetCombinedIso(gridRow + FMath::Clamp(tileMin.X - halo + x, 0, axis - 1));
+            }
+        }
+
+        for (int32 z = 0; z < extent.Z; z++)
+            for (int32 y = 0; y < extent.Y; y++)
+                VoxelBrushKernel::ConvolveRow(source + y * pitch + z * slice, target + y * pitch + z * slice, tileSize.X, 1, weights);
+        for (int32 z = 0; z < extent.Z; z++)
+            for (int32 y = 0; y < tileSize.Y; y++)
+                VoxelBrushKernel::ConvolveRow(target + y * pitch + z * slice, source + y * pitch + z * slice, tileSize.X, pitch, weights);
+        for (int32 z = 0; z < tileSize.Z; z++)
+            for (int32 y = 0; y < tileSize.Y; y++)
+                VoxelBrushKernel::ConvolveRow(source + y * pitch + z * slice, target + y * pitch + z * slice, tileSize.X, slice, weights);
+
+        FIntVector offset = tileMin - regionMin;
+        for (int32 z = 0; z < tileSize.Z; z++) {
+            for (int32 y = 0; y < tileSize.Y; y++) {
+                float* output = outFiltered.GetData() + offset.X + regionSize.X * ((offset.Y + y) + regionSize.Y * (offset.Z + z));
+                FMemory::Memcpy(output, target + y * pitch + z * slice, tileSize.X * sizeof(float));
+            }
+        }
+    }, bAllowParallel && tileTotal > 1 ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+}
+
+// The same blur as a full 3D neighbourhood sum per sample, kept as the baseline for voxel.BenchmarkSmooth
+void Octree::FilterIsoRegionReference(const FIntVector& regionMin, const FIntVector& regionMax, TConstArrayView<float> weights, TArray<float>& outFiltered) const {
+    int axis = isoValuesPerAxisMaxRes;
+    int32 halo = (weights.Num() - 1) / 2;
+    FIntVector regionSize = regionMax - regionMin + FIntVector(1);
+    outFiltered.SetNumUninitialized(regionSize.X * regionSize.Y * regionSize.Z);
+
+    int32 index = 0;
+    for (int dz = regionMin.Z; dz <= regionMax.Z; dz++) {
+        for (int dy = regionMin.Y; dy <= regionMax.Y; dy++) {
+            for (int dx = regionMin.X; dx <= regionMax.X; dx++, index++) {
+                float sum = 0.0f;
+                for (int32 k = 0; k < weights.Num(); k++) {
+                    int32 z = FMath::Clamp(dz + k - halo, 0, axis - 1);
+                    for (int32 j = 0; j < weights.Num(); j++) {
+                        int32 y = FMath::Clamp(dy + j - halo, 0, axis - 1);
+                        for (int32 i = 0; i < weights.Num(); i++) {
+                            int32 x = FMath::Clamp(dx + i - halo, 0, axis - 1);
+                            sum += weights[i] * weights[j] * weights[k] * GetCombinedIso(x + (y * axis) + (z * axis * axis));
+                        }
                     }
                 }
+                outFiltered[index] = sum;
+            }
+        }
+    }
+}
 
-                uint32 innitType = deltaTypeArray[flatIndex];
-                uint32 modifiedType = additive ? paintType : innitType;
+// Per sample form of ApplyEditCluster, kept as the baseline for voxel.BenchmarkBrush
+void Octree::ApplyEditClusterReference(const TArray<EditBrush>& brushes, const EditCluster& cluster, bool& outIsoEdited, bool& outTypeEdited) {
+    int axis = isoValuesPerAxisMaxRes;
+    FIntVector regionMin = cluster.min.ComponentMax(FIntVector(0));
+    FIntVector regionMax = cluster.max.ComponentMin(FIntVector(axis - 1));
+
+    for (int dz = regionMin.Z; dz <= regionMax.Z; dz++) {
+        for (int dy = regionMin.Y; dy <= regionMax.Y; dy++) {
+            for (int dx = regionMin.X; dx <= regionMax.X; dx++) {
+                int flatIndex = dx + (dy * axis) + (dz * axis * axis);
+                float isoValue = deltaIsoArray[flatIndex];
+                uint32 typeValue = deltaTypeArray[flatIndex];
+
+                for (int32 brushIndex : cluster.brushes) {
+                    const EditBrush& brush = brushes[brushIndex];
+                    if (dx < brush.min.X || dx > brush.max.X || dy < brush.min.Y || dy > brush.max.Y || dz < brush.min.Z || dz > brush.max.Z) continue;
+
+                    const VoxelEditCommand& command = *brush.command;
+                    if (brush.sdf) {
+                        float distance = brush.sdf->Evaluate(brush.sdfOrigin + brush.sdfStepX * dx + brush.sdfStepY * dy + brush.sdfStepZ * dz);
+                        if (command.WritesIso()) {
+                            float t = FMath::Clamp(-distance * brush.invFalloff, 0.0f, 1.0f);
+                            isoValue = FMath::Clamp(isoValue + brush.signedInfluence * t * t, -1.0f, 1.0f);
+                        }
+                        if (command.WritesType() && distance <= 0.0f)
+                            typeValue = command.paintType;
+                        continue;
+                    }
+                    int32 sweepMin, sweepMax;
+                    if (brush.bSwept && (!GetSweepRowRange(brush, dy, dz, sweepMin, sweepMax) || dx < sweepMin || dx > sweepMax)) continue;
+                    if (command.WritesIso()) {
+                        float distance = brush.bSwept
+                            ? FMath::PointDistToSegment(FVector(dx, dy, dz), brush.sweepStart, brush.center)
+                            : FVector::Distance(FVector(dx, dy, dz), brush.center);
+                        float t = FMath::Clamp(1.0f - (distance / brush.isoRadius), 0.0f, 1.0f);
+                        float weightedInfluence = command.influence * t * t;
+                        isoValue = command.op == EVoxelEditOp::Add ? isoValue - weightedInfluence : isoValue + weightedInfluence;
+                        isoValue = FMath::Clamp(isoValue, -1.0f, 1.0f);
+                    }
+                    if (command.WritesType())
+                        typeValue = command.paintType;
+                }
 
-                if (innitType != modifiedType) {
+                if (isoValue != deltaIsoArray[flatIndex]) {
+                    deltaIsoArray[flatIndex] = isoValue;
+                    bIsoValuesDirty = true;
+                    outIsoEdited = true;
+                }
+                if (typeValue != deltaTypeArray[flatIndex]) {
+                    deltaTypeArray[flatIndex] = typeValue;
                     bTypeValuesDirty = true;
-                    deltaTypeArray[flatIndex] = modifiedType;
+                    outTypeEdited = true;
                 }
             }
         }
     }
-
-    return bIsoValuesDirty;
 }
 
 void Octree::DebugOctreeNodes(UWorld* world) {
     FTransform parentTransform = parent->GetTransform();
     FQuat rotator = FQuat(parentTransform.GetRotation());
-    DebugOctreeNodesRecursive(root, world, rotator, parentTransform);
-}
 
-void Octree::DebugOctreeNodesRecursive(OctreeNode* node, UWorld* world, FQuat rotator, FTransform parentTransform) {
-    if (!node) return;
-
-    if (node->IsVisible()) {
-        AABB bounds = node->GetBounds();
+    for (int32 i = 0; i < nodeKeys.Num(); i++) {
+        if (!IsNodeVisible(i)) continue;
+        AABB bounds = GetNodeBounds(i);
         FVector worldPosition = parentTransform.TransformPosition(FVector(bounds.Center()));
         DrawDebugBox(world, worldPosition, FVector(bounds.Extent()), rotator, FColor::Green, false, -1.f, 0, 1.f);
     }
-
-    for (int i = 0; i < 8; ++i)
-        DebugOctreeNodesRecursive(node->children[i], world, rotator, parentTransform);
-}
-
+}
\ No newline at end of file
@@ -1,135 +1,103 @@
 #include "OctreeNode.h"
 #include "OctreeModule.h"
+#include "Octree.h"
+#include "VoxelResourcePool.h"
 
 OctreeNode::OctreeNode() :
-    neighbours{ nullptr, nullptr, nullptr, nullptr, nullptr,nullptr }, depth(0), voxelsPerAxis(0), treeActor(nullptr),
-    parent(nullptr), isLeaf(true), isVisible(false), isRoot(false), bounds(AABB()),
-    regularCell(RegularCell(0)) {}
-
-OctreeNode::OctreeNode(AActor* inTreeActor, OctreeNode* inParent, const AABB& inBounds, uint32 bufferSize, uint32 inVoxelsPerAxis, int inDepth, int maxDepth, bool bInIsRoot) :
-    neighbours{ nullptr, nullptr, nullptr, nullptr, nullptr,nullptr }, depth(inDepth), voxelsPerAxis(inVoxelsPerAxis), treeActor(inTreeActor),
-    parent(inParent), isLeaf(true), isVisible(false), isRoot(bInIsRoot), bounds(inBounds), regularCell(RegularCell(bufferSize))
-{
-    vertexFactory = MakeShareable(new FVoxelVertexFactory(bufferSize));
-    regularCell = RegularCell(bufferSize);
-    uint32 vertexBufferSize = ((voxelsPerAxis * voxelsPerAxis * voxelsPerAxis) * 15) + (3 * (voxelsPerAxis * voxelsPerAxis * 36));
+    tree(nullptr), index(INDEX_NONE), isResident(false) {}
+
+// Resources are handed back to the tree's pool and released in one batch by Octree::Release
+OctreeNode::~OctreeNode() {
+    check(!renderResources.IsValid());
+}
+
+void OctreeNode::Bind(Octree* inTree, int32 inIndex) {
+    tree = inTree;
+    index = inIndex;
+    isResident = false;
 
     for (int i = 0; i < 3; i++)
         transitonCells[i] = TransitionCell();
-    
-    ENQUEUE_RENDER_COMMAND(InitVoxelResources)(
-        [this, bufferSize, vertexBufferSize](FRHICommandListImmediate& RHICmdList)
-        {
-            vertexFactory->Initialize(vertexBufferSize);
-            regularCell.Initialize(bufferSize);
-        });
-
-    for (int i = 0; i < 8; ++i)
-        children[i] = nullptr;
-
-    if (inDepth < maxDepth)
-        Subdivide(inDepth, maxDepth, bufferSize);
 }
 
- OctreeNode::~OctreeNode() {
-    Release();
-    FlushRenderingCommands();
-
-    vertexFactory.Reset();
-    regularCell.ResetResources();
-
-    for (int i = 0; i < 8; ++i) {
-        delete children[i];
-        children[i] = nullptr;
-    }
- }
-
- void OctreeNode::AssignChildNeighboursAsRoot() {
-     for (int i = 0; i < 8; ++i) {
-         OctreeNode* child = children[i];
-         OctreeNode* childNeighbours[6] = { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
-         FVector3f offset((i & 1 ? 1 : -1), (i & 2 ? 1 : -1), (i & 4 ? 1 : -1));
-
-         if (offset.X == 1) childNeighbours[0] = children[i ^ 1]; // sibling +X neighbor
-         else childNeighbours[0] = nullptr;
-
-         if (offset.X == -1) childNeighbours[1] = children[i ^ 1]; // sibling -X neighbor
-         else childNeighbours[1] = nullptr;
-
-         if (offset.Y == 1) childNeighbours[2] = children[i ^ 2]; // sibling +Y neighbor
-         else childNeighbours[2] = nullptr;
-
-         if (offset.Y == -1) childNeighbours[3] = children[i ^ 2]; // sibling -Y neighbor
-         else childNeighbours[3] = nullptr;
-
-         if (offset.Z == 1) childNeighbours[4] = children[i ^ 4]; // sibling +Z neighbor
-         else childNeighbours[4] = nullptr;
-
-         if (offset.Z == -1) childNeighbours[5] = children[i ^ 4]; // sibling -Z neighbor
-         else childNeighbours[5] = nullptr;
-
-         child->AssignChildNeighbours(childNeighbours);
-     }
- }
-
- void OctreeNode::AssignChildNeighbours(OctreeNode* inNeighbours[6]) {
-     for (int i = 0; i < 8; ++i) {
-         OctreeNode* child = children[i];
-         OctreeNode* childNeighbours[6] = {};
-         FVector3f offset((i & 1 ? 1 : -1), (i & 2 ? 1 : -1), (i & 4 ? 1 : -1));
-
-        // +X neighbor
-         if (offset.X == 1) childNeighbours[0] = children[i ^ 1];
-         else if (inNeighbours[0] && inNeighbours[0]->IsLeaf() == false) 
-             childNeighbours[0] = inNeighbours[0]->children[i ^ 1];
-        // -X neighbor
-         if (offset.X == -1) childNeighbours[1] = children[i ^ 1];
-         else if (inNeighbours[1] && inNeighbours[1]->IsLeaf() == false)
-             childNeighbours[1] = inNeighbours[1]->children[i ^ 1];
-        // +Y neighbor
-         if (offset.Y == 1) childNeighbours[2] = children[i ^ 2];
-         else if (inNeighbours[2] && inNeighbours[2]->IsLeaf() == false)
-             childNeighbours[2] = inNeighbours[2]->children[i ^ 2];
-        // -Y neighbor
-         if (offset.Y == -1) childNeighbours[3] = children[i ^ 2];
-         else if (inNeighbours[3] && inNeighbours[3]->IsLeaf() == false)
-             childNeighbours[3] = inNeighbours[3]->children[i ^ 2];
-        // +Z neighbor
-         if (offset.Z == 1) childNeighbours[4] = children[i ^ 4];
-         else if (inNeighbours[4] && inNeighbours[4]->IsLeaf() == false)
-             childNeighbours[4] = inNeighbours[4]->children[i ^ 4];
-        // -Z neighbor
-         if (offset.Z == -1) childNeighbours[5] = children[i ^ 4];
-         else if (inNeighbours[5] && inNeighbours[5]->IsLeaf() == false) 
-             childNeighbours[5] = inNeighbours[5]->children[i ^ 4];
-
-         child->AssignChildNeighbours(childNeighbours);
-     }
- }
-
-void OctreeNode::Release() {
-    ENQUEUE_RENDER_COMMAND(ReleaseTypeBufferCmd)(
-        [this](FRHICommandListImmediate& RHICmdList) {
-            if (vertexFactory.IsValid())
-                vertexFactory->ReleaseResource();
-            regularCell.ReleaseResources();
-        });
+void OctreeNode::AcquireResources(VoxelResourcePool& pool) {
+    if (isResident) return;
+    renderResources = pool.Acquire();
+    isResident = true;
 }
 
-void OctreeNode::Subdivide(int inDepth, int maxDepth, int bufferSize) {
-    if (!isLeaf) return;
+void OctreeNode::ReturnResources(VoxelResourcePool& pool) {
+    if (!isResident) return;
+    pool.Recycle(renderResources);
+    isResident = false;
+}
 
-    int nextDepth = inDepth + 1;
-    isLeaf = false;
-    FVector3f c = bounds.Center();
-    FVector3f e = bounds.Extent() * 0.5f;
+bool OctreeNode::IsLeaf() const { return tree->IsLeafIndex(index); }
+bool OctreeNode::IsVisible() const { return tree->IsNodeVisible(index); }
+void OctreeNode::SetVisible(bool visibility) { tree->SetNodeVisible(index, visibility); }
+int OctreeNode::GetDepth() const { return tree->GetNodeDepth(index); }
+uint64 OctreeNode::GetKey() const { return tree->GetNodeKey(index); }
+AABB OctreeNode::GetBounds() const { return tree->GetNodeBounds(index); }
+AActor* OctreeNode::GetTreeActor() const { return tree->GetParentActor(); }
+EVoxelNodeClass OctreeNode::ClassifyNode() const { return tree->ClassifyNode(index); }
+
+OctreeNode* OctreeNode::GetNodeParent() const {
+    return IsRoot() ? nullptr : tree->FindNode(MortonCode::GetParent(GetKey()));
+}
 
-    for (int i = 0; i < 8; ++i) {
-        FVector3f offset((i & 1 ? 1 : -1) * e.X, (i & 2 ? 1 : -1) * e.Y, (i & 4 ? 1 : -1) * e.Z);
-        FVector3f childCenter = c + offset;
-        FVector3f halfSize = e;
+OctreeNode* OctreeNode::GetChild(int childIndex) const {
+    int32 firstChild = tree->GetFirstChildIndex(index);
+    return firstChild == INDEX_NONE ? nullptr : tree->GetNode(firstChild + childIndex);
+}
+
+OctreeNode* OctreeNode::GetNeighbour(int direction) const {
+    return tree->GetFaceNeighbour(index, direction);
+}
 
-        AABB childAABB = { childCenter - halfSize, childCenter + halfSize };
-        children[i] = new OctreeNode(treeActor, this, childAABB, bufferSize, voxelsPerAxis, nextDepth, maxDepth);
-    }
-}
\ No newline at end of file
+bool OctreeNode::RayIntersectVoxelBody(const VoxelLODView& view) const {
+    return RayIntersectsBounds(GetBounds(), view);
+}
+
+bool OctreeNode::RayIntersectsBounds(const AABB& bounds, const VoxelLODView& view) {
+    FVector3f nodeCenterV3F = bounds.Center();
+    FVector nodeCenter = FVector(nodeCenterV3F.X, nodeCenterV3F.Y, nodeCenterV3F.Z);
+
+    FVector normalView = (nodeCenter - view.localPosition).GetSafeNormal();
+    FVector segmentDir = normalView * view.localDistance;
+    FVector end = view.localPosition + segmentDir;
+
+    float dot = FVector::DotProduct(view.localForward, normalView);
+    bool isInFront = view.forwardCheck ? dot > 0 : true;
+
+    float ratio = bounds.Size().X / 2.0;
+    FVector extent = FVector(ratio, ratio, ratio);
+    FBox boundsFBox = FBox();
+    boundsFBox = boundsFBox.BuildAABB(nodeCenter, extent * 2);
+
+    FVector oneOverDirection(
+        FMath::IsNearlyZero(segmentDir.X) ? 1e10f : 1.0f / segmentDir.X,
+        FMath::IsNearlyZero(segmentDir.Y) ? 1e10f : 1.0f / segmentDir.Y,
+        FMath::IsNearlyZero(segmentDir.Z) ? 1e10f : 1.0f / segmentDir.Z
+    );
+    bool bIntersects = FMath::LineBoxIntersection(boundsFBox, view.localPosition, end, segmentDir, oneOverDirection);
+    bool bInsideOrOn = boundsFBox.IsInside(view.localPosition);
+    return ((bIntersects && isInFront) || bInsideOrOn) ? true : false;
+}
+
+// Projects the node's voxel size at its closest point to the camera. Inside the band threshold * (1 -/+ hysteresis)
+// the previous decision is kept, so nodes near the switching distance don't alternate between LODs every frame.
+bool OctreeNode::ExceedsScreenSpaceError(const VoxelLODView& view, float hysteresis, bool wasRefined) const {
+    return BoundsExceedScreenSpaceError(GetBounds(), tree->GetVoxelsPerAxs(), view, hysteresis, wasRefined);
+}
+
+bool OctreeNode::BoundsExceedScreenSpaceError(const AABB& bounds, int voxelsPerAxis, const VoxelLODView& view, float hysteresis, bool wasRefined) {
+    FBox box(FVector(bounds.min.X, bounds.min.Y, bounds.min.Z), FVector(bounds.max.X, bounds.max.Y, bounds.max.Z));
+    float distance = FMath::Sqrt(box.ComputeSquaredDistanceToPoint(view.localPosition));
+    if (distance <= KINDA_SMALL_NUMBER) return true;
+
+    float voxelSize = bounds.Size().X / voxelsPerAxis;
+    float projectedError = (voxelSize * view.projectionScale) / distance;
+
+    float threshold = wasRefined ? view.errorThreshold * (1.0f - hysteresis) : view.errorThreshold * (1.0f + hysteresis);
+    return projectedError > threshold;
+}
@@ -0,0 +1,39 @@
+#include "Misc/AutomationTest.h"
+#include "Octree.h"
+#include "OctreeTestBodies.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FOctreeBuildWorkersBenchmark, "VoxelRendering.Octree.Benchmark.BuildWorkers",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+// Builds the subtrees of a sphere body at depths 4 to 6 on 1, 2, 4 ... workers and reports each worker count's time and
+// speedup over one. Every worker count must build the same nodes. Nodes of 4 voxels keep the depth 6 grid at 257^3 samples.
+bool FOctreeBuildWorkersBenchmark::RunTest(const FString& Parameters) {
+    const int voxelsPerAxis = 4;
+    const float scale = 6400.0f;
+    const int32 iterations = 4;
+
+    for (int depth = 4; depth <= 6; depth++) {
+        const int bufferSizePerAxis = voxelsPerAxis << depth;
+        TArray<float> iso;
+        TArray<uint32> type;
+        MakeSphereBody(bufferSizePerAxis + 1, iso, type);
+        Octree tree(nullptr, 0.5f, scale, voxelsPerAxis, depth, bufferSizePerAxis, iso, type);
+
+        TArray<Octree::BuildTiming> timings;
+        tree.BenchmarkBuild(iterations, timings);
+        if (!TestTrue(FString::Printf(TEXT("Depth %d has subtrees below the split depth"), depth), timings.Num() > 0))
+            continue;
+
+        for (const Octree::BuildTiming& timing : timings) {
+            AddInfo(FString::Printf(TEXT("Octree depth %d build (%d nodes): %d workers %.3f ms, speedup %.2fx"),
+                depth, timing.nodeCount, timing.workers, timing.seconds * 1000.0, timing.seconds > 0.0 ? timings[0].seconds / timing.seconds : 0.0));
+            TestEqual(FString::Printf(TEXT("Depth %d nodes built on %d workers"), depth, timing.workers), timing.nodeCount, timings[0].nodeCount);
+        }
+        TestEqual(FString::Printf(TEXT("Depth %d sweep starts on one worker"), depth), timings[0].workers, 1);
+    }
+    return !HasAnyErrors();
+}
+
+#endif
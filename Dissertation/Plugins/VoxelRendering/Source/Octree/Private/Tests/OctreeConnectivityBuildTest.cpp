@@ -0,0 +1,51 @@
+#include "Misc/AutomationTest.h"
+#include "HAL/IConsoleManager.h"
+#include "Octree.h"
+#include "OctreeTestBodies.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FOctreeConnectivityBuildTest, "VoxelRendering.Octree.ConnectivityBuiltOnTask",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+// The tree launches its connectivity build when it is constructed and the first batch lands before it is waited on.
+// Once adopted the connectivity is usable, a carve into the body cuts nothing off, and a reset builds it again.
+bool FOctreeConnectivityBuildTest::RunTest(const FString& Parameters) {
+    IConsoleVariable* detect = IConsoleManager::Get().FindConsoleVariable(TEXT("voxel.DetectDetachedChunks"));
+    if (!detect || detect->GetInt() == 0) {
+        AddInfo(TEXT("voxel.DetectDetachedChunks is off, nothing is built"));
+        return true;
+    }
+
+    const int voxelsPerAxis = 8;
+    const int depth = 3;
+    const int bufferSizePerAxis = voxelsPerAxis << depth;
+    const float scale = 6400.0f;
+
+    TArray<float> iso;
+    TArray<uint32> type;
+    MakeSphereBody(bufferSizePerAxis + 1, iso, type);
+    Octree tree(nullptr, 0.5f, scale, voxelsPerAxis, depth, bufferSizePerAxis, iso, type);
+
+    VoxelEditCommand carve;
+    carve.op = EVoxelEditOp::Subtract;
+    carve.position = FVector(0.0, 0.0, scale * 0.25f);
+    carve.radius = 400.0f;
+    carve.influence = 1.0f;
+    tree.ApplyEditBatch(MakeArrayView(&carve, 1));
+
+    TestTrue(TEXT("Connectivity adopted once its task is done"), tree.FinishConnectivityBuild(true));
+    TArray<VoxelDetachedChunk> chunks;
+    tree.ConsumeDetachedChunks(chunks);
+    TestEqual(TEXT("Pieces cut off by a carve into the body"), chunks.Num(), 0);
+
+    tree.ApplyEditBatch(MakeArrayView(&carve, 1));
+    tree.ConsumeDetachedChunks(chunks);
+    TestEqual(TEXT("Pieces cut off by a carve once adopted"), chunks.Num(), 0);
+
+    tree.ResetDeformation();
+    TestTrue(TEXT("Connectivity built again after a reset"), tree.FinishConnectivityBuild(true));
+    return !HasAnyErrors();
+}
+
+#endif
@@ -0,0 +1,45 @@
+#include "Misc/AutomationTest.h"
+#include "Octree.h"
+#include "OctreeTestBodies.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FOctreeConstructionBenchmark, "VoxelRendering.Octree.Benchmark.ConstructAndDestroy",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+// Builds and destroys a tree over a sphere body at depths 1 to 6 and reports the mean time of each. Destruction includes
+// the one render flush the tree makes, so the batched release is what is timed. Nodes of 4 voxels keep the depth 6 grid
+// at 257^3 samples.
+bool FOctreeConstructionBenchmark::RunTest(const FString& Parameters) {
+    const int voxelsPerAxis = 4;
+    const float scale = 6400.0f;
+    const int32 iterations = 4;
+
+    for (int depth = 1; depth <= 6; depth++) {
+        const int bufferSizePerAxis = voxelsPerAxis << depth;
+        TArray<float> iso;
+        TArray<uint32> type;
+        MakeSphereBody(bufferSizePerAxis + 1, iso, type);
+
+        double constructSeconds = 0.0;
+        double destructSeconds = 0.0;
+        int32 nodeCount = 0;
+        for (int32 i = 0; i < iterations; i++) {
+            double start = FPlatformTime::Seconds();
+            TUniquePtr<Octree> tree = MakeUnique<Octree>(nullptr, 0.5f, scale, voxelsPerAxis, depth, bufferSizePerAxis, iso, type);
+            constructSeconds += FPlatformTime::Seconds() - start;
+            nodeCount = tree->GetNodeCount();
+
+            start = FPlatformTime::Seconds();
+            tree.Reset();
+            destructSeconds += FPlatformTime::Seconds() - start;
+        }
+
+        AddInfo(FString::Printf(TEXT("Octree depth %d (%d nodes): construct %.3f ms, destruct %.3f ms"),
+            depth, nodeCount, constructSeconds * 1000.0 / iterations, destructSeconds * 1000.0 / iterations));
+        TestTrue(FString::Printf(TEXT("Depth %d refines past the root"), depth), nodeCount > 1);
+    }
+    return !HasAnyErrors();
+}
+
+#endif
@@ -0,0 +1,34 @@
+#include "Misc/AutomationTest.h"
+#include "Octree.h"
+#include "OctreeTestBodies.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FOctreeDeformationOpTest, "VoxelRendering.Octree.PaintOnlyWithoutAdditiveIsNoOp",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+// The deformation calls map their flags onto edit ops the way the original brush behaved: paintOnly keeps the density
+// and only the additive side paints, so a paintOnly edit that is not additive must leave the tree untouched.
+bool FOctreeDeformationOpTest::RunTest(const FString& Parameters) {
+    const int voxelsPerAxis = 8;
+    const int depth = 2;
+    const int bufferSizePerAxis = voxelsPerAxis << depth;
+    const float scale = 3200.0f;
+
+    TArray<float> iso;
+    TArray<uint32> type;
+    MakeSphereBody(bufferSizePerAxis + 1, iso, type);
+    Octree tree(nullptr, 0.5f, scale, voxelsPerAxis, depth, bufferSizePerAxis, iso, type);
+
+    FVector surface(scale * 0.25f, 0.0f, 0.0f);
+    uint32 editVersion = tree.GetEditVersion();
+    TestFalse(TEXT("Point paint without additive reports a change"), tree.ApplyDeformationAtPosition(surface, 200.0f, 1.0f, 2, false, true));
+    TestFalse(TEXT("Swept paint without additive reports a change"), tree.ApplySweptDeformation(surface, surface + FVector(0.0f, 200.0f, 0.0f), 200.0f, 1.0f, 2, false, true));
+    TestEqual(TEXT("Edit version after paint without additive"), tree.GetEditVersion(), editVersion);
+
+    tree.ApplyDeformationAtPosition(surface, 200.0f, 1.0f, 2, true, true);
+    TestTrue(TEXT("Additive paint lands"), tree.GetEditVersion() != editVersion);
+    return !HasAnyErrors();
+}
+
+#endif
@@ -0,0 +1,68 @@
+#include "Misc/AutomationTest.h"
+#include "Octree.h"
+#include "VoxelLODSelector.h"
+#include "OctreeTestBodies.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FOctreeLODBalanceBenchmark, "VoxelRendering.Octree.Benchmark.LODBalance",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+// Selects the unbalanced cut a camera just above a planet's surface sees at depths 3 to 5, then balances copies of it
+// with the legacy quadratic balancer over the live nodes and with the ripple balancer over the snapshot, reporting the
+// mean time of each. The legacy balancer run over the ripple cut must find nothing left to split.
+bool FOctreeLODBalanceBenchmark::RunTest(const FString& Parameters) {
+    const int voxelsPerAxis = 8;
+    const float scale = 6400.0f;
+    const int32 iterations = 4;
+
+    for (int depth = 3; depth <= 5; depth++) {
+        const int bufferSizePerAxis = voxelsPerAxis << depth;
+        TArray<float> iso;
+        TArray<uint32> type;
+        MakeSphereBody(bufferSizePerAxis + 1, iso, type);
+        Octree tree(nullptr, 0.5f, scale, voxelsPerAxis, depth, bufferSizePerAxis, iso, type);
+
+        VoxelLODSelectionInput input;
+        input.topology = tree.GetTopologySnapshot();
+        input.view = MakeTestView(FVector(scale * 0.3f, 0.0, 0.0));
+        input.bScreenSpaceError = true;
+        input.bBalance = false;
+        VoxelLODSelectionResult unbalanced;
+        VoxelLODSelector::Select(input, unbalanced);
+
+        double legacySeconds = 0.0;
+        TArray<OctreeNode*> legacyNodes;
+        for (int32 i = 0; i < iterations; i++) {
+            legacyNodes.Reset();
+            tree.ApplyLODSelection(unbalanced.visibleNodes, legacyNodes);
+            double start = FPlatformTime::Seconds();
+            VoxelLODSelector::BalanceLegacy(legacyNodes);
+            legacySeconds += FPlatformTime::Seconds() - start;
+        }
+
+        double rippleSeconds = 0.0;
+        TBitArray<> visible;
+        TArray<int32> rippleNodes;
+        TArray<int32> workList;
+        for (int32 i = 0; i < iterations; i++) {
+            visible = unbalanced.visible;
+            rippleNodes = unbalanced.visibleNodes;
+            double start = FPlatformTime::Seconds();
+            VoxelLODSelector::Balance(*input.topology, visible, rippleNodes, workList);
+            rippleSeconds += FPlatformTime::Seconds() - start;
+        }
+
+        AddInfo(FString::Printf(TEXT("Octree depth %d, %d nodes unbalanced: legacy %.3f ms to %d nodes, ripple %.3f ms to %d nodes"),
+            depth, unbalanced.visibleNodes.Num(), legacySeconds * 1000.0 / iterations, legacyNodes.Num(), rippleSeconds * 1000.0 / iterations, rippleNodes.Num()));
+
+        TArray<OctreeNode*> rebalancedNodes;
+        tree.ApplyLODSelection(rippleNodes, rebalancedNodes);
+        VoxelLODSelector::BalanceLegacy(rebalancedNodes);
+        TestEqual(FString::Printf(TEXT("Depth %d: nodes after the legacy balancer runs over the ripple cut"), depth), rebalancedNodes.Num(), rippleNodes.Num());
+        TestTrue(FString::Printf(TEXT("Depth %d: the cut is refined towards the camera"), depth), unbalanced.visibleNodes.Num() > 1);
+    }
+    return !HasAnyErrors();
+}
+
+#endif
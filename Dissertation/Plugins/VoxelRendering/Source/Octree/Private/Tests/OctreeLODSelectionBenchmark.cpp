@@ -0,0 +1,60 @@
+#include "Misc/AutomationTest.h"
+#include "Octree.h"
+#include "VoxelLODSelector.h"
+#include "OctreeTestBodies.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FOctreeLODSelectionBenchmark, "VoxelRendering.Octree.Benchmark.LODSelection",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+// Builds trees of depth 3 to 7 over the same 256^3 voxel sphere body, so each level deeper halves the voxels per node,
+// and times the snapshot, the selection with balancing and the publish of the cut seen from just above the surface.
+// Each selection after the first keeps the refinement of the one before, as a steady camera would.
+bool FOctreeLODSelectionBenchmark::RunTest(const FString& Parameters) {
+    const int bufferSizePerAxis = 256;
+    const float scale = 6400.0f;
+    const int32 iterations = 8;
+
+    TArray<float> iso;
+    TArray<uint32> type;
+    MakeSphereBody(bufferSizePerAxis + 1, iso, type);
+
+    for (int depth = 3; depth <= 7; depth++) {
+        const int voxelsPerAxis = bufferSizePerAxis >> depth;
+        Octree tree(nullptr, 0.5f, scale, voxelsPerAxis, depth, bufferSizePerAxis, iso, type);
+
+        double snapshotSeconds = 0.0;
+        double selectSeconds = 0.0;
+        double publishSeconds = 0.0;
+        VoxelLODSelectionResult result;
+        TArray<OctreeNode*> visibleNodes;
+        for (int32 i = 0; i < iterations; i++) {
+            double start = FPlatformTime::Seconds();
+            VoxelLODSelectionInput input;
+            input.topology = tree.GetTopologySnapshot();
+            snapshotSeconds += FPlatformTime::Seconds() - start;
+            input.view = MakeTestView(FVector(scale * 0.3f, 0.0, 0.0));
+            input.bScreenSpaceError = true;
+            if (i > 0)
+                input.wasRefined = MakeShared<TBitArray<>>(result.refined);
+
+            start = FPlatformTime::Seconds();
+            VoxelLODSelector::Select(input, result);
+            selectSeconds += FPlatformTime::Seconds() - start;
+
+            start = FPlatformTime::Seconds();
+            visibleNodes.Reset();
+            tree.ApplyLODSelection(result.visibleNodes, visibleNodes);
+            publishSeconds += FPlatformTime::Seconds() - start;
+        }
+
+        AddInfo(FString::Printf(TEXT("Octree depth %d (%d nodes, %d selected): snapshot %.3f ms, select %.3f ms, publish %.3f ms"),
+            depth, tree.GetNodeCount(), visibleNodes.Num(), snapshotSeconds * 1000.0 / iterations, selectSeconds * 1000.0 / iterations,
+            publishSeconds * 1000.0 / iterations));
+        TestTrue(FString::Printf(TEXT("Depth %d selects a cut"), depth), visibleNodes.Num() > 0);
+    }
+    return !HasAnyErrors();
+}
+
+#endif
@@ -0,0 +1,79 @@
+#include "Misc/AutomationTest.h"
+#include "Octree.h"
+#include "OctreeTestBodies.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace {
+    // Nodes reachable from the root, collapsed children keep their storage so GetNodeCount still counts them
+    int32 CountReachableNodes(const Octree& tree) {
+        TArray<int32> stack = { 0 };
+        int32 count = 0;
+        while (stack.Num() > 0) {
+            int32 index = stack.Pop(EAllowShrinking::No);
+            count++;
+            if (tree.IsLeafIndex(index)) continue;
+            for (int i = 0; i < 8; i++)
+                stack.Add(tree.GetFirstChildIndex(index) + i);
+        }
+        return count;
+    }
+
+    VoxelEditCommand MakeCommand(EVoxelEditOp op, const FVector& position, float radius, float influence) {
+        VoxelEditCommand command;
+        command.op = op;
+        command.position = position;
+        command.radius = radius;
+        command.influence = influence;
+        command.paintType = 2;
+        return command;
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FOctreeEditRefineTest, "VoxelRendering.Octree.EditsRefineOnlyNewSurface",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+// Edits that leave no surface where there was none must not split anything: painting inside the body, carving empty
+// space and a brush covering the whole tree. A blob added in empty space is refined, removing it again collapses the
+// tree back to what it was, and adding it a second time reuses the nodes the first one split.
+bool FOctreeEditRefineTest::RunTest(const FString& Parameters) {
+    const int voxelsPerAxis = 8;
+    const int depth = 3;
+    const int bufferSizePerAxis = voxelsPerAxis << depth;
+    const int samplesPerAxis = bufferSizePerAxis + 1;
+    const float scale = 6400.0f;
+
+    TArray<float> iso;
+    TArray<uint32> type;
+    MakeSphereBody(samplesPerAxis, iso, type);
+    Octree tree(nullptr, 0.5f, scale, voxelsPerAxis, depth, bufferSizePerAxis, iso, type);
+    int32 builtNodes = tree.GetNodeCount();
+    int32 builtReachable = CountReachableNodes(tree);
+
+    // The body is centred on the tree, the corners are empty space well away from it
+    FVector corner(scale * 0.35f);
+    VoxelEditCommand paintInside = MakeCommand(EVoxelEditOp::Paint, FVector::ZeroVector, 600.0f, 1.0f);
+    VoxelEditCommand carveEmpty = MakeCommand(EVoxelEditOp::Subtract, -corner, 400.0f, 1.0f);
+    VoxelEditCommand paintEverything = MakeCommand(EVoxelEditOp::Paint, FVector::ZeroVector, scale, 1.0f);
+    for (const VoxelEditCommand& command : { paintInside, carveEmpty, paintEverything }) {
+        tree.ApplyEditBatch(MakeArrayView(&command, 1));
+        TestEqual(TEXT("Nodes after an edit that makes no surface"), tree.GetNodeCount(), builtNodes);
+    }
+
+    VoxelEditCommand addBlob = MakeCommand(EVoxelEditOp::Add, corner, 400.0f, 1.0f);
+    VoxelEditCommand removeBlob = MakeCommand(EVoxelEditOp::Subtract, corner, 400.0f, 1.0f);
+    tree.ApplyEditBatch(MakeArrayView(&addBlob, 1));
+    int32 blobNodes = tree.GetNodeCount();
+    int32 blobReachable = CountReachableNodes(tree);
+    TestTrue(TEXT("A blob in empty space is refined"), blobReachable > builtReachable);
+
+    tree.ApplyEditBatch(MakeArrayView(&removeBlob, 1));
+    TestEqual(TEXT("Reachable nodes once the blob is removed"), CountReachableNodes(tree), builtReachable);
+
+    tree.ApplyEditBatch(MakeArrayView(&addBlob, 1));
+    TestEqual(TEXT("Reachable nodes with the blob added again"), CountReachableNodes(tree), blobReachable);
+    TestEqual(TEXT("Nodes stored with the blob added again"), tree.GetNodeCount(), blobNodes);
+    return !HasAnyErrors();
+}
+
+#endif
@@ -0,0 +1,64 @@
+#include "Misc/AutomationTest.h"
+#include "Octree.h"
+#include "MortonCode.h"
+#include "OctreeTestBodies.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FOctreeEditRemeshTest, "VoxelRendering.Octree.EditRemeshesOnlyOverlappingNodes",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+// Every node is marked meshed, then one brush is applied. The nodes whose mesh is out of date afterwards, which are the
+// ones the component queues for remeshing, must be exactly the nodes whose samples overlap the brush's box.
+bool FOctreeEditRemeshTest::RunTest(const FString& Parameters) {
+    const int voxelsPerAxis = 8;
+    const int depth = 3;
+    const int bufferSizePerAxis = voxelsPerAxis << depth;
+    const int samplesPerAxis = bufferSizePerAxis + 1;
+    const float scale = 6400.0f;
+
+    TArray<float> iso;
+    TArray<uint32> type;
+    MakeSphereBody(samplesPerAxis, iso, type);
+    Octree tree(nullptr, 0.5f, scale, voxelsPerAxis, depth, bufferSizePerAxis, iso, type);
+    // Leaves the edit splits gain children that were never meshed, only the nodes from before are checked
+    int32 nodeCount = tree.GetNodeCount();
+    for (int32 i = 0; i < nodeCount; i++)
+        tree.MarkNodeMeshed(i);
+
+    // On the surface along +x, the tree is centred on its actor
+    VoxelEditCommand command;
+    command.op = EVoxelEditOp::Subtract;
+    command.position = FVector(scale * 0.25f, 0.0f, 0.0f);
+    command.radius = 300.0f;
+    command.influence = 1.0f;
+    if (!TestEqual(TEXT("Edits applied"), tree.ApplyEditBatch(MakeArrayView(&command, 1)), 1))
+        return false;
+
+    float isoScale = scale / samplesPerAxis;
+    FVector isoCenter = (command.position - (FVector(tree.GetOctreePosition()) - FVector(scale / 2.0f))) / isoScale;
+    float isoRadius = command.radius / isoScale;
+    FIntVector editMin(FMath::FloorToInt(isoCenter.X - isoRadius), FMath::FloorToInt(isoCenter.Y - isoRadius), FMath::FloorToInt(isoCenter.Z - isoRadius));
+    FIntVector editMax(FMath::CeilToInt(isoCenter.X + isoRadius), FMath::CeilToInt(isoCenter.Y + isoRadius), FMath::CeilToInt(isoCenter.Z + isoRadius));
+
+    int32 staleCount = 0;
+    for (int32 i = 0; i < nodeCount; i++) {
+        uint64 key = tree.GetNodeKey(i);
+        int span = tree.GetVoxelsPerAxsMaxRes() >> MortonCode::GetDepth(key);
+        FIntVector nodeMin = MortonCode::Decode(key) * span;
+        FIntVector nodeMax = nodeMin + FIntVector(span);
+        bool bOverlaps = !(nodeMax.X < editMin.X || nodeMax.Y < editMin.Y || nodeMax.Z < editMin.Z ||
+            nodeMin.X > editMax.X || nodeMin.Y > editMax.Y || nodeMin.Z > editMax.Z);
+
+        bool bStale = !tree.IsNodeMeshCurrent(i);
+        staleCount += bStale ? 1 : 0;
+        if (bStale != bOverlaps)
+            AddError(FString::Printf(TEXT("Node %d at depth %d: %s the edit but %s"), i, MortonCode::GetDepth(key),
+                bOverlaps ? TEXT("overlaps") : TEXT("misses"), bStale ? TEXT("scheduled for remeshing") : TEXT("left as meshed")));
+    }
+    TestTrue(TEXT("The edit schedules some nodes"), staleCount > 0);
+    TestTrue(TEXT("The edit leaves some nodes"), staleCount < nodeCount);
+    return !HasAnyErrors();
+}
+
+#endif
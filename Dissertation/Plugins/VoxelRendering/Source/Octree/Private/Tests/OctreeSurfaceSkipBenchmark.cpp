@@ -0,0 +1,73 @@
+#include "Misc/AutomationTest.h"
+#include "Octree.h"
+#include "VoxelLODSelector.h"
+#include "OctreeTestBodies.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FOctreeSurfaceSkipBenchmark, "VoxelRendering.Octree.Benchmark.SurfaceSkipping",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+// Generates a planet at each depth and selects the cut a camera just above its surface would see. Every visible node
+// is then counted the way the mesh component dispatches it: marching cubes only for surface nodes, a transvoxel pass
+// per transition slot unless neither the node nor the neighbours in its cell hold a surface, and deformation for the
+// surface nodes and every node of a transition cell that is dispatched.
+bool FOctreeSurfaceSkipBenchmark::RunTest(const FString& Parameters) {
+    const int voxelsPerAxis = 8;
+    const float scale = 6400.0f;
+
+    for (int depth = 3; depth <= 5; depth++) {
+        const int bufferSizePerAxis = voxelsPerAxis << depth;
+        TArray<float> iso;
+        TArray<uint32> type;
+        MakeSphereBody(bufferSizePerAxis + 1, iso, type);
+        Octree tree(nullptr, 0.5f, scale, voxelsPerAxis, depth, bufferSizePerAxis, iso, type);
+
+        VoxelLODSelectionInput input;
+        input.topology = tree.GetTopologySnapshot();
+        input.view = MakeTestView(FVector(scale * 0.3f, 0.0, 0.0));
+        input.bScreenSpaceError = true;
+        VoxelLODSelectionResult result;
+        VoxelLODSelector::Select(input, result);
+        TArray<OctreeNode*> visibleNodes;
+        tree.ApplyLODSelection(result.visibleNodes, visibleNodes);
+
+        int32 surfaceNodes = 0;
+        int32 transvoxelDispatched = 0;
+        TSet<OctreeNode*> deformNodes;
+        for (OctreeNode* node : visibleNodes) {
+            bool bSurface = node->ClassifyNode() == EVoxelNodeClass::Surface;
+            surfaceNodes += bSurface ? 1 : 0;
+            if (bSurface)
+                deformNodes.Add(node);
+            for (int i = 0; i < 3; i++) {
+                TransitionCell* cell = node->GetTransitionCell(i);
+                if (!cell->enabled) {
+                    transvoxelDispatched += bSurface ? 1 : 0;
+                    continue;
+                }
+                bool bCellSurface = bSurface;
+                for (int j = 0; j < 4; j++)
+                    bCellSurface |= cell->adjacentNodes[j] && cell->adjacentNodes[j]->ClassifyNode() == EVoxelNodeClass::Surface;
+                if (!bCellSurface) continue;
+                transvoxelDispatched++;
+                deformNodes.Add(node);
+                for (int j = 0; j < 4; j++)
+                    deformNodes.Add(cell->adjacentNodes[j]);
+            }
+        }
+
+        int32 skippedNodes = visibleNodes.Num() - surfaceNodes;
+        int32 deformSkipped = visibleNodes.Num() - deformNodes.Num();
+        int32 transvoxelSlots = visibleNodes.Num() * 3;
+        int64 fullTreeNodes = ((1ll << (3 * (depth + 1))) - 1) / 7;
+        AddInfo(FString::Printf(TEXT("Depth %d: %d nodes built (%lld in a full tree), %d visible of which %d hold a surface. Skipped: deformation %d, marching cubes %d, transvoxel %d of %d"),
+            depth, tree.GetNodeCount(), fullTreeNodes, visibleNodes.Num(), surfaceNodes, deformSkipped, skippedNodes, transvoxelSlots - transvoxelDispatched, transvoxelSlots));
+
+        TestTrue(FString::Printf(TEXT("Depth %d: the camera sees some surface"), depth), surfaceNodes > 0);
+        TestTrue(FString::Printf(TEXT("Depth %d: the cut holds nodes with no surface to skip"), depth), skippedNodes > 0);
+    }
+    return !HasAnyErrors();
+}
+
+#endif
@@ -0,0 +1,32 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "OctreeNode.h"
+
+// A sphere body filling half the grid, density rising from 0 inside to 1 outside across a few samples
+inline void MakeSphereBody(int samplesPerAxis, TArray<float>& outIso, TArray<uint32>& outType) {
+    float centre = (samplesPerAxis - 1) * 0.5f;
+    float radius = samplesPerAxis * 0.25f;
+    outIso.SetNumUninitialized(samplesPerAxis * samplesPerAxis * samplesPerAxis);
+    outType.Init(1, samplesPerAxis * samplesPerAxis * samplesPerAxis);
+    for (int z = 0; z < samplesPerAxis; z++) {
+        for (int y = 0; y < samplesPerAxis; y++) {
+            for (int x = 0; x < samplesPerAxis; x++) {
+                float distance = FVector3f(x - centre, y - centre, z - centre).Size();
+                outIso[x + y * samplesPerAxis + z * samplesPerAxis * samplesPerAxis] = FMath::Clamp(0.5f + (distance - radius) * 0.25f, 0.0f, 1.0f);
+            }
+        }
+    }
+}
+
+// Screen space error view from a point in the tree's local space, as the mesh component resolves it for a 1080 pixel
+// high viewport with a 90 degree field of view
+inline VoxelLODView MakeTestView(const FVector& localPosition, float errorThreshold = 8.0f) {
+    VoxelLODView view;
+    view.localPosition = localPosition;
+    view.localForward = -localPosition.GetSafeNormal();
+    view.localDistance = localPosition.Size();
+    view.forwardCheck = false;
+    view.projectionScale = 1080.0f / (2.0f * FMath::Tan(FMath::DegreesToRadians(90.0f) * 0.5f));
+    view.errorThreshold = errorThreshold;
+    return view;
+}
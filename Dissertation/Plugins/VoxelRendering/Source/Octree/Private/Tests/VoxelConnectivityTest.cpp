@@ -0,0 +1,112 @@
+#include "Misc/AutomationTest.h"
+#include "VoxelConnectivity.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace {
+    const int SamplesPerAxis = 33;
+    // The pillar stands on the slab inside this footprint, cuts through it leave its upper part floating
+    const int PillarMin = 14;
+    const int PillarMax = 18;
+    const int PillarArea = (PillarMax - PillarMin + 1) * (PillarMax - PillarMin + 1);
+
+    // Sets the delta of every sample of the pillar between the heights, as an edit would, and marks them dirty
+    void SetPillarLayers(VoxelConnectivity& connectivity, TArray<float>& deltaIso, int zMin, int zMax, float delta) {
+        for (int z = zMin; z <= zMax; z++)
+            for (int y = PillarMin; y <= PillarMax; y++)
+                for (int x = PillarMin; x <= PillarMax; x++)
+                    deltaIso[x + y * SamplesPerAxis + z * SamplesPerAxis * SamplesPerAxis] = delta;
+        connectivity.MarkDirty(FIntVector(PillarMin, PillarMin, zMin), FIntVector(PillarMax, PillarMax, zMax));
+    }
+
+    void CheckReported(FAutomationTestBase& test, const TCHAR* label, const TArray<VoxelSolidComponent>& detached, TConstArrayView<int64> expectedSamples) {
+        if (!test.TestEqual(FString::Printf(TEXT("%s: pieces reported"), label), detached.Num(), expectedSamples.Num()))
+            return;
+        for (int32 i = 0; i < detached.Num(); i++)
+            test.TestEqual(FString::Printf(TEXT("%s: samples in piece %d"), label, i), detached[i].sampleCount, expectedSamples[i]);
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVoxelConnectivityReportTest, "VoxelRendering.Octree.DetachedPiecesReportedOnce",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+// A pillar on a slab is cut so its top comes loose, then the loose top is cut up again, which must report nothing. Once
+// the cut is filled back in the top is part of the body again, so cutting it off a second time reports it again.
+bool FVoxelConnectivityReportTest::RunTest(const FString& Parameters) {
+    const float isoLevel = 0.0f;
+    TArray<float> initIso;
+    TArray<float> deltaIso;
+    initIso.SetNumUninitialized(SamplesPerAxis * SamplesPerAxis * SamplesPerAxis);
+    deltaIso.SetNumZeroed(initIso.Num());
+    for (int z = 0; z < SamplesPerAxis; z++) {
+        for (int y = 0; y < SamplesPerAxis; y++) {
+            for (int x = 0; x < SamplesPerAxis; x++) {
+                bool bPillar = x >= PillarMin && x <= PillarMax && y >= PillarMin && y <= PillarMax && z <= 28;
+                initIso[x + y * SamplesPerAxis + z * SamplesPerAxis * SamplesPerAxis] = z < 10 || bPillar ? -1.0f : 1.0f;
+            }
+        }
+    }
+
+    VoxelConnectivity connectivity(initIso, deltaIso, SamplesPerAxis, isoLevel);
+    connectivity.Build();
+    TArray<VoxelSolidComponent> detached;
+
+    SetPillarLayers(connectivity, deltaIso, 12, 12, 0.0f);
+    connectivity.Update(true, detached);
+    CheckReported(*this, TEXT("Edit that cuts nothing off"), detached, {});
+
+    SetPillarLayers(connectivity, deltaIso, 16, 17, 2.0f);
+    connectivity.Update(true, detached);
+    CheckReported(*this, TEXT("Pillar cut"), detached, { 11 * PillarArea });
+
+    detached.Reset();
+    SetPillarLayers(connectivity, deltaIso, 22, 23, 2.0f);
+    connectivity.Update(true, detached);
+    CheckReported(*this, TEXT("Loose top cut in two"), detached, {});
+
+    deltaIso[PillarMin + PillarMin * SamplesPerAxis + 26 * SamplesPerAxis * SamplesPerAxis] = 2.0f;
+    connectivity.MarkDirty(FIntVector(PillarMin, PillarMin, 26), FIntVector(PillarMin, PillarMin, 26));
+    connectivity.Update(true, detached);
+    CheckReported(*this, TEXT("Loose piece notched"), detached, {});
+
+    SetPillarLayers(connectivity, deltaIso, 16, 17, 0.0f);
+    connectivity.Update(false, detached);
+    SetPillarLayers(connectivity, deltaIso, 16, 17, 2.0f);
+    connectivity.Update(true, detached);
+    CheckReported(*this, TEXT("Rejoined piece cut again"), detached, { 4 * PillarArea });
+    return !HasAnyErrors();
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVoxelConnectivityBaseBuildTest, "VoxelRendering.Octree.ConnectivityBuiltFromBase",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+// The pillar is cut while its base labels are still being built, as an edit landing before the task is done would.
+// Those labels must ignore the cut, and marking the cut dirty once they are ready reports the top it cut off.
+bool FVoxelConnectivityBaseBuildTest::RunTest(const FString& Parameters) {
+    const float isoLevel = 0.0f;
+    TArray<float> initIso;
+    TArray<float> deltaIso;
+    initIso.SetNumUninitialized(SamplesPerAxis * SamplesPerAxis * SamplesPerAxis);
+    deltaIso.SetNumZeroed(initIso.Num());
+    for (int z = 0; z < SamplesPerAxis; z++) {
+        for (int y = 0; y < SamplesPerAxis; y++) {
+            for (int x = 0; x < SamplesPerAxis; x++) {
+                bool bPillar = x >= PillarMin && x <= PillarMax && y >= PillarMin && y <= PillarMax && z <= 28;
+                initIso[x + y * SamplesPerAxis + z * SamplesPerAxis * SamplesPerAxis] = z < 10 || bPillar ? -1.0f : 1.0f;
+            }
+        }
+    }
+
+    VoxelConnectivity connectivity(initIso, deltaIso, SamplesPerAxis, isoLevel);
+    SetPillarLayers(connectivity, deltaIso, 16, 17, 2.0f);
+    std::atomic<bool> cancel(false);
+    connectivity.BuildFromBase(cancel);
+
+    TArray<VoxelSolidComponent> detached;
+    connectivity.MarkDirty(FIntVector(PillarMin, PillarMin, 16), FIntVector(PillarMax, PillarMax, 17));
+    connectivity.Update(true, detached);
+    CheckReported(*this, TEXT("Cut made during the build"), detached, { 11 * PillarArea });
+    return !HasAnyErrors();
+}
+
+#endif
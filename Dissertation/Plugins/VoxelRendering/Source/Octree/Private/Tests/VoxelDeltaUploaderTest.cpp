@@ -0,0 +1,128 @@
+#include "Misc/AutomationTest.h"
+#include "VoxelDeltaUploader.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace {
+    typedef VoxelDeltaUploader::BrickSnapshot BrickSnapshot;
+
+    // Rewrites every sample in the box with fresh values and marks it dirty, as an edit would
+    void EditRegion(VoxelDeltaUploader& uploader, FRandomStream& random, int isoValuesPerAxis, const FIntVector& regionMin, const FIntVector& regionMax,
+        TArray<float>& deltaIso, TArray<uint32>& deltaType)
+    {
+        for (int z = regionMin.Z; z <= regionMax.Z; z++) {
+            for (int y = regionMin.Y; y <= regionMax.Y; y++) {
+                for (int x = regionMin.X; x <= regionMax.X; x++) {
+                    int32 index = x + (y * isoValuesPerAxis) + (z * isoValuesPerAxis * isoValuesPerAxis);
+                    deltaIso[index] = random.FRandRange(-1.0f, 1.0f);
+                    deltaType[index] = random.RandRange(0, 7);
+                }
+            }
+        }
+        uploader.MarkDirty(regionMin, regionMax, true, true);
+    }
+
+    // Every sample a run holds must equal the source arrays as they were captured, and every brick of the edited box
+    // must be in the snapshot
+    template<typename T>
+    void CheckRuns(FAutomationTestBase& test, const TCHAR* label, const VoxelDeltaUploader& uploader, int isoValuesPerAxis,
+        const TArray<VoxelDeltaUploader::BrickRun>& runs, const TArray<T>& staging, const TArray<T>& expected, const FIntVector& regionMin, const FIntVector& regionMax)
+    {
+        int bricksPerAxis = uploader.GetBricksPerAxis();
+        TBitArray<> inSnapshot(false, bricksPerAxis * bricksPerAxis * bricksPerAxis);
+        int32 mismatches = 0;
+
+        for (const VoxelDeltaUploader::BrickRun& run : runs) {
+            for (int32 b = 0; b < run.brickCount; b++) {
+                int32 brick = run.firstBrick + b;
+                inSnapshot[brick] = true;
+                FIntVector origin = FIntVector(brick % bricksPerAxis, (brick / bricksPerAxis) % bricksPerAxis, brick / (bricksPerAxis * bricksPerAxis)) * voxelDeltaBrickSize;
+                const T* brickData = staging.GetData() + run.stagingOffset + b * VoxelDeltaUploader::BrickVolume;
+
+                for (int z = 0; z < voxelDeltaBrickSize && origin.Z + z < isoValuesPerAxis; z++) {
+                    for (int y = 0; y < voxelDeltaBrickSize && origin.Y + y < isoValuesPerAxis; y++) {
+                        for (int x = 0; x < voxelDeltaBrickSize && origin.X + x < isoValuesPerAxis; x++) {
+                            int32 sourceIndex = (origin.X + x) + ((origin.Y + y) * isoValuesPerAxis) + ((origin.Z + z) * isoValuesPerAxis * isoValuesPerAxis);
+                            T value = brickData[x + (y * voxelDeltaBrickSize) + (z * voxelDeltaBrickSize * voxelDeltaBrickSize)];
+                            mismatches += value != expected[sourceIndex] ? 1 : 0;
+                        }
+                    }
+                }
+            }
+        }
+        test.TestEqual(FString::Printf(TEXT("%s samples differing from the source at capture"), label), mismatches, 0);
+
+        FIntVector brickMin = regionMin / voxelDeltaBrickSize;
+        FIntVector brickMax = regionMax / voxelDeltaBrickSize;
+        int32 missing = 0;
+        for (int z = brickMin.Z; z <= brickMax.Z; z++)
+            for (int y = brickMin.Y; y <= brickMax.Y; y++)
+                for (int x = brickMin.X; x <= brickMax.X; x++)
+                    missing += inSnapshot[uploader.GetBrickIndex(FIntVector(x, y, z))] ? 0 : 1;
+        test.TestEqual(FString::Printf(TEXT("%s edited bricks missing"), label), missing, 0);
+    }
+
+    struct CapturedSnapshot {
+        TSharedPtr<const BrickSnapshot> snapshot;
+        TArray<float> iso;
+        TArray<uint32> type;
+        FIntVector regionMin;
+        FIntVector regionMax;
+    };
+
+    void CheckSnapshot(FAutomationTestBase& test, const TCHAR* label, const VoxelDeltaUploader& uploader, int isoValuesPerAxis, const CapturedSnapshot& captured) {
+        if (!test.TestTrue(FString::Printf(TEXT("%s was taken"), label), captured.snapshot.IsValid()))
+            return;
+        CheckRuns(test, label, uploader, isoValuesPerAxis, captured.snapshot->isoRuns, captured.snapshot->iso, captured.iso, captured.regionMin, captured.regionMax);
+        CheckRuns(test, label, uploader, isoValuesPerAxis, captured.snapshot->typeRuns, captured.snapshot->type, captured.type, captured.regionMin, captured.regionMax);
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVoxelDeltaSnapshotTest, "VoxelRendering.Octree.DeltaSnapshotsMatchSourceAtCapture",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+// Snapshots are held the way render commands hold them while the live arrays keep being edited, so a pooled snapshot
+// rewritten while still referenced shows up as samples that no longer match the arrays at the time it was taken.
+bool FVoxelDeltaSnapshotTest::RunTest(const FString& Parameters) {
+    // Not a whole number of bricks, so the last brick on each axis overhangs the grid
+    const int isoValuesPerAxis = voxelDeltaBrickSize * 4 + 3;
+    const int32 sampleCount = isoValuesPerAxis * isoValuesPerAxis * isoValuesPerAxis;
+    FRandomStream random(7);
+
+    VoxelDeltaUploader uploader(isoValuesPerAxis);
+    TArray<float> deltaIso;
+    TArray<uint32> deltaType;
+    deltaIso.SetNumZeroed(sampleCount);
+    deltaType.SetNumZeroed(sampleCount);
+
+    auto Capture = [&](const FIntVector& regionMin, const FIntVector& regionMax) {
+        EditRegion(uploader, random, isoValuesPerAxis, regionMin, regionMax, deltaIso, deltaType);
+        return CapturedSnapshot{ uploader.TakeSnapshot(deltaIso, deltaType), deltaIso, deltaType, regionMin, regionMax };
+    };
+
+    TestFalse(TEXT("Nothing dirty takes no snapshot"), uploader.TakeSnapshot(deltaIso, deltaType).IsValid());
+
+    // More snapshots in flight at once than the pool keeps, each later edit overlapping the ones before it
+    TArray<CapturedSnapshot> inFlight;
+    inFlight.Add(Capture(FIntVector(0), FIntVector(isoValuesPerAxis - 1)));
+    for (int32 i = 0; i < 6; i++) {
+        FIntVector regionMin(random.RandRange(0, isoValuesPerAxis - 1), random.RandRange(0, isoValuesPerAxis - 1), random.RandRange(0, isoValuesPerAxis - 1));
+        FIntVector regionMax = (regionMin + FIntVector(random.RandRange(0, 12))).ComponentMin(FIntVector(isoValuesPerAxis - 1));
+        inFlight.Add(Capture(regionMin, regionMax));
+    }
+    for (int32 i = 0; i < inFlight.Num(); i++)
+        CheckSnapshot(*this, *FString::Printf(TEXT("In flight snapshot %d"), i), uploader, isoValuesPerAxis, inFlight[i]);
+
+    // Letting the oldest go lets the pool reuse them, the ones still held must not change
+    CapturedSnapshot held = inFlight.Last();
+    inFlight.Reset();
+    for (int32 i = 0; i < 6; i++) {
+        CapturedSnapshot reused = Capture(FIntVector(i * 3), FIntVector(i * 3 + 9));
+        CheckSnapshot(*this, *FString::Printf(TEXT("Reused snapshot %d"), i), uploader, isoValuesPerAxis, reused);
+        CheckSnapshot(*this, TEXT("Held snapshot"), uploader, isoValuesPerAxis, held);
+        TestTrue(TEXT("Snapshot versions increase"), reused.snapshot->version > held.snapshot->version);
+    }
+    return !HasAnyErrors();
+}
+
+#endif
@@ -0,0 +1,138 @@
+#include "Misc/AutomationTest.h"
+#include "Octree.h"
+#include "VoxelEditQueue.h"
+#include "OctreeTestBodies.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace {
+    const int VoxelsPerAxis = 8;
+    const int Depth = 2;
+    const int BufferSizePerAxis = VoxelsPerAxis << Depth;
+    const int SamplesPerAxis = BufferSizePerAxis + 1;
+    const float Scale = 3200.0f;
+
+    VoxelEditCommand MakeCommand(EVoxelEditOp op, const FVector& position, float radius, float influence, uint32 paintType) {
+        VoxelEditCommand command;
+        command.op = op;
+        command.position = position;
+        command.radius = radius;
+        command.influence = influence;
+        command.paintType = command.WritesType() ? paintType : 0;
+        return command;
+    }
+
+    // A few brushes around one spot on the body's +x surface, all overlapping, so a run of commands keeps repeating
+    // the same brushes with different ops and paint types between them
+    VoxelEditCommand MakeRandomCommand(FRandomStream& random) {
+        static const EVoxelEditOp ops[] = { EVoxelEditOp::Add, EVoxelEditOp::Subtract, EVoxelEditOp::Paint };
+        float surface = Scale * 0.25f;
+        FVector position(surface, random.RandRange(0, 2) * 80.0f, random.RandRange(0, 1) * 80.0f);
+        float radius = random.RandRange(0, 1) == 0 ? 200.0f : 300.0f;
+        // Rare filters between the brushes, they must stop anything folding across them
+        EVoxelEditOp op = random.FRand() < 0.08f ? (random.RandBool() ? EVoxelEditOp::Smooth : EVoxelEditOp::Flatten) : ops[random.RandRange(0, 2)];
+        VoxelEditCommand command = MakeCommand(op, position, radius, 0.1f * random.RandRange(1, 4), random.RandRange(1, 3));
+        if (!command.IsFilter() && random.FRand() < 0.25f) {
+            command.shape = EVoxelEditShape::Capsule;
+            command.sweepStart = position + FVector(0.0f, 0.0f, 120.0f);
+        }
+        return command;
+    }
+
+    // Applies the batch coalesced in one go to one tree and every command as a batch of its own to another, the
+    // densities must agree to rounding and the types exactly
+    bool CheckCoalescedMatchesInOrder(FAutomationTestBase& test, const FString& label, const TArray<float>& iso, const TArray<uint32>& type,
+        const TArray<VoxelEditCommand>& commands, int32& outRemoved)
+    {
+        Octree inOrder(nullptr, 0.5f, Scale, VoxelsPerAxis, Depth, BufferSizePerAxis, iso, type);
+        for (const VoxelEditCommand& command : commands)
+            inOrder.ApplyEditBatch(MakeArrayView(&command, 1));
+
+        TArray<VoxelEditCommand> batch = commands;
+        outRemoved = VoxelEditQueue::Coalesce(batch);
+        Octree coalesced(nullptr, 0.5f, Scale, VoxelsPerAxis, Depth, BufferSizePerAxis, iso, type);
+        coalesced.ApplyEditBatch(batch);
+
+        const TArray<float>& expectedIso = inOrder.GetDeltaIsoValues();
+        const TArray<uint32>& expectedType = inOrder.GetDeltaTypeValues();
+        const TArray<float>& coalescedIso = coalesced.GetDeltaIsoValues();
+        const TArray<uint32>& coalescedType = coalesced.GetDeltaTypeValues();
+        int32 isoMismatches = 0;
+        int32 typeMismatches = 0;
+        float largestError = 0.0f;
+        for (int32 i = 0; i < expectedIso.Num(); i++) {
+            float error = FMath::Abs(expectedIso[i] - coalescedIso[i]);
+            largestError = FMath::Max(largestError, error);
+            isoMismatches += error > 1e-4f ? 1 : 0;
+            typeMismatches += expectedType[i] != coalescedType[i] ? 1 : 0;
+        }
+        if (isoMismatches == 0 && typeMismatches == 0) return true;
+
+        test.AddError(FString::Printf(TEXT("%s: %d of %d commands coalesced away, %d densities differ (largest by %f) and %d types"),
+            *label, outRemoved, commands.Num(), isoMismatches, largestError, typeMismatches));
+        return false;
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVoxelEditCoalesceTest, "VoxelRendering.Octree.CoalescedEditsMatchInOrder",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+// Coalescing must not change what a batch does. Hand written batches pin down which repeats fold and which are kept
+// apart by a write going the other way or a filter, then random mixed batches are checked against applying every
+// command in turn.
+bool FVoxelEditCoalesceTest::RunTest(const FString& Parameters) {
+    TArray<float> iso;
+    TArray<uint32> type;
+    MakeSphereBody(SamplesPerAxis, iso, type);
+
+    FVector a(Scale * 0.25f, 0.0f, 0.0f);
+    FVector b(Scale * 0.25f, 120.0f, 0.0f);
+    VoxelEditCommand subtractA = MakeCommand(EVoxelEditOp::Subtract, a, 250.0f, 0.2f, 0);
+    VoxelEditCommand subtractB = MakeCommand(EVoxelEditOp::Subtract, b, 250.0f, 0.2f, 0);
+    VoxelEditCommand addA = MakeCommand(EVoxelEditOp::Add, a, 250.0f, 0.2f, 2);
+    VoxelEditCommand addB = MakeCommand(EVoxelEditOp::Add, b, 250.0f, 0.2f, 2);
+    VoxelEditCommand paintB = MakeCommand(EVoxelEditOp::Paint, b, 250.0f, 0.2f, 3);
+    VoxelEditCommand paintA = MakeCommand(EVoxelEditOp::Paint, a, 250.0f, 0.2f, 3);
+    VoxelEditCommand smoothB = MakeCommand(EVoxelEditOp::Smooth, b, 250.0f, 0.5f, 0);
+
+    struct FixedBatch {
+        const TCHAR* label;
+        TArray<VoxelEditCommand> commands;
+        int32 expectedRemoved;
+    };
+    TArray<FixedBatch> fixedBatches = {
+        { TEXT("Repeats of one brush"), { subtractA, subtractA, subtractA }, 2 },
+        { TEXT("Repeat across a brush carving the same way"), { subtractA, subtractB, subtractA }, 1 },
+        { TEXT("Repeat across a brush adding"), { subtractA, addB, subtractA }, 0 },
+        { TEXT("Add repeated across a paint of another type"), { addA, paintB, addA }, 0 },
+        { TEXT("Add repeated across an add of the same type"), { addA, addB, addA }, 1 },
+        { TEXT("Paint repeated across a carve"), { paintA, subtractB, paintA }, 1 },
+        { TEXT("Repeat across a filter"), { subtractA, smoothB, subtractA }, 0 },
+        { TEXT("Repeats on both sides of a filter"), { subtractA, subtractA, smoothB, subtractA, subtractA }, 2 },
+    };
+    for (const FixedBatch& batch : fixedBatches) {
+        int32 removed = 0;
+        CheckCoalescedMatchesInOrder(*this, batch.label, iso, type, batch.commands, removed);
+        TestEqual(FString::Printf(TEXT("%s: commands coalesced away"), batch.label), removed, batch.expectedRemoved);
+    }
+
+    FRandomStream random(11);
+    int32 totalRemoved = 0;
+    int32 batchesKeptWhole = 0;
+    for (int32 trial = 0; trial < 24; trial++) {
+        TArray<VoxelEditCommand> commands;
+        int32 commandCount = random.RandRange(4, 16);
+        for (int32 i = 0; i < commandCount; i++)
+            commands.Add(MakeRandomCommand(random));
+
+        int32 removed = 0;
+        CheckCoalescedMatchesInOrder(*this, FString::Printf(TEXT("Random batch %d"), trial), iso, type, commands, removed);
+        totalRemoved += removed;
+        batchesKeptWhole += removed == 0 ? 1 : 0;
+    }
+    TestTrue(TEXT("Random batches coalesce some commands"), totalRemoved > 0);
+    TestTrue(TEXT("Random batches keep some repeats apart"), batchesKeptWhole > 0);
+    return !HasAnyErrors();
+}
+
+#endif
@@ -0,0 +1,89 @@
+#include "Misc/AutomationTest.h"
+#include "VoxelSDFBrush.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace {
+    const float SphereRadius = 100.0f;
+
+    // A closed UV sphere, rings of slices between the two poles
+    void MakeSphereMesh(int32 rings, int32 slices, TArray<FVector3f>& outPositions, TArray<uint32>& outIndices) {
+        outPositions.Add(FVector3f(0.0f, 0.0f, SphereRadius));
+        for (int32 ring = 1; ring < rings; ring++) {
+            float polar = PI * ring / rings;
+            for (int32 slice = 0; slice < slices; slice++) {
+                float azimuth = 2.0f * PI * slice / slices;
+                outPositions.Add(SphereRadius * FVector3f(FMath::Sin(polar) * FMath::Cos(azimuth), FMath::Sin(polar) * FMath::Sin(azimuth), FMath::Cos(polar)));
+            }
+        }
+        outPositions.Add(FVector3f(0.0f, 0.0f, -SphereRadius));
+
+        uint32 southPole = outPositions.Num() - 1;
+        auto RingVertex = [slices](int32 ring, int32 slice) { return (uint32)(1 + (ring - 1) * slices + slice % slices); };
+        for (int32 slice = 0; slice < slices; slice++) {
+            outIndices.Append({ 0, RingVertex(1, slice), RingVertex(1, slice + 1) });
+            for (int32 ring = 1; ring < rings - 1; ring++) {
+                outIndices.Append({ RingVertex(ring, slice), RingVertex(ring + 1, slice), RingVertex(ring + 1, slice + 1) });
+                outIndices.Append({ RingVertex(ring, slice), RingVertex(ring + 1, slice + 1), RingVertex(ring, slice + 1) });
+            }
+            outIndices.Append({ RingVertex(rings - 1, slice), southPole, RingVertex(rings - 1, slice + 1) });
+        }
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVoxelSDFVolumeTest, "VoxelRendering.Octree.SDFVolumeMatchesBruteForce",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+// Builds the volume of a sphere mesh and checks every grid sample against the distance to every triangle, with the
+// sign matching the sphere well inside and outside its surface. Reports the build time against the brute force pass.
+bool FVoxelSDFVolumeTest::RunTest(const FString& Parameters) {
+    const int32 resolution = 32;
+    const float padding = 20.0f;
+
+    TArray<FVector3f> positions;
+    TArray<uint32> indices;
+    MakeSphereMesh(12, 16, positions, indices);
+
+    double start = FPlatformTime::Seconds();
+    TSharedPtr<VoxelSDFVolume> volume = VoxelSDFVolume::BuildFromTriangles(positions, indices, resolution, padding);
+    double buildSeconds = FPlatformTime::Seconds() - start;
+    if (!TestTrue(TEXT("Volume built"), volume.IsValid()))
+        return false;
+
+    // The grid starts at the padded mesh bounds and is spaced so resolution samples span the longest axis
+    FBox3f meshBounds = FBox3f(positions.GetData(), positions.Num()).ExpandBy(padding);
+    float cellSize = meshBounds.GetSize().GetMax() / (resolution - 1);
+    FIntVector size(FMath::CeilToInt(meshBounds.GetSize().X / cellSize) + 1, FMath::CeilToInt(meshBounds.GetSize().Y / cellSize) + 1,
+        FMath::CeilToInt(meshBounds.GetSize().Z / cellSize) + 1);
+
+    start = FPlatformTime::Seconds();
+    int32 distanceErrors = 0;
+    int32 signErrors = 0;
+    for (int32 z = 0; z < size.Z; z++) {
+        for (int32 y = 0; y < size.Y; y++) {
+            for (int32 x = 0; x < size.X; x++) {
+                FVector3f point = meshBounds.Min + FVector3f((float)x, (float)y, (float)z) * cellSize;
+                double distanceSquared = UE_BIG_NUMBER;
+                for (int32 t = 0; t < indices.Num(); t += 3) {
+                    FVector closest = FMath::ClosestPointOnTriangleToPoint(FVector(point), FVector(positions[indices[t]]), FVector(positions[indices[t + 1]]), FVector(positions[indices[t + 2]]));
+                    distanceSquared = FMath::Min(distanceSquared, FVector::DistSquared(FVector(point), closest));
+                }
+
+                float sampled = volume->Sample(point);
+                distanceErrors += FMath::Abs(FMath::Abs(sampled) - FMath::Sqrt(distanceSquared)) > cellSize * 0.01f ? 1 : 0;
+                float radial = point.Size();
+                if (radial < SphereRadius * 0.8f) signErrors += sampled < 0.0f ? 0 : 1;
+                if (radial > SphereRadius * 1.05f) signErrors += sampled > 0.0f ? 0 : 1;
+            }
+        }
+    }
+    double bruteForceSeconds = FPlatformTime::Seconds() - start;
+
+    AddInfo(FString::Printf(TEXT("%d samples, %d triangles: build %.3f ms, brute force check %.3f ms"),
+        size.X * size.Y * size.Z, indices.Num() / 3, buildSeconds * 1000.0, bruteForceSeconds * 1000.0));
+    TestEqual(TEXT("Samples whose distance differs from the brute force distance"), distanceErrors, 0);
+    TestEqual(TEXT("Samples with the wrong sign"), signErrors, 0);
+    return !HasAnyErrors();
+}
+
+#endif
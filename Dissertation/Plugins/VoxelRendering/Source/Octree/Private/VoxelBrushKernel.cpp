@@ -0,0 +1,202 @@
+#include "VoxelBrushKernel.h"
+#include "OctreeModule.h"
+
+bool VoxelBrushKernel::ApplySphereIsoRow(float* RESTRICT isoRow, int32 xMin, int32 xMax, float centerX, float distanceYZSquared, float invRadius, float signedInfluence) {
+    const VectorRegister4Float one = VectorOneFloat();
+    const VectorRegister4Float zero = VectorZeroFloat();
+    const VectorRegister4Float minusOne = VectorNegate(one);
+    const VectorRegister4Float four = VectorSetFloat1(4.0f);
+    const VectorRegister4Float yz = VectorSetFloat1(distanceYZSquared);
+    const VectorRegister4Float scale = VectorSetFloat1(invRadius);
+    const VectorRegister4Float influence = VectorSetFloat1(signedInfluence);
+
+    VectorRegister4Float dx = VectorSubtract(MakeVectorRegisterFloat((float)xMin, (float)xMin + 1.0f, (float)xMin + 2.0f, (float)xMin + 3.0f), VectorSetFloat1(centerX));
+    VectorRegister4Float changed = zero;
+    int32 x = xMin;
+    for (; x + 4 <= xMax + 1; x += 4) {
+        VectorRegister4Float distance = VectorSqrt(VectorMultiplyAdd(dx, dx, yz));
+        VectorRegister4Float t = VectorMax(VectorSubtract(one, VectorMultiply(distance, scale)), zero);
+        VectorRegister4Float weight = VectorMultiply(influence, VectorMultiply(t, t));
+
+        VectorRegister4Float previous = VectorLoad(isoRow + x);
+        VectorRegister4Float modified = VectorMin(VectorMax(VectorAdd(previous, weight), minusOne), one);
+        VectorStore(modified, isoRow + x);
+        changed = VectorBitwiseOr(changed, VectorCompareNE(modified, previous));
+        dx = VectorAdd(dx, four);
+    }
+
+    bool bChanged = VectorMaskBits(changed) != 0;
+    if (x <= xMax)
+        bChanged |= ApplySphereIsoRowReference(isoRow, x, xMax, centerX, distanceYZSquared, invRadius, signedInfluence);
+    return bChanged;
+}
+
+bool VoxelBrushKernel::ApplySphereIsoRowReference(float* RESTRICT isoRow, int32 xMin, int32 xMax, float centerX, float distanceYZSquared, float invRadius, float signedInfluence) {
+    bool bChanged = false;
+    for (int32 x = xMin; x <= xMax; x++) {
+        float dx = x - centerX;
+        float t = FMath::Max(1.0f - FMath::Sqrt(dx * dx + distanceYZSquared) * invRadius, 0.0f);
+        float modified = FMath::Clamp(isoRow[x] + signedInfluence * t * t, -1.0f, 1.0f);
+        bChanged |= modified != isoRow[x];
+        isoRow[x] = modified;
+    }
+    return bChanged;
+}
+
+bool VoxelBrushKernel::ApplyCapsuleIsoRow(float* RESTRICT isoRow, int32 xMin, int32 xMax, float startX, float offsetY, float offsetZ, const FVector3f& axis, float invAxisLengthSquared, float invRadius, float signedInfluence) {
+    const VectorRegister4Float one = VectorOneFloat();
+    const VectorRegister4Float zero = VectorZeroFloat();
+    const VectorRegister4Float minusOne = VectorNegate(one);
+    const VectorRegister4Float four = VectorSetFloat1(4.0f);
+    const VectorRegister4Float axisX = VectorSetFloat1(axis.X);
+    const VectorRegister4Float axisY = VectorSetFloat1(axis.Y);
+    const VectorRegister4Float axisZ = VectorSetFloat1(axis.Z);
+    const VectorRegister4Float rowY = VectorSetFloat1(offsetY);
+    const VectorRegister4Float rowZ = VectorSetFloat1(offsetZ);
+    const VectorRegister4Float projectionYZ = VectorSetFloat1(offsetY * axis.Y + offsetZ * axis.Z);
+    const VectorRegister4Float invLengthSquared = VectorSetFloat1(invAxisLengthSquared);
+    const VectorRegister4Float scale = VectorSetFloat1(invRadius);
+    const VectorRegister4Float influence = VectorSetFloat1(signedInfluence);
+
+    VectorRegister4Float px = VectorSubtract(MakeVectorRegisterFloat((float)xMin, (float)xMin + 1.0f, (float)xMin + 2.0f, (float)xMin + 3.0f), VectorSetFloat1(startX));
+    VectorRegister4Float changed = zero;
+    int32 x = xMin;
+    for (; x + 4 <= xMax + 1; x += 4) {
+        VectorRegister4Float t = VectorMultiply(VectorMultiplyAdd(px, axisX, projectionYZ), invLengthSquared);
+        t = VectorMin(VectorMax(t, zero), one);
+        VectorRegister4Float dx = VectorNegateMultiplyAdd(axisX, t, px);
+        VectorRegister4Float dy = VectorNegateMultiplyAdd(axisY, t, rowY);
+        VectorRegister4Float dz = VectorNegateMultiplyAdd(axisZ, t, rowZ);
+        VectorRegister4Float distance = VectorSqrt(VectorMultiplyAdd(dx, dx, VectorMultiplyAdd(dy, dy, VectorMultiply(dz, dz))));
+        VectorRegister4Float falloff = VectorMax(VectorSubtract(one, VectorMultiply(distance, scale)), zero);
+        VectorRegister4Float weight = VectorMultiply(influence, VectorMultiply(falloff, falloff));
+
+        VectorRegister4Float previous = VectorLoad(isoRow + x);
+        VectorRegister4Float modified = VectorMin(VectorMax(VectorAdd(previous, weight), minusOne), one);
+        VectorStore(modified, isoRow + x);
+        changed = VectorBitwiseOr(changed, VectorCompareNE(modified, previous));
+        px = VectorAdd(px, four);
+    }
+
+    bool bChanged = VectorMaskBits(changed) != 0;
+    if (x <= xMax)
+        bChanged |= ApplyCapsuleIsoRowReference(isoRow, x, xMax, startX, offsetY, offsetZ, axis, invAxisLengthSquared, invRadius, signedInfluence);
+    return bChanged;
+}
+
+bool VoxelBrushKernel::ApplyCapsuleIsoRowReference(float* RESTRICT isoRow, int32 xMin, int32 xMax, float startX, float offsetY, float offsetZ, const FVector3f& axis, float invAxisLengthSquared, float invRadius, float signedInfluence) {
+    bool bChanged = false;
+    for (int32 x = xMin; x <= xMax; x++) {
+        FVector3f offset(x - startX, offsetY, offsetZ);
+        float t = FMath::Clamp((offset | axis) * invAxisLengthSquared, 0.0f, 1.0f);
+        float falloff = FMath::Max(1.0f - (offset - axis * t).Size() * invRadius, 0.0f);
+        float modified = FMath::Clamp(isoRow[x] + signedInfluence * falloff * falloff, -1.0f, 1.0f);
+        bChanged |= modified != isoRow[x];
+        isoRow[x] = modified;
+    }
+    return bChanged;
+}
+
+bool VoxelBrushKernel::ApplyDistanceIsoRow(float* RESTRICT isoRow, const float* RESTRICT distances, int32 count, float invFalloff, float signedInfluence) {
+    const VectorRegister4Float one = VectorOneFloat();
+    const VectorRegister4Float zero = VectorZeroFloat();
+    const VectorRegister4Float minusOne = VectorNegate(one);
+    const VectorRegister4Float scale = VectorSetFloat1(-invFalloff);
+    const VectorRegister4Float influence = VectorSetFloat1(signedInfluence);
+
+    VectorRegister4Float changed = zero;
+    int32 i = 0;
+    for (; i + 4 <= count; i += 4) {
+        VectorRegister4Float t = VectorMin(VectorMax(VectorMultiply(VectorLoad(distances + i), scale), zero), one);
+        VectorRegister4Float weight = VectorMultiply(influence, VectorMultiply(t, t));
+
+        VectorRegister4Float previous = VectorLoad(isoRow + i);
+        VectorRegister4Float modified = VectorMin(VectorMax(VectorAdd(previous, weight), minusOne), one);
+        VectorStore(modified, isoRow + i);
+        changed = VectorBitwiseOr(changed, VectorCompareNE(modified, previous));
+    }
+
+    bool bChanged = VectorMaskBits(changed) != 0;
+    for (; i < count; i++) {
+        float t = FMath::Clamp(-distances[i] * invFalloff, 0.0f, 1.0f);
+        float modified = FMath::Clamp(isoRow[i] + signedInfluence * t * t, -1.0f, 1.0f);
+        bChanged |= modified != isoRow[i];
+        isoRow[i] = modified;
+    }
+    return bChanged;
+}
+
+bool VoxelBrushKernel::FillTypeRowInside(uint32* RESTRICT typeRow, const float* RESTRICT distances, int32 count, uint32 type) {
+    bool bChanged = false;
+    for (int32 i = 0; i < count; i++) {
+        if (distances[i] > 0.0f) continue;
+        bChanged |= typeRow[i] != type;
+        typeRow[i] = type;
+    }
+    return bChanged;
+}
+
+bool VoxelBrushKernel::BlendSphereIsoRow(float* RESTRICT deltaRow, const float* RESTRICT initRow, const float* RESTRICT targetRow, int32 xMin, int32 xMax, float centerX, float distanceYZSquared, float invRadius, float influence) {
+    const VectorRegister4Float one = VectorOneFloat();
+    const VectorRegister4Float zero = VectorZeroFloat();
+    const VectorRegister4Float minusOne = VectorNegate(one);
+    const VectorRegister4Float four = VectorSetFloat1(4.0f);
+    const VectorRegister4Float yz = VectorSetFloat1(distanceYZSquared);
+    const VectorRegister4Float scale = VectorSetFloat1(invRadius);
+    const VectorRegister4Float strength = VectorSetFloat1(influence);
+
+    VectorRegister4Float dx = VectorSubtract(MakeVectorRegisterFloat((float)xMin, (float)xMin + 1.0f, (float)xMin + 2.0f, (float)xMin + 3.0f), VectorSetFloat1(centerX));
+    VectorRegister4Float changed = zero;
+    int32 x = xMin;
+    for (; x + 4 <= xMax + 1; x += 4) {
+        VectorRegister4Float distance = VectorSqrt(VectorMultiplyAdd(dx, dx, yz));
+        VectorRegister4Float t = VectorMax(VectorSubtract(one, VectorMultiply(distance, scale)), zero);
+        VectorRegister4Float weight = VectorMultiply(strength, VectorMultiply(t, t));
+
+        VectorRegister4Float init = VectorLoad(initRow + x);
+        VectorRegister4Float previous = VectorLoad(deltaRow + x);
+        VectorRegister4Float combined = VectorMin(VectorMax(VectorAdd(init, previous), zero), one);
+        combined = VectorMultiplyAdd(VectorSubtract(VectorLoad(targetRow + (x - xMin)), combined), weight, combined);
+        VectorRegister4Float modified = VectorMin(VectorMax(VectorSubtract(combined, init), minusOne), one);
+        VectorStore(modified, deltaRow + x);
+        changed = VectorBitwiseOr(changed, VectorCompareNE(modified, previous));
+        dx = VectorAdd(dx, four);
+    }
+
+    bool bChanged = VectorMaskBits(changed) != 0;
+    for (; x <= xMax; x++) {
+        float distanceX = x - centerX;
+        float t = FMath::Max(1.0f - FMath::Sqrt(distanceX * distanceX + distanceYZSquared) * invRadius, 0.0f);
+        float combined = FMath::Clamp(initRow[x] + deltaRow[x], 0.0f, 1.0f);
+        combined += influence * t * t * (targetRow[x - xMin] - combined);
+        float modified = FMath::Clamp(combined - initRow[x], -1.0f, 1.0f);
+        bChanged |= modified != deltaRow[x];
+        deltaRow[x] = modified;
+    }
+    return bChanged;
+}
+
+void VoxelBrushKernel::ConvolveRow(const float* RESTRICT source, float* RESTRICT target, int32 count, int32 tapStride, TConstArrayView<float> weights) {
+    int32 x = 0;
+    for (; x + 4 <= count; x += 4) {
+        VectorRegister4Float sum = VectorZeroFloat();
+        for (int32 tap = 0; tap < weights.Num(); tap++)
+            sum = VectorMultiplyAdd(VectorLoad(source + x + tap * tapStride), VectorSetFloat1(weights[tap]), sum);
+        VectorStore(sum, target + x);
+    }
+    for (; x < count; x++) {
+        float sum = 0.0f;
+        for (int32 tap = 0; tap < weights.Num(); tap++)
+            sum += source[x + tap * tapStride] * weights[tap];
+        target[x] = sum;
+    }
+}
+
+bool VoxelBrushKernel::FillTypeRow(uint32* RESTRICT typeRow, int32 xMin, int32 xMax, uint32 type) {
+    bool bChanged = false;
+    for (int32 x = xMin; x <= xMax; x++) {
+        bChanged |= typeRow[x] != type;
+        typeRow[x] = type;
+    }
+    return bChanged;
+}
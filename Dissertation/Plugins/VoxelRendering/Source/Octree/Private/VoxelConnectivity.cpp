@@ -0,0 +1,431 @@
+#include "VoxelConnectivity.h"
+#include "OctreeModule.h"
+#include "Async/ParallelFor.h"
+
+DECLARE_STATS_GROUP(TEXT("VoxelConnectivity"), STATGROUP_VoxelConnectivity, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Connectivity Update"), STAT_VoxelConnectivity_Update, STATGROUP_VoxelConnectivity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Bricks Relabelled"), STAT_VoxelConnectivity_Bricks, STATGROUP_VoxelConnectivity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Graph Nodes Searched"), STAT_VoxelConnectivity_Nodes, STATGROUP_VoxelConnectivity);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Components Detached"), STAT_VoxelConnectivity_Detached, STATGROUP_VoxelConnectivity);
+
+static const FIntVector FaceAxes[3] = { FIntVector(1, 0, 0), FIntVector(0, 1, 0), FIntVector(0, 0, 1) };
+
+// Roots are always the lowest sample index of their set, so labels come out in scan order whatever the union order
+static uint16 FindRoot(uint16* parents, uint16 sample) {
+    while (parents[sample] != sample) {
+        parents[sample] = parents[parents[sample]];
+        sample = parents[sample];
+    }
+    return sample;
+}
+
+static void UnionSamples(uint16* parents, uint16 a, uint16 b) {
+    a = FindRoot(parents, a);
+    b = FindRoot(parents, b);
+    if (a != b) parents[FMath::Max(a, b)] = FMath::Min(a, b);
+}
+
+VoxelConnectivity::VoxelConnectivity(const TArray<float>& inInitIso, const TArray<float>& inDeltaIso, int inSamplesPerAxis, float inIsoLevel) :
+    initIso(inInitIso), deltaIso(inDeltaIso), samplesPerAxis(inSamplesPerAxis), isoLevel(inIsoLevel)
+{
+    bricksPerAxis = FMath::DivideAndRoundUp(samplesPerAxis, BrickSize);
+    int32 brickCount = bricksPerAxis * bricksPerAxis * bricksPerAxis;
+    bricks.SetNum(brickCount);
+    dirtyBricks.Init(false, brickCount);
+}
+
+uint64 VoxelConnectivity::GetAllocatedBytes() const {
+    uint64 bytes = bricks.GetAllocatedSize() + dirtyBricks.GetAllocatedSize();
+    for (const Brick& brick : bricks)
+        bytes += brick.components.GetAllocatedSize() + brick.links.GetAllocatedSize();
+    return bytes;
+}
+
+void VoxelConnectivity::Build() {
+    BuildLayers(true, nullptr);
+}
+
+void VoxelConnectivity::BuildFromBase(const std::atomic<bool>& cancel) {
+    BuildLayers(false, &cancel);
+}
+
+// Labels a layer of bricks at a time across workers and links it to the layer below, so only two layers of labels
+// are ever held
+void VoxelConnectivity::BuildLayers(bool bWithDelta, const std::atomic<bool>* cancel) {
+    int32 layerCount = bricksPerAxis * bricksPerAxis;
+    for (Brick& brick : bricks) {
+        brick.components.Reset();
+        brick.links.Reset();
+    }
+    dirtyBricks.SetRange(0, dirtyBricks.Num(), false);
+    dirtyList.Reset();
+
+    TArray<BrickLabels> previous, current;
+    previous.SetNum(layerCount);
+    current.SetNum(layerCount);
+    for (int z = 0; z < bricksPerAxis; z++) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) return;
+        ParallelFor(layerCount, [&](int32 i) {
+            int32 brick = i + z * layerCount;
+            LabelBrick(brick, current[i], bricks[brick].components, bWithDelta);
+        });
+
+        for (int32 i = 0; i < layerCount; i++) {
+            int32 brick = i + z * layerCount;
+            if (i % bricksPerAxis + 1 < bricksPerAxis) LinkFace(brick, current[i], brick + 1, current[i + 1], 0);
+            if (i / bricksPerAxis + 1 < bricksPerAxis) LinkFace(brick, current[i], brick + bricksPerAxis, current[i + bricksPerAxis], 1);
+            if (z > 0) LinkFace(brick - layerCount, previous[i], brick, current[i], 2);
+        }
+        Swap(previous, current);
+    }
+}
+
+void VoxelConnectivity::MarkDirty(const FIntVector& regionMin, const FIntVector& regionMax) {
+    FIntVector brickMin = regionMin.ComponentMax(FIntVector(0)) / BrickSize;
+    FIntVector brickMax = regionMax.ComponentMin(FIntVector(samplesPerAxis - 1)) / BrickSize;
+
+    for (int z = brickMin.Z; z <= brickMax.Z; z++) {
+        for (int y = brickMin.Y; y <= brickMax.Y; y++) {
+            for (int x = brickMin.X; x <= brickMax.X; x++) {
+                int32 brick = GetBrickIndex(FIntVector(x, y, z));
+                if (dirtyBricks[brick]) continue;
+                dirtyBricks[brick] = true;
+                dirtyList.Add(brick);
+            }
+        }
+    }
+}
+
+void VoxelConnectivity::Update(bool bCanDetach, TArray<VoxelSolidComponent>& outDetached) {
+    lastRelabelledBricks = 0;
+    lastSearchedNodes = 0;
+    if (dirtyList.Num() == 0) return;
+    SCOPE_CYCLE_COUNTER(STAT_VoxelConnectivity_Update);
+
+    // The clean bricks beside the dirty ones are labelled again for their faces. Labelling is deterministic, so their
+    // labels match the components they already store.
+    TArray<int32> labelled = dirtyList;
+    TMap<int32, int32> labelSlots;
+    for (int32 i = 0; i < dirtyList.Num(); i++)
+        labelSlots.Add(dirtyList[i], i);
+    for (int32 brick : dirtyList) {
+        FIntVector coord = GetBrickCoord(brick);
+        for (int axis = 0; axis < 3; axis++) {
+            for (int side = -1; side <= 1; side += 2) {
+                FIntVector neighbour = coord + FaceAxes[axis] * side;
+                if (neighbour[axis] < 0 || neighbour[axis] >= bricksPerAxis) continue;
+                int32 neighbourIndex = GetBrickIndex(neighbour);
+                if (dirtyBricks[neighbourIndex] || labelSlots.Contains(neighbourIndex)) continue;
+                labelSlots.Add(neighbourIndex, labelled.Num());
+                labelled.Add(neighbourIndex);
+            }
+        }
+    }
+
+    TArray<BrickLabels> labels;
+    TArray<TArray<BrickComponent>> components;
+    labels.SetNum(labelled.Num());
+    components.SetNum(labelled.Num());
+    ParallelFor(labelled.Num(), [&](int32 i) {
+        LabelBrick(labelled[i], labels[i], components[i]);
+    });
+
+    // Components that were linked into a dirty brick may have had their only path to the body through it
+    TArray<uint64> seeds;
+    for (int32 brick : dirtyList) {
+        for (const BrickLink& link : bricks[brick].links) {
+            if (bCanDetach && !dirtyBricks[link.neighbourBrick])
+                seeds.Add(MakeNode(link.neighbourBrick, link.neighbourComponent));
+        }
+    }
+    for (int32 i = dirtyList.Num(); i < labelled.Num(); i++)
+        bricks[labelled[i]].links.RemoveAllSwap([this](const BrickLink& link) { return dirtyBricks[link.neighbourBrick]; });
+    for (int32 i = 0; i < dirtyList.Num(); i++) {
+        Brick& brick = bricks[dirtyList[i]];
+        InheritLoose(dirtyList[i], labels[i], brick.components, components[i]);
+        brick.components = MoveTemp(components[i]);
+        brick.links.Reset();
+    }
+
+    // Each dirty brick links its upper faces, and its lower faces where the brick below is clean
+    for (int32 i = 0; i < dirtyList.Num(); i++) {
+        int32 brick = dirtyList[i];
+        FIntVector coord = GetBrickCoord(brick);
+        for (int axis = 0; axis < 3; axis++) {
+            FIntVector upper = coord + FaceAxes[axis];
+            if (upper[axis] < bricksPerAxis) {
+                int32 upperIndex = GetBrickIndex(upper);
+                LinkFace(brick, labels[i], upperIndex, labels[labelSlots[upperIndex]], axis);
+            }
+            FIntVector lower = coord - FaceAxes[axis];
+            if (lower[axis] >= 0) {
+                int32 lowerIndex = GetBrickIndex(lower);
+                if (!dirtyBricks[lowerIndex])
+                    LinkFace(lowerIndex, labels[labelSlots[lowerIndex]], brick, labels[i], axis);
+            }
+        }
+    }
+
+    if (bCanDetach) {
+        for (int32 brick : dirtyList) {
+            for (int32 c = 0; c < bricks[brick].components.Num(); c++)
+                seeds.Add(MakeNode(brick, c));
+        }
+        FindDetached(seeds, outDetached);
+    }
+    ReattachLoose();
+
+    lastRelabelledBricks = dirtyList.Num();
+    INC_DWORD_STAT_BY(STAT_VoxelConnectivity_Bricks, lastRelabelledBricks);
+    for (int32 brick : dirtyList)
+        dirtyBricks[brick] = false;
+    dirtyList.Reset();
+}
+
+// Union find over the brick's solid samples, each joined to its solid -x, -y and -z neighbours. Samples past the end
+// of the grid are left empty.
+void VoxelConnectivity::LabelBrick(int32 brickIndex, BrickLabels& outLabels, TArray<BrickComponent>& outComponents, bool bWithDelta) const {
+    FIntVector origin = GetBrickCoord(brickIndex) * BrickSize;
+    FIntVector size = (FIntVector(samplesPerAxis) - origin).ComponentMin(FIntVector(BrickSize));
+    outLabels.SetNumUninitialized(BrickVolume);
+    FMemory::Memzero(outLabels.GetData(), BrickVolume * sizeof(uint16));
+    outComponents.Reset();
+
+    uint16 parents[BrickVolume];
+    int32 solidCount = 0;
+    for (int z = 0; z < size.Z; z++) {
+        for (int y = 0; y < size.Y; y++) {
+            int32 row = origin.X + (origin.Y + y) * samplesPerAxis + (origin.Z + z) * samplesPerAxis * samplesPerAxis;
+            for (int x = 0; x < size.X; x++) {
+                if (initIso[row + x] + (bWithDelta ? deltaIso[row + x] : 0.0f) >= isoLevel) continue;
+                uint16 local = (uint16)(x + y * BrickSize + z * BrickSize * BrickSize);
+                parents[local] = local;
+                outLabels[local] = 1;
+                solidCount++;
+                if (x > 0 && outLabels[local - 1]) UnionSamples(parents, local, local - 1);
+                if (y > 0 && outLabels[local - BrickSize]) UnionSamples(parents, local, local - BrickSize);
+                if (z > 0 && outLabels[local - BrickSize * BrickSize]) UnionSamples(parents, local, local - BrickSize * BrickSize);
+            }
+        }
+    }
+    if (solidCount == 0) return;
+
+    // A full brick is one component with every label already 1
+    if (solidCount == size.X * size.Y * size.Z) {
+        outComponents.Add({ origin, origin + size - FIntVector(1), solidCount });
+        return;
+    }
+
+    uint16 rootLabels[BrickVolume];
+    for (int z = 0; z < size.Z; z++) {
+        for (int y = 0; y < size.Y; y++) {
+            for (int x = 0; x < size.X; x++) {
+                uint16 local = (uint16)(x + y * BrickSize + z * BrickSize * BrickSize);
+                if (!outLabels[local]) continue;
+                FIntVector sample = origin + FIntVector(x, y, z);
+                uint16 root = FindRoot(parents, local);
+                if (root == local) {
+                    outComponents.Add({ sample, sample, 0 });
+                    rootLabels[local] = (uint16)outComponents.Num();
+                }
+                outLabels[local] = rootLabels[root];
+
+                BrickComponent& component = outComponents[rootLabels[root] - 1];
+                component.min = component.min.ComponentMin(sample);
+                component.max = component.max.ComponentMax(sample);
+                component.sampleCount++;
+            }
+        }
+    }
+}
+
+// A relabelled component stays attached if any of its samples lies inside the bounds of a component that was attached
+// before the edit. Only bounds are kept, so a loose sliver inside the bounds of an attached component of the same brick
+// is counted as attached.
+void VoxelConnectivity::InheritLoose(int32 brickIndex, const BrickLabels& labels, TConstArrayView<BrickComponent> previous, TArray<BrickComponent>& components) const {
+    FIntVector origin = GetBrickCoord(brickIndex) * BrickSize;
+    for (int32 c = 0; c < components.Num(); c++) {
+        BrickComponent& component = components[c];
+        component.bLoose = true;
+        for (const BrickComponent& before : previous) {
+            if (before.bLoose) continue;
+            FIntVector overlapMin = before.min.ComponentMax(component.min) - origin;
+            FIntVector overlapMax = before.max.ComponentMin(component.max) - origin;
+            for (int z = overlapMin.Z; z <= overlapMax.Z && component.bLoose; z++) {
+                for (int y = overlapMin.Y; y <= overlapMax.Y && component.bLoose; y++) {
+                    for (int x = overlapMin.X; x <= overlapMax.X && component.bLoose; x++)
+                        component.bLoose = labels[x + y * BrickSize + z * BrickSize * BrickSize] != c + 1;
+                }
+            }
+            if (!component.bLoose) break;
+        }
+    }
+}
+
+void VoxelConnectivity::LinkFace(int32 lowerBrick, const BrickLabels& lowerLabels, int32 upperBrick, const BrickLabels& upperLabels, int axis) {
+    static const int32 strides[3] = { 1, BrickSize, BrickSize * BrickSize };
+    int32 axisStride = strides[axis];
+    int32 uStride = strides[(axis + 1) % 3];
+    int32 vStride = strides[(axis + 2) % 3];
+
+    TArray<uint32, TInlineAllocator<16>> pairs;
+    uint32 lastPair = 0;
+    for (int v = 0; v < BrickSize; v++) {
+        for (int u = 0; u < BrickSize; u++) {
+            int32 face = u * uStride + v * vStride;
+            uint16 lowerLabel = lowerLabels[face + (BrickSize - 1) * axisStride];
+            uint16 upperLabel = upperLabels[face];
+            if (!lowerLabel || !upperLabel) continue;
+            uint32 pair = ((uint32)lowerLabel << 16) | upperLabel;
+            if (pair == lastPair) continue;
+            pairs.AddUnique(pair);
+            lastPair = pair;
+        }
+    }
+
+    for (uint32 pair : pairs) {
+        uint16 lowerComponent = (uint16)((pair >> 16) - 1);
+        uint16 upperComponent = (uint16)((pair & 0xffff) - 1);
+        bricks[lowerBrick].links.Add({ lowerComponent, upperComponent, upperBrick });
+        bricks[upperBrick].links.Add({ upperComponent, lowerComponent, lowerBrick });
+    }
+}
+
+// Every seed starts its own search over the brick graph unless an earlier seed already claimed it. The live searches
+// take one node each in turn; reaching a node another search owns folds that search's frontier into this one.
+void VoxelConnectivity::FindDetached(TConstArrayView<uint64> seeds, TArray<VoxelSolidComponent>& outDetached) {
+    struct Search {
+        TArray<uint64> queue;
+        int32 head = 0;
+        int32 mergedInto = INDEX_NONE;
+    };
+    TArray<Search> searches;
+    TMap<uint64, int32> owners;
+    for (uint64 seed : seeds) {
+        if (owners.Contains(seed)) continue;
+        owners.Add(seed, searches.Num());
+        searches.AddDefaulted_GetRef().queue.Add(seed);
+    }
+
+    auto FindSearch = [&searches](int32 search) {
+        while (searches[search].mergedInto != INDEX_NONE)
+            search = searches[search].mergedInto;
+        return search;
+    };
+
+    TArray<int32> live;
+    for (int32 s = 0; s < searches.Num(); s++)
+        live.Add(s);
+    TArray<int32> detached;
+    // Merged searches stay in live until their turn comes round, liveCount only counts the ones still searching
+    int32 liveCount = live.Num();
+
+    while (liveCount > 1) {
+        for (int32 i = 0; i < live.Num() && liveCount > 1;) {
+            int32 s = live[i];
+            Search& search = searches[s];
+            if (search.mergedInto != INDEX_NONE) {
+                live.RemoveAtSwap(i, EAllowShrinking::No);
+                continue;
+            }
+            // Nothing left to reach while another search is still going, so this piece is cut off from it
+            if (search.head == search.queue.Num()) {
+                detached.Add(s);
+                live.RemoveAtSwap(i, EAllowShrinking::No);
+                liveCount--;
+                continue;
+            }
+
+            uint64 node = search.queue[search.head++];
+            lastSearchedNodes++;
+            int32 component = GetNodeComponent(node);
+            for (const BrickLink& link : bricks[GetNodeBrick(node)].links) {
+                if (link.component != component) continue;
+                uint64 neighbour = MakeNode(link.neighbourBrick, link.neighbourComponent);
+                int32* owner = owners.Find(neighbour);
+                if (!owner) {
+                    owners.Add(neighbour, s);
+                    search.queue.Add(neighbour);
+                    continue;
+                }
+                int32 other = FindSearch(*owner);
+                if (other == s) continue;
+                Search& otherSearch = searches[other];
+                search.queue.Append(otherSearch.queue.GetData() + otherSearch.head, otherSearch.queue.Num() - otherSearch.head);
+                otherSearch.queue.Empty();
+                otherSearch.head = 0;
+                otherSearch.mergedInto = s;
+                liveCount--;
+            }
+            i++;
+        }
+    }
+    INC_DWORD_STAT_BY(STAT_VoxelConnectivity_Nodes, lastSearchedNodes);
+    if (detached.Num() == 0) return;
+
+    // A piece with nothing in it that was attached before the edit was already loose, so it is not reported again
+    TBitArray<> cutOff(false, searches.Num());
+    TBitArray<> wasAttached(false, searches.Num());
+    for (int32 s : detached)
+        cutOff[s] = true;
+    for (const TPair<uint64, int32>& owner : owners) {
+        int32 s = FindSearch(owner.Value);
+        if (cutOff[s] && !bricks[GetNodeBrick(owner.Key)].components[GetNodeComponent(owner.Key)].bLoose)
+            wasAttached[s] = true;
+    }
+
+    TArray<int32> resultSlots;
+    resultSlots.Init(INDEX_NONE, searches.Num());
+    int32 reported = 0;
+    for (int32 s : detached) {
+        if (!wasAttached[s]) continue;
+        resultSlots[s] = outDetached.Num();
+        outDetached.Add({ FIntVector(MAX_int32), FIntVector(MIN_int32), 0 });
+        reported++;
+    }
+    for (const TPair<uint64, int32>& owner : owners) {
+        int32 s = FindSearch(owner.Value);
+        if (!cutOff[s]) continue;
+        BrickComponent& component = bricks[GetNodeBrick(owner.Key)].components[GetNodeComponent(owner.Key)];
+        component.bLoose = true;
+        if (resultSlots[s] == INDEX_NONE) continue;
+        VoxelSolidComponent& result = outDetached[resultSlots[s]];
+        result.min = result.min.ComponentMin(component.min);
+        result.max = result.max.ComponentMax(component.max);
+        result.sampleCount += component.sampleCount;
+    }
+    INC_DWORD_STAT_BY(STAT_VoxelConnectivity_Detached, reported);
+}
+
+// A loose component now linked to an attached one in or beside a relabelled brick has been joined back onto the body,
+// and the rest of its piece with it. Costs nothing beyond the relabelled links unless a loose piece is rejoined.
+void VoxelConnectivity::ReattachLoose() {
+    TArray<uint64> queue;
+    for (int32 brick : dirtyList) {
+        for (const BrickLink& link : bricks[brick].links) {
+            BrickComponent& component = bricks[brick].components[link.component];
+            BrickComponent& neighbour = bricks[link.neighbourBrick].components[link.neighbourComponent];
+            if (component.bLoose == neighbour.bLoose) continue;
+            if (component.bLoose) {
+                component.bLoose = false;
+                queue.Add(MakeNode(brick, link.component));
+            } else {
+                neighbour.bLoose = false;
+                queue.Add(MakeNode(link.neighbourBrick, link.neighbourComponent));
+            }
+        }
+    }
+
+    for (int32 head = 0; head < queue.Num(); head++) {
+        int32 component = GetNodeComponent(queue[head]);
+        for (const BrickLink& link : bricks[GetNodeBrick(queue[head])].links) {
+            if (link.component != component) continue;
+            BrickComponent& neighbour = bricks[link.neighbourBrick].components[link.neighbourComponent];
+            if (!neighbour.bLoose) continue;
+            neighbour.bLoose = false;
+            queue.Add(MakeNode(link.neighbourBrick, link.neighbourComponent));
+        }
+    }
+    lastSearchedNodes += queue.Num();
+    INC_DWORD_STAT_BY(STAT_VoxelConnectivity_Nodes, queue.Num());
+}
@@ -0,0 +1,162 @@
+#include "VoxelDeltaUploader.h"
+#include "OctreeModule.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Crc.h"
+
+static TAutoConsoleVariable<int32> CVarValidateDeltaSnapshots(
+    TEXT("voxel.ValidateDeltaSnapshots"), 0,
+    TEXT("Checksum every delta snapshot when it is taken and again on the render thread before it is copied, and check snapshots arrive in version order."));
+
+DECLARE_STATS_GROUP(TEXT("VoxelDeltaUpload"), STATGROUP_VoxelDeltaUpload, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Gather Dirty Bricks"), STAT_VoxelDeltaUpload_Gather, STATGROUP_VoxelDeltaUpload);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Bricks Uploaded"), STAT_VoxelDeltaUpload_Bricks, STATGROUP_VoxelDeltaUpload);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Bytes Uploaded"), STAT_VoxelDeltaUpload_Bytes, STATGROUP_VoxelDeltaUpload);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Snapshots Allocated"), STAT_VoxelDeltaUpload_SnapshotsAllocated, STATGROUP_VoxelDeltaUpload);
+
+VoxelDeltaUploader::VoxelDeltaUploader(int inIsoValuesPerAxis) :
+    isoValuesPerAxis(inIsoValuesPerAxis), bricksPerAxis(FMath::DivideAndRoundUp(inIsoValuesPerAxis, voxelDeltaBrickSize)),
+    dirtyIsoCount(0), dirtyTypeCount(0), renderState(MakeShared<RenderState>()), snapshotVersion(0), lastUploadBytes(0)
+{
+    int32 brickCount = bricksPerAxis * bricksPerAxis * bricksPerAxis;
+    dirtyIsoBricks.Init(false, brickCount);
+    dirtyTypeBricks.Init(false, brickCount);
+}
+
+uint32 VoxelDeltaUploader::BrickSnapshot::ComputeChecksum() const {
+    uint32 crc = FCrc::MemCrc32(iso.GetData(), iso.Num() * sizeof(float));
+    return FCrc::MemCrc32(type.GetData(), type.Num() * sizeof(uint32), crc);
+}
+
+// Copy on write: a pooled snapshot is rewritten only when the pool holds the last reference to it,
+// otherwise a render command may still be reading it and a fresh one is allocated instead
+TSharedPtr<VoxelDeltaUploader::BrickSnapshot> VoxelDeltaUploader::AcquireSnapshot() {
+    for (TSharedPtr<BrickSnapshot>& snapshot : snapshotPool) {
+        if (snapshot.GetSharedReferenceCount() == 1)
+            return snapshot;
+    }
+
+    INC_DWORD_STAT(STAT_VoxelDeltaUpload_SnapshotsAllocated);
+    TSharedPtr<BrickSnapshot> snapshot = MakeShared<BrickSnapshot>();
+    if (snapshotPool.Num() < MaxPooledSnapshots)
+        snapshotPool.Add(snapshot);
+    return snapshot;
+}
+
+void VoxelDeltaUploader::MarkDirty(const FIntVector& regionMin, const FIntVector& regionMax, bool bIso, bool bType) {
+    FIntVector brickMin = regionMin.ComponentMax(FIntVector(0)) / voxelDeltaBrickSize;
+    FIntVector brickMax = regionMax.ComponentMin(FIntVector(isoValuesPerAxis - 1)) / voxelDeltaBrickSize;
+
+    for (int z = brickMin.Z; z <= brickMax.Z; z++) {
+        for (int y = brickMin.Y; y <= brickMax.Y; y++) {
+            for (int x = brickMin.X; x <= brickMax.X; x++) {
+                int32 brick = GetBrickIndex(FIntVector(x, y, z));
+                if (bIso && !dirtyIsoBricks[brick]) {
+                    dirtyIsoBricks[brick] = true;
+                    dirtyIsoCount++;
+                }
+                if (bType && !dirtyTypeBricks[brick]) {
+                    dirtyTypeBricks[brick] = true;
+                    dirtyTypeCount++;
+                }
+            }
+        }
+    }
+}
+
+void VoxelDeltaUploader::MarkAllDirty() {
+    dirtyIsoBricks.SetRange(0, dirtyIsoBricks.Num(), true);
+    dirtyTypeBricks.SetRange(0, dirtyTypeBricks.Num(), true);
+    dirtyIsoCount = dirtyIsoBricks.Num();
+    dirtyTypeCount = dirtyTypeBricks.Num();
+}
+
+// Copies every dirty brick from the flat source array into brick major order, merging consecutive bricks into one run
+template<typename T>
+void VoxelDeltaUploader::GatherDirtyBricks(TBitArray<>& dirtyBricks, int32& dirtyCount, const TArray<T>& source, TArray<T>& outStaging, TArray<BrickRun>& outRuns) const {
+    outStaging.Reset();
+    outRuns.Reset();
+    if (dirtyCount == 0) return;
+
+    outStaging.Reserve(dirtyCount * BrickVolume);
+    int sliceSize = isoValuesPerAxis * isoValuesPerAxis;
+
+    for (TConstSetBitIterator<> it(dirtyBricks); it; ++it) {
+        int32 brick = it.GetIndex();
+        if (outRuns.Num() > 0 && outRuns.Last().firstBrick + outRuns.Last().brickCount == brick)
+            outRuns.Last().brickCount++;
+        else outRuns.Add({ brick, 1, outStaging.Num() });
+
+        FIntVector origin = FIntVector(brick % bricksPerAxis, (brick / bricksPerAxis) % bricksPerAxis, brick / (bricksPerAxis * bricksPerAxis)) * voxelDeltaBrickSize;
+        int32 brickStart = outStaging.AddZeroed(BrickVolume);
+        T* brickData = outStaging.GetData() + brickStart;
+
+        // Samples past the end of the grid stay zero, the shaders never read them
+        int xCount = FMath::Min(voxelDeltaBrickSize, isoValuesPerAxis - origin.X);
+        for (int z = 0; z < voxelDeltaBrickSize && origin.Z + z < isoValuesPerAxis; z++) {
+            for (int y = 0; y < voxelDeltaBrickSize && origin.Y + y < isoValuesPerAxis; y++) {
+                int sourceIndex = origin.X + ((origin.Y + y) * isoValuesPerAxis) + ((origin.Z + z) * sliceSize);
+                FMemory::Memcpy(brickData + (y * voxelDeltaBrickSize) + (z * voxelDeltaBrickSize * voxelDeltaBrickSize), source.GetData() + sourceIndex, xCount * sizeof(T));
+            }
+        }
+    }
+
+    dirtyBricks.SetRange(0, dirtyBricks.Num(), false);
+    dirtyCount = 0;
+}
+
+TSharedPtr<const VoxelDeltaUploader::BrickSnapshot> VoxelDeltaUploader::TakeSnapshot(const TArray<float>& deltaIso, const TArray<uint32>& deltaType) {
+    lastUploadBytes = 0;
+    if (!HasDirtyBricks()) return nullptr;
+
+    TSharedPtr<BrickSnapshot> snapshot = AcquireSnapshot();
+    snapshot->version = ++snapshotVersion;
+
+    int32 brickCount = dirtyIsoCount + dirtyTypeCount;
+    {
+        SCOPE_CYCLE_COUNTER(STAT_VoxelDeltaUpload_Gather);
+        GatherDirtyBricks(dirtyIsoBricks, dirtyIsoCount, deltaIso, snapshot->iso, snapshot->isoRuns);
+        GatherDirtyBricks(dirtyTypeBricks, dirtyTypeCount, deltaType, snapshot->type, snapshot->typeRuns);
+    }
+    snapshot->bValidate = CVarValidateDeltaSnapshots.GetValueOnGameThread() != 0;
+    snapshot->checksum = snapshot->bValidate ? snapshot->ComputeChecksum() : 0;
+
+    lastUploadBytes = (uint64)snapshot->iso.Num() * sizeof(float) + (uint64)snapshot->type.Num() * sizeof(uint32);
+    INC_DWORD_STAT_BY(STAT_VoxelDeltaUpload_Bricks, brickCount);
+    INC_DWORD_STAT_BY(STAT_VoxelDeltaUpload_Bytes, (uint32)lastUploadBytes);
+    return snapshot;
+}
+
+void VoxelDeltaUploader::Upload(const TArray<float>& deltaIso, const TArray<uint32>& deltaType,
+    const TSharedPtr<FIsoDynamicBuffer>& isoBuffer, const TSharedPtr<FTypeDynamicBuffer>& typeBuffer)
+{
+    if (!isoBuffer.IsValid() || !typeBuffer.IsValid()) {
+        lastUploadBytes = 0;
+        return;
+    }
+    TSharedPtr<const BrickSnapshot> snapshot = TakeSnapshot(deltaIso, deltaType);
+    if (!snapshot.IsValid()) return;
+
+    ENQUEUE_RENDER_COMMAND(UploadDeltaBricks)(
+        [snapshot, renderState = renderState, isoBuffer, typeBuffer](FRHICommandListImmediate& RHICmdList)
+        {
+            if (snapshot->bValidate) {
+                ensureMsgf(snapshot->version > renderState->lastAppliedVersion, TEXT("Delta snapshot %llu applied after %llu"),
+                    snapshot->version, renderState->lastAppliedVersion);
+                ensureMsgf(snapshot->ComputeChecksum() == snapshot->checksum, TEXT("Delta snapshot %llu was modified while in flight"), snapshot->version);
+            }
+            renderState->lastAppliedVersion = snapshot->version;
+
+            for (const BrickRun& run : snapshot->isoRuns) {
+                uint32 size = run.brickCount * BrickVolume * sizeof(float);
+                void* lockedData = RHICmdList.LockBuffer(isoBuffer->buffer, run.firstBrick * BrickVolume * sizeof(float), size, RLM_WriteOnly);
+                FMemory::Memcpy(lockedData, snapshot->iso.GetData() + run.stagingOffset, size);
+                RHICmdList.UnlockBuffer(isoBuffer->buffer);
+            }
+            for (const BrickRun& run : snapshot->typeRuns) {
+                uint32 size = run.brickCount * BrickVolume * sizeof(uint32);
+                void* lockedData = RHICmdList.LockBuffer(typeBuffer->buffer, run.firstBrick * BrickVolume * sizeof(uint32), size, RLM_WriteOnly);
+                FMemory::Memcpy(lockedData, snapshot->type.GetData() + run.stagingOffset, size);
+                RHICmdList.UnlockBuffer(typeBuffer->buffer);
+            }
+        });
+}
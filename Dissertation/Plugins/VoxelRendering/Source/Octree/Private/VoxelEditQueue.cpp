@@ -0,0 +1,192 @@
+#include "VoxelEditQueue.h"
+#include "OctreeModule.h"
+#include "HAL/IConsoleManager.h"
+#include "Tasks/Task.h"
+
+DECLARE_STATS_GROUP(TEXT("VoxelEdits"), STATGROUP_VoxelEdits, STATCAT_Advanced);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Edits Pushed"), STAT_VoxelEdits_Pushed, STATGROUP_VoxelEdits);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Edits Drained"), STAT_VoxelEdits_Drained, STATGROUP_VoxelEdits);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Edits Coalesced"), STAT_VoxelEdits_Coalesced, STATGROUP_VoxelEdits);
+
+void VoxelEditQueue::Push(const VoxelEditCommand& command) {
+    queue.Enqueue(command);
+    INC_DWORD_STAT(STAT_VoxelEdits_Pushed);
+}
+
+int32 VoxelEditQueue::Drain(TArray<VoxelEditCommand>& outCommands, int32 maxCommands) {
+    int32 drained = 0;
+    VoxelEditCommand command;
+    while (drained < maxCommands && queue.Dequeue(command)) {
+        outCommands.Add(command);
+        drained++;
+    }
+    INC_DWORD_STAT_BY(STAT_VoxelEdits_Drained, drained);
+    return drained;
+}
+
+namespace {
+    struct EditMergeKey {
+        FVector position;
+        FVector sweepStart;
+        FQuat rotation;
+        const VoxelSDFBrush* sdfBrush;
+        float radius;
+        uint32 paintType;
+        EVoxelEditOp op;
+        EVoxelEditShape shape;
+
+        bool operator==(const EditMergeKey& other) const {
+            return op == other.op && shape == other.shape && paintType == other.paintType && radius == other.radius
+                && position == other.position && sweepStart == other.sweepStart && sdfBrush == other.sdfBrush && rotation == other.rotation;
+        }
+        friend uint32 GetTypeHash(const EditMergeKey& key) {
+            uint32 hash = HashCombine(GetTypeHash(key.position), GetTypeHash(key.radius));
+            if (key.shape == EVoxelEditShape::Capsule)
+                hash = HashCombine(hash, GetTypeHash(key.sweepStart));
+            if (key.shape == EVoxelEditShape::SDF)
+                hash = HashCombine(hash, PointerHash(key.sdfBrush));
+            return HashCombine(hash, ((uint32)key.op << 24) ^ ((uint32)key.shape << 16) ^ key.paintType);
+        }
+    };
+
+    // Every write of one kind from lastChange onwards carried the same value
+    struct EditWriteOrder {
+        int32 lastChange = 0;
+        uint32 current = 0;
+        bool bAny = false;
+
+        bool AllowsFold(int32 index, uint32 value) const { return !bAny || (index >= lastChange && value == current); }
+        void Note(int32 index, uint32 value) {
+            if (bAny && value != current) lastChange = index;
+            current = value;
+            bAny = true;
+        }
+    };
+}
+
+int32 VoxelEditQueue::Coalesce(TArray<VoxelEditCommand>& commands) {
+    TMap<EditMergeKey, int32> firstByKey;
+    firstByKey.Reserve(commands.Num());
+    EditWriteOrder isoOrder;
+    EditWriteOrder typeOrder;
+
+    int32 writeIndex = 0;
+    for (int32 i = 0; i < commands.Num(); i++) {
+        const VoxelEditCommand command = commands[i];
+        uint32 isoDirection = command.op == EVoxelEditOp::Add ? 1 : 0;
+        FVector sweepStart = command.shape == EVoxelEditShape::Capsule ? command.sweepStart : FVector::ZeroVector;
+        bool bSDF = command.shape == EVoxelEditShape::SDF;
+        EditMergeKey key{ command.position, sweepStart, bSDF ? command.rotation : FQuat::Identity, bSDF ? command.sdfBrush.Get() : nullptr,
+            command.radius, command.WritesType() ? command.paintType : 0, command.op, command.shape };
+
+        // A filter's result depends on every iso write before it, so nothing folds across one
+        if (command.IsFilter()) {
+            firstByKey.Reset();
+            commands[writeIndex++] = command;
+            continue;
+        }
+
+        if (int32* first = firstByKey.Find(key)) {
+            bool bIsoFolds = !command.WritesIso() || isoOrder.AllowsFold(*first, isoDirection);
+            bool bTypeFolds = !command.WritesType() || typeOrder.AllowsFold(*first, command.paintType);
+            if (bIsoFolds && bTypeFolds) {
+                if (command.WritesIso())
+                    commands[*first].influence += command.influence;
+                continue;
+            }
+        }
+
+        if (command.WritesIso())
+            isoOrder.Note(writeIndex, isoDirection);
+        if (command.WritesType())
+            typeOrder.Note(writeIndex, command.paintType);
+        firstByKey.Add(key, writeIndex);
+        commands[writeIndex++] = command;
+    }
+
+    int32 removed = commands.Num() - writeIndex;
+    commands.SetNum(writeIndex, EAllowShrinking::No);
+    INC_DWORD_STAT_BY(STAT_VoxelEdits_Coalesced, removed);
+    return removed;
+}
+
+bool VoxelEditStroke::Advance(EVoxelEditOp op, const FVector& position, float deltaSeconds, float stepSeconds, FVector& outSweepStart, int32& outSteps) {
+    if (!bActive || op != strokeOp) {
+        bActive = true;
+        strokeOp = op;
+        segmentStart = position;
+        pendingSeconds = stepSeconds;
+    }
+    else pendingSeconds += deltaSeconds;
+
+    if (stepSeconds <= 0.0f) outSteps = 1;
+    else {
+        outSteps = FMath::FloorToInt(pendingSeconds / stepSeconds);
+        if (outSteps == 0) return false;
+        pendingSeconds -= outSteps * stepSeconds;
+        outSteps = FMath::Min(outSteps, MaxStepsPerSegment);
+        pendingSeconds = FMath::Min(pendingSeconds, stepSeconds);
+    }
+
+    outSweepStart = segmentStart;
+    segmentStart = position;
+    return true;
+}
+
+// voxel.BenchmarkEditQueue [producers] [editsPerProducer]: producers push brushes from a small set of positions as
+// fast as they can while this thread drains and coalesces in frame sized batches, as the game thread would.
+static void BenchmarkEditQueue(const TArray<FString>& args) {
+    int32 producerCount = args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*args[0])) : 4;
+    int32 editsPerProducer = args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*args[1])) : 100000;
+    constexpr int32 PositionCount = 64;
+    constexpr int32 BatchLimit = 4096;
+
+    VoxelEditQueue queue;
+    double start = FPlatformTime::Seconds();
+    TArray<UE::Tasks::TTask<void>> producers;
+    for (int32 p = 0; p < producerCount; p++) {
+        producers.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION, [&queue, p, editsPerProducer]() {
+            FRandomStream random(p + 1);
+            for (int32 i = 0; i < editsPerProducer; i++) {
+                VoxelEditCommand command;
+                command.op = (EVoxelEditOp)random.RandRange(0, 2);
+                command.position = FVector(random.RandRange(0, PositionCount - 1) * 10.0f, 0.0f, 0.0f);
+                command.radius = 30.0f;
+                command.influence = 0.1f;
+                command.paintType = 1;
+                queue.Push(command);
+            }
+        }));
+    }
+
+    TArray<VoxelEditCommand> batch;
+    int64 drained = 0;
+    int64 coalesced = 0;
+    int32 batches = 0;
+    double drainSeconds = 0.0;
+    auto DrainBatch = [&]() {
+        double drainStart = FPlatformTime::Seconds();
+        batch.Reset();
+        int32 count = queue.Drain(batch, BatchLimit);
+        coalesced += VoxelEditQueue::Coalesce(batch);
+        drainSeconds += FPlatformTime::Seconds() - drainStart;
+        drained += count;
+        batches += count > 0 ? 1 : 0;
+        return count;
+    };
+
+    while (!UE::Tasks::Wait(producers, FTimespan::Zero()))
+        DrainBatch();
+    double pushSeconds = FPlatformTime::Seconds() - start;
+    while (DrainBatch() > 0) {}
+
+    int64 pushed = (int64)producerCount * editsPerProducer;
+    UE_LOG(LogTemp, Log, TEXT("Voxel edit queue: %d producers pushed %lld edits in %.2f ms (%.1f M/s), drained %lld in %d batches, %lld coalesced, %.3f ms per batch"),
+        producerCount, pushed, pushSeconds * 1000.0, pushed / FMath::Max(pushSeconds, 1e-9) / 1e6, drained, batches, coalesced,
+        batches > 0 ? drainSeconds * 1000.0 / batches : 0.0);
+}
+
+static FAutoConsoleCommand CBenchmarkEditQueue(
+    TEXT("voxel.BenchmarkEditQueue"),
+    TEXT("Push edits from several producer threads while draining them in batches: voxel.BenchmarkEditQueue [producers] [editsPerProducer]"),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkEditQueue));
@@ -0,0 +1,235 @@
+#include "VoxelLODSelector.h"
+#include "OctreeModule.h"
+#include "MortonCode.h"
+
+DECLARE_STATS_GROUP(TEXT("VoxelLODSelector"), STATGROUP_VoxelLODSelector, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("LOD Select"), STAT_VoxelLODSelector_Select, STATGROUP_VoxelLODSelector);
+DECLARE_CYCLE_STAT(TEXT("LOD Balance"), STAT_VoxelLODSelector_Balance, STATGROUP_VoxelLODSelector);
+
+void VoxelLODSelector::Select(const VoxelLODSelectionInput& input, VoxelLODSelectionResult& outResult) {
+    SCOPE_CYCLE_COUNTER(STAT_VoxelLODSelector_Select);
+    const VoxelTopologySnapshot& topology = *input.topology;
+
+    // Every array is refilled in place, so a result reused from the last selection keeps its capacity
+    outResult.visibleNodes.Reset();
+    outResult.refined.Reset();
+    outResult.refined.Add(false, topology.Num());
+    if (input.wasRefined.IsValid())
+        outResult.refined.SetRangeFromRange(0, FMath::Min(input.wasRefined->Num(), topology.Num()), *input.wasRefined, 0);
+    TBitArray<>& visible = outResult.visible;
+    visible.Reset();
+    visible.Add(false, topology.Num());
+
+    TArray<int32, TInlineAllocator<64>> stack;
+    stack.Add(0);
+    while (stack.Num() > 0) {
+        int32 index = stack.Pop(EAllowShrinking::No);
+        if (topology.IsLeaf(index) || topology.GetDepth(index) >= input.maxDepth || !ShouldRefine(input, index, outResult.refined)) {
+            visible[index] = true;
+            outResult.visibleNodes.Add(index);
+            continue;
+        }
+        for (int i = 7; i >= 0; i--)
+            stack.Add(topology.GetFirstChild(index) + i);
+    }
+
+    if (input.bBalance)
+        Balance(topology, visible, outResult.visibleNodes, outResult.workList);
+
+    outResult.finestNodeSize = MAX_flt;
+    for (int32 index : outResult.visibleNodes)
+        outResult.finestNodeSize = FMath::Min(outResult.finestNodeSize, topology.GetBounds(index).Size().X);
+}
+
+bool VoxelLODSelector::ShouldRefine(const VoxelLODSelectionInput& input, int32 index, TBitArray<>& refined) {
+    AABB bounds = input.topology->GetBounds(index);
+    if (!input.bScreenSpaceError)
+        return OctreeNode::RayIntersectsBounds(bounds, input.view);
+
+    int depth = input.topology->GetDepth(index);
+    float hysteresis = input.hysteresisPerDepth.IsValid() && input.hysteresisPerDepth->IsValidIndex(depth) ? (*input.hysteresisPerDepth)[depth] : 0.0f;
+    bool refine = OctreeNode::BoundsExceedScreenSpaceError(bounds, input.topology->voxelsPerAxis, input.view, hysteresis, refined[index]);
+    refined[index] = refine;
+    return refine;
+}
+
+// Restricted octree balancing over the visible cut: a visible node may be at most one level finer than the visible
+// node across any of its faces. The coarser side is split one level at a time and its children are queued, so the
+// refinement ripples outwards. Every node is queued once per time it becomes visible, keeping the pass linear in
+// the size of the cut (times a depth-bounded ancestor walk per face).
+void VoxelLODSelector::Balance(const VoxelTopologySnapshot& topology, TBitArray<>& visible, TArray<int32>& visibleNodes, TArray<int32>& workList) {
+    SCOPE_CYCLE_COUNTER(STAT_VoxelLODSelector_Balance);
+    workList.Reset();
+    workList.Append(visibleNodes);
+
+    while (workList.Num() > 0) {
+        int32 index = workList.Pop(EAllowShrinking::No);
+        if (!visible[index]) continue;
+
+        int depth = topology.GetDepth(index);
+        for (int direction = 0; direction < 6; direction++) {
+            uint64 neighbourKey = MortonCode::GetNeighbour(topology.GetKey(index), neighborOffsets[direction]);
+            if (neighbourKey == 0) continue;
+
+            int32 coarseIndex = FindVisibleAncestor(topology, visible, neighbourKey);
+            while (coarseIndex != INDEX_NONE && topology.GetDepth(coarseIndex) + 1 < depth && !topology.IsLeaf(coarseIndex)) {
+                visible[coarseIndex] = false;
+                int32 firstChild = topology.GetFirstChild(coarseIndex);
+                for (int i = 0; i < 8; i++) {
+                    visible[firstChild + i] = true;
+                    workList.Add(firstChild + i);
+                    visibleNodes.Add(firstChild + i);
+                }
+                coarseIndex = FindVisibleAncestor(topology, visible, neighbourKey);
+            }
+        }
+    }
+
+    visibleNodes.RemoveAll([&visible](int32 index) { return !visible[index]; });
+}
+
+// The visible nodes form a cut, so at most one node on the path from the root to the key is visible. The path is
+// walked down through the first child links, the snapshot has no key lookup.
+int32 VoxelLODSelector::FindVisibleAncestor(const VoxelTopologySnapshot& topology, const TBitArray<>& visible, uint64 key) {
+    int depth = MortonCode::GetDepth(key);
+    int32 index = 0;
+    for (int level = 0; level <= depth; level++) {
+        if (visible[index]) return index;
+        if (level == depth || topology.IsLeaf(index)) break;
+        index = topology.GetFirstChild(index) + (int32)((key >> (3 * (depth - level - 1))) & 7);
+    }
+    return INDEX_NONE;
+}
+
+// The original balancing over the live nodes, kept as a reference for benchmarking Balance against. Every visible node
+// is tested against every other for adjacency and the pass restarts after each split, so it is quadratic in the cut or worse.
+namespace {
+    void SetChildrenVisible(TArray<OctreeNode*>& pushStack, OctreeNode* node, int currentDepth, int targetDepth) {
+        if (!node) return;
+
+        if (currentDepth >= targetDepth || node->IsLeaf()) {
+            pushStack.Add(node);
+            node->SetVisible(true);
+            return;
+        }
+
+        for (int l = 0; l < 8; l++)
+            SetChildrenVisible(pushStack, node->GetChild(l), (currentDepth + 1), targetDepth);
+    }
+
+    bool AreAdjacent(OctreeNode* a, OctreeNode* b, const FIntVector& direction) {
+        const float epsilon = 0.0001f;
+        const AABB& boundsA = a->GetBounds();
+        const AABB& boundsB = b->GetBounds();
+
+        for (int axis = 0; axis < 3; axis++) {
+            if (FMath::Abs(direction[axis]) > 0.5f) {
+                float faceA = direction[axis] > 0 ? boundsA.max[axis] : boundsA.min[axis];
+                float faceB = direction[axis] > 0 ? boundsB.min[axis] : boundsB.max[axis];
+
+                if (FMath::Abs(faceA - faceB) > epsilon) // faceA != faceB
+                    return false;
+            }
+            else {
+                if (boundsA.max[axis] <= boundsB.min[axis] + epsilon || boundsA.min[axis] >= boundsB.max[axis] - epsilon)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    void GetNodesAdjacent(TArray<OctreeNode*>& adjNodes, OctreeNode* node, const TArray<OctreeNode*>& visibleNodes, FIntVector offset) {
+        FVector nodeScale = node->GetNodeSize();
+        for (OctreeNode* checkNode : visibleNodes) {
+            if (checkNode == node) continue;
+
+            if (AreAdjacent(checkNode, node, offset))
+                adjNodes.Add(checkNode);
+        }
+    }
+
+    int GetAdjacencyIndex(OctreeNode* node, OctreeNode* adjacentNode, int offsetIndex)
+    {
+        FIntVector offset = neighborOffsets[offsetIndex];
+        const float epsilon = 0.0001f;
+
+        const AABB& boundsA = adjacentNode->GetBounds();
+        const AABB& boundsB = node->GetBounds();
+
+        int mainAxis = (offset.X != 0) ? 0 : (offset.Y != 0) ? 1 : 2;
+
+        int axisA = (mainAxis + 1) % 3;
+        int axisB = (mainAxis + 2) % 3;
+
+        FIntVector2 index;
+        index.X = boundsA.max[axisA] + epsilon >= boundsB.max[axisA] ? 1 : 0;
+        index.Y = boundsA.max[axisB] + epsilon >= boundsB.max[axisB] ? 1 : 0;
+
+        int flatIndex = index.X + (index.Y * 2);
+        return flatIndex;
+    }
+
+    bool BalanceNode(TArray<OctreeNode*>& removalStack, TArray<OctreeNode*>& pushStack, TArray<OctreeNode*>& visibleNodes, OctreeNode* node) {
+        if (node->IsLeaf()) return false;
+        node->ResetTransVoxelData();
+        FVector nodeSize = node->GetNodeSize();
+
+        int nodeDepth = node->GetDepth();
+
+        for (int i = 0; i < 6; i++) {
+            FIntVector offset = neighborOffsets[i];
+            TArray<OctreeNode*> neighbors;
+            GetNodesAdjacent(neighbors, node, visibleNodes, offset);
+
+            if (neighbors.Num() == 0)
+                continue;
+
+            int deepestAdjacentDepth = 0;
+            OctreeNode* deepestAdjacentNode;
+
+            for (OctreeNode* adjNode : neighbors) {
+                int nodeDifference = adjNode->GetDepth() - node->GetDepth();
+
+                if (nodeDifference > deepestAdjacentDepth) {
+                    deepestAdjacentNode = adjNode;
+                    deepestAdjacentDepth = nodeDifference;
+                }
+
+                if (nodeDifference == 1)
+                    node->AssignTransVoxelData(i, adjNode, GetAdjacencyIndex(node, adjNode, i));
+            }
+            if (deepestAdjacentDepth < 2) continue;
+
+            SetChildrenVisible(pushStack, node, 0, deepestAdjacentDepth - 1);
+            node->ResetTransVoxelData();
+            node->SetVisible(false);
+            removalStack.Add(node);
+            return true;
+        }
+        return false;
+    }
+}
+
+void VoxelLODSelector::BalanceLegacy(TArray<OctreeNode*>& visibleNodes) {
+    TArray<OctreeNode*> removalStack;
+    TArray<OctreeNode*> pushStack;
+    bool reBalance = false;
+
+    for (OctreeNode* node : visibleNodes) {
+        reBalance = BalanceNode(removalStack, pushStack, visibleNodes, node);
+        if (reBalance) break;
+    }
+
+    visibleNodes.RemoveAll([&](OctreeNode* n) {
+        return removalStack.Contains(n);
+    });
+
+    for (OctreeNode* node : pushStack) {
+        if (!visibleNodes.Contains(node)) {
+            visibleNodes.Add(node);
+        }
+    }
+
+    if (reBalance)
+        BalanceLegacy(visibleNodes);
+}
@@ -0,0 +1,91 @@
+#include "VoxelRenderResourceTable.h"
+#include "OctreeModule.h"
+
+DECLARE_STATS_GROUP(TEXT("VoxelRenderResources"), STATGROUP_VoxelRenderResources, STATCAT_Advanced);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Live Resource Sets"), STAT_VoxelRenderResources_Live, STATGROUP_VoxelRenderResources);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Stale Handle Resolves"), STAT_VoxelRenderResources_Stale, STATGROUP_VoxelRenderResources);
+
+VoxelRenderResourceTable& VoxelRenderResourceTable::Get() {
+    static VoxelRenderResourceTable table;
+    return table;
+}
+
+VoxelRenderHandle VoxelRenderResourceTable::Create(uint32 isoBufferSize, uint32 vertexBufferSize) {
+    check(IsInGameThread());
+    uint32 index;
+    {
+        FScopeLock lock(&freeSlotsLock);
+        if (freeSlots.Num() > 0) index = freeSlots.Pop(EAllowShrinking::No);
+        else {
+            index = slotCount++;
+            checkf(index <= VoxelRenderHandle::IndexMask, TEXT("Voxel render resource table is full"));
+            if (!chunks[index / SlotsPerChunk].IsValid())
+                chunks[index / SlotsPerChunk] = MakeUnique<Slot[]>(SlotsPerChunk);
+        }
+    }
+
+    Slot& slot = GetSlot(index);
+    slot.resources.vertexFactory = new FVoxelVertexFactory(vertexBufferSize);
+    slot.resources.isoBuffer = new FIsoDynamicBuffer(isoBufferSize);
+    slot.resources.typeBuffer = new FTypeDynamicBuffer(isoBufferSize);
+
+    liveCount++;
+    INC_DWORD_STAT(STAT_VoxelRenderResources_Live);
+    return VoxelRenderHandle::Make(index, slot.generation);
+}
+
+void VoxelRenderResourceTable::Release(TConstArrayView<VoxelRenderHandle> handles) {
+    check(IsInGameThread());
+    TArray<VoxelRenderHandle> released;
+    released.Reserve(handles.Num());
+    for (VoxelRenderHandle handle : handles) {
+        if (handle.IsValid())
+            released.Add(handle);
+    }
+    if (released.Num() == 0) return;
+
+    liveCount -= released.Num();
+    DEC_DWORD_STAT_BY(STAT_VoxelRenderResources_Live, released.Num());
+
+    ENQUEUE_RENDER_COMMAND(ReleaseVoxelRenderResources)(
+        [this, released = MoveTemp(released)](FRHICommandListImmediate& RHICmdList)
+        {
+            ReleaseRenderThread(released);
+        });
+}
+
+void VoxelRenderResourceTable::ReleaseRenderThread(TConstArrayView<VoxelRenderHandle> handles) {
+    check(IsInRenderingThread());
+    for (VoxelRenderHandle handle : handles) {
+        Slot& slot = GetSlot(handle.GetIndex());
+        check(slot.generation == handle.GetGeneration());
+
+        slot.resources.vertexFactory->ReleaseResource();
+        slot.resources.isoBuffer->ReleaseResource();
+        slot.resources.typeBuffer->ReleaseResource();
+        delete slot.resources.vertexFactory;
+        delete slot.resources.isoBuffer;
+        delete slot.resources.typeBuffer;
+        slot.resources = VoxelRenderResources();
+
+        // Generation zero is skipped so a recycled slot never produces the null handle
+        slot.generation = (slot.generation + 1) & VoxelRenderHandle::GenerationMask;
+        if (slot.generation == 0) slot.generation = 1;
+    }
+
+    FScopeLock lock(&freeSlotsLock);
+    for (VoxelRenderHandle handle : handles)
+        freeSlots.Add(handle.GetIndex());
+}
+
+const VoxelRenderResources* VoxelRenderResourceTable::Resolve(VoxelRenderHandle handle) const {
+    check(IsInRenderingThread());
+    if (!handle.IsValid()) return nullptr;
+
+    const Slot& slot = GetSlot(handle.GetIndex());
+    if (slot.generation != handle.GetGeneration()) {
+        INC_DWORD_STAT(STAT_VoxelRenderResources_Stale);
+        return nullptr;
+    }
+    return &slot.resources;
+}
@@ -0,0 +1,66 @@
+#include "VoxelResourcePool.h"
+#include "OctreeModule.h"
+#include "Misc/App.h"
+
+VoxelResourcePool::VoxelResourcePool(uint32 inIsoBufferSize, uint32 inVertexBufferSize) :
+    isoBufferSize(inIsoBufferSize), vertexBufferSize(inVertexBufferSize), bCreateGPUResources(FApp::CanEverRender())
+{
+    // Vertex, normal, type and index streams plus the node's avg iso and type buffers
+    uint64 vertexBytes = (uint64)vertexBufferSize * (2 * sizeof(FVector3f) + 2 * sizeof(uint32));
+    uint64 isoBytes = (uint64)isoBufferSize * (sizeof(float) + sizeof(uint32));
+    bytesPerResourceSet = vertexBytes + isoBytes;
+}
+
+VoxelResourcePool::~VoxelResourcePool() {
+    ReleasePooled();
+}
+
+VoxelRenderHandle VoxelResourcePool::Acquire() {
+    if (pooledResources.Num() > 0)
+        return pooledResources.Pop(EAllowShrinking::No);
+    if (!bCreateGPUResources)
+        return VoxelRenderHandle();
+
+    VoxelRenderHandle handle = VoxelRenderResourceTable::Get().Create(isoBufferSize, vertexBufferSize);
+    pendingInit.Add(handle);
+    return handle;
+}
+
+void VoxelResourcePool::SubmitPendingInit() {
+    if (pendingInit.Num() == 0) return;
+
+    ENQUEUE_RENDER_COMMAND(InitVoxelResources)(
+        [handles = MoveTemp(pendingInit), isoSize = isoBufferSize, vertexSize = vertexBufferSize](FRHICommandListImmediate& RHICmdList)
+        {
+            const VoxelRenderResourceTable& table = VoxelRenderResourceTable::Get();
+            for (VoxelRenderHandle handle : handles) {
+                const VoxelRenderResources* resources = table.Resolve(handle);
+                if (!resources) continue;
+                resources->vertexFactory->Initialize(vertexSize);
+                resources->isoBuffer->Initialize(isoSize);
+                resources->typeBuffer->Initialize(isoSize);
+            }
+        });
+    pendingInit.Reset();
+}
+
+void VoxelResourcePool::Recycle(VoxelRenderHandle& handle) {
+    pooledResources.Add(handle);
+    handle = VoxelRenderHandle();
+}
+
+// Frees pooled sets, oldest first, until at least bytesToFree have been returned
+void VoxelResourcePool::TrimPooled(uint64 bytesToFree) {
+    int32 trimCount = FMath::Min<int32>(pooledResources.Num(), (int32)FMath::DivideAndRoundUp(bytesToFree, bytesPerResourceSet));
+    if (trimCount <= 0) return;
+
+    VoxelRenderResourceTable::Get().Release(TConstArrayView<VoxelRenderHandle>(pooledResources.GetData(), trimCount));
+    pooledResources.RemoveAt(0, trimCount, EAllowShrinking::No);
+}
+
+// Sets still waiting for init are released with the rest, the release command runs after their init command
+void VoxelResourcePool::ReleasePooled() {
+    SubmitPendingInit();
+    VoxelRenderResourceTable::Get().Release(pooledResources);
+    pooledResources.Reset();
+}
@@ -0,0 +1,416 @@
+#include "VoxelSDFBrush.h"
+#include "OctreeModule.h"
+#include "Async/ParallelFor.h"
+#include "Algo/Sort.h"
+
+namespace {
+    VectorRegister4Float Length2(VectorRegister4Float x, VectorRegister4Float y) {
+        return VectorSqrt(VectorMultiplyAdd(x, x, VectorMultiply(y, y)));
+    }
+
+    VectorRegister4Float Length3(VectorRegister4Float x, VectorRegister4Float y, VectorRegister4Float z) {
+        return VectorSqrt(VectorMultiplyAdd(x, x, VectorMultiplyAdd(y, y, VectorMultiply(z, z))));
+    }
+
+    // Distance to the shape in its own unscaled space
+    VectorRegister4Float EvaluatePrimitive(const VoxelSDFShape& shape, VectorRegister4Float x, VectorRegister4Float y, VectorRegister4Float z) {
+        const VectorRegister4Float zero = VectorZeroFloat();
+        switch (shape.primitive) {
+        case EVoxelSDFPrimitive::Sphere:
+            return VectorSubtract(Length3(x, y, z), VectorSetFloat1(shape.size.X));
+        case EVoxelSDFPrimitive::Box: {
+            VectorRegister4Float qx = VectorSubtract(VectorAbs(x), VectorSetFloat1(shape.size.X));
+            VectorRegister4Float qy = VectorSubtract(VectorAbs(y), VectorSetFloat1(shape.size.Y));
+            VectorRegister4Float qz = VectorSubtract(VectorAbs(z), VectorSetFloat1(shape.size.Z));
+            VectorRegister4Float outside = Length3(VectorMax(qx, zero), VectorMax(qy, zero), VectorMax(qz, zero));
+            VectorRegister4Float inside = VectorMin(VectorMax(qx, VectorMax(qy, qz)), zero);
+            return VectorAdd(outside, inside);
+        }
+        case EVoxelSDFPrimitive::Capsule: {
+            VectorRegister4Float halfHeight = VectorSetFloat1(shape.size.Y);
+            VectorRegister4Float axisOffset = VectorSubtract(z, VectorMin(VectorMax(z, VectorNegate(halfHeight)), halfHeight));
+            return VectorSubtract(Length3(x, y, axisOffset), VectorSetFloat1(shape.size.X));
+        }
+        case EVoxelSDFPrimitive::Cylinder: {
+            VectorRegister4Float radial = VectorSubtract(Length2(x, y), VectorSetFloat1(shape.size.X));
+            VectorRegister4Float axial = VectorSubtract(VectorAbs(z), VectorSetFloat1(shape.size.Y));
+            VectorRegister4Float inside = VectorMin(VectorMax(radial, axial), zero);
+            return VectorAdd(inside, Length2(VectorMax(radial, zero), VectorMax(axial, zero)));
+        }
+        case EVoxelSDFPrimitive::Torus: {
+            VectorRegister4Float ring = VectorSubtract(Length2(x, y), VectorSetFloat1(shape.size.X));
+            return VectorSubtract(Length2(ring, z), VectorSetFloat1(shape.size.Y));
+        }
+        case EVoxelSDFPrimitive::HalfSpace:
+            return z;
+        case EVoxelSDFPrimitive::Volume: {
+            if (!shape.volume.IsValid()) break;
+            // Trilinear taps cannot be gathered, so the volume is sampled a lane at a time
+            float lanesX[4], lanesY[4], lanesZ[4], distances[4];
+            VectorStore(x, lanesX);
+            VectorStore(y, lanesY);
+            VectorStore(z, lanesZ);
+            for (int32 lane = 0; lane < 4; lane++)
+                distances[lane] = shape.volume->Sample(FVector3f(lanesX[lane], lanesY[lane], lanesZ[lane]));
+            return VectorLoad(distances);
+        }
+        }
+        return VectorSetFloat1(UE_BIG_NUMBER);
+    }
+
+    VectorRegister4Float Combine(EVoxelCSGOp op, VectorRegister4Float a, VectorRegister4Float b, float blend) {
+        switch (op) {
+        case EVoxelCSGOp::Subtract:
+            return VectorMax(a, VectorNegate(b));
+        case EVoxelCSGOp::Intersect:
+            return VectorMax(a, b);
+        case EVoxelCSGOp::SmoothUnion: {
+            if (blend <= 0.0f) break;
+            // Polynomial smooth minimum, h blends from b to a across the blend width
+            const VectorRegister4Float one = VectorOneFloat();
+            VectorRegister4Float h = VectorMultiplyAdd(VectorSubtract(b, a), VectorSetFloat1(0.5f / blend), VectorSetFloat1(0.5f));
+            h = VectorMin(VectorMax(h, VectorZeroFloat()), one);
+            VectorRegister4Float mixed = VectorMultiplyAdd(VectorSubtract(a, b), h, b);
+            return VectorSubtract(mixed, VectorMultiply(VectorSetFloat1(blend), VectorMultiply(h, VectorSubtract(one, h))));
+        }
+        default:
+            break;
+        }
+        return VectorMin(a, b);
+    }
+
+    bool GetShapeBounds(const VoxelSDFShape& shape, FBox3f& outBounds) {
+        FBox3f local;
+        const FVector3f& size = shape.size;
+        switch (shape.primitive) {
+        case EVoxelSDFPrimitive::Sphere: local = FBox3f(FVector3f(-size.X), FVector3f(size.X)); break;
+        case EVoxelSDFPrimitive::Box: local = FBox3f(-size, size); break;
+        case EVoxelSDFPrimitive::Capsule: local = FBox3f(-FVector3f(size.X, size.X, size.X + size.Y), FVector3f(size.X, size.X, size.X + size.Y)); break;
+        case EVoxelSDFPrimitive::Cylinder: local = FBox3f(-FVector3f(size.X, size.X, size.Y), FVector3f(size.X, size.X, size.Y)); break;
+        case EVoxelSDFPrimitive::Torus: local = FBox3f(-FVector3f(size.X + size.Y, size.X + size.Y, size.Y), FVector3f(size.X + size.Y, size.X + size.Y, size.Y)); break;
+        case EVoxelSDFPrimitive::HalfSpace: return false;
+        case EVoxelSDFPrimitive::Volume:
+            if (!shape.volume.IsValid()) {
+                outBounds = FBox3f(ForceInit);
+                return true;
+            }
+            local = shape.volume->GetBounds();
+            break;
+        }
+        outBounds = local.TransformBy(FTransform3f(shape.rotation, shape.position, FVector3f(shape.scale)));
+        return true;
+    }
+
+    // Where the line through (y, z) parallel to x crosses the triangle, solved in the yz plane
+    bool IntersectRowX(float y, float z, const FVector3f& a, const FVector3f& b, const FVector3f& c, float& outX) {
+        float determinant = (b.Y - a.Y) * (c.Z - a.Z) - (c.Y - a.Y) * (b.Z - a.Z);
+        if (FMath::Abs(determinant) < UE_SMALL_NUMBER) return false;
+        float u = ((y - a.Y) * (c.Z - a.Z) - (c.Y - a.Y) * (z - a.Z)) / determinant;
+        float v = ((b.Y - a.Y) * (z - a.Z) - (y - a.Y) * (b.Z - a.Z)) / determinant;
+        if (u < 0.0f || v < 0.0f || u + v > 1.0f) return false;
+        outX = a.X + u * (b.X - a.X) + v * (c.X - a.X);
+        return true;
+    }
+
+    // Bounding volume hierarchy over a mesh's triangles for closest point queries. Nodes split their triangles at the
+    // centroid median along the longest axis of their bounds.
+    class TriangleBVH {
+    public:
+        TriangleBVH(TConstArrayView<FVector3f> positions, TConstArrayView<uint32> indices) {
+            int32 triangleCount = indices.Num() / 3;
+            TArray<int32> order;
+            TArray<FVector3f> centroids;
+            order.SetNumUninitialized(triangleCount);
+            centroids.SetNumUninitialized(triangleCount);
+            for (int32 t = 0; t < triangleCount; t++) {
+                order[t] = t;
+                centroids[t] = (positions[indices[t * 3]] + positions[indices[t * 3 + 1]] + positions[indices[t * 3 + 2]]) / 3.0f;
+            }
+
+            struct PendingNode { int32 node; int32 first; int32 count; };
+            TArray<PendingNode, TInlineAllocator<64>> stack;
+            nodes.AddDefaulted();
+            stack.Add({ 0, 0, triangleCount });
+            while (stack.Num() > 0) {
+                PendingNode pending = stack.Pop(EAllowShrinking::No);
+                FBox3f bounds(ForceInit);
+                for (int32 i = pending.first; i < pending.first + pending.count; i++) {
+                    int32 t = order[i];
+                    bounds += positions[indices[t * 3]];
+                    bounds += positions[indices[t * 3 + 1]];
+                    bounds += positions[indices[t * 3 + 2]];
+                }
+                nodes[pending.node].bounds = bounds;
+                nodes[pending.node].first = pending.first;
+                nodes[pending.node].count = pending.count;
+                if (pending.count <= MaxLeafTriangles) continue;
+
+                FVector3f extent = bounds.GetSize();
+                int32 axis = extent.X >= extent.Y && extent.X >= extent.Z ? 0 : (extent.Y >= extent.Z ? 1 : 2);
+                Algo::Sort(MakeArrayView(order.GetData() + pending.first, pending.count), [&centroids, axis](int32 a, int32 b) {
+                    return centroids[a][axis] < centroids[b][axis];
+                });
+
+                int32 leftCount = pending.count / 2;
+                int32 left = nodes.AddDefaulted();
+                int32 right = nodes.AddDefaulted();
+                nodes[pending.node].count = 0;
+                nodes[pending.node].right = right;
+                nodes[pending.node].left = left;
+                stack.Add({ right, pending.first + leftCount, pending.count - leftCount });
+                stack.Add({ left, pending.first, leftCount });
+            }
+
+            corners.SetNumUninitialized(triangleCount * 3);
+            for (int32 i = 0; i < triangleCount; i++) {
+                for (int32 c = 0; c < 3; c++)
+                    corners[i * 3 + c] = FVector(positions[indices[order[i] * 3 + c]]);
+            }
+        }
+
+        // Squared distance to the closest triangle, only nodes nearer than maxDistanceSquared are searched
+        double GetDistanceSquared(const FVector& point, double maxDistanceSquared) const {
+            FVector3f point3f(point);
+            double best = maxDistanceSquared;
+            TArray<TPair<int32, float>, TInlineAllocator<64>> stack;
+            stack.Add({ 0, 0.0f });
+            while (stack.Num() > 0) {
+                TPair<int32, float> entry = stack.Pop(EAllowShrinking::No);
+                if (entry.Value >= best) continue;
+                const Node& node = nodes[entry.Key];
+                if (node.count > 0) {
+                    for (int32 i = node.first; i < node.first + node.count; i++) {
+                        FVector closest = FMath::ClosestPointOnTriangleToPoint(point, corners[i * 3], corners[i * 3 + 1], corners[i * 3 + 2]);
+                        best = FMath::Min(best, FVector::DistSquared(point, closest));
+                    }
+                    continue;
+                }
+
+                // The nearer child is pushed last so it is searched first, the other is skipped if that tightened the bound
+                float leftDistance = nodes[node.left].bounds.ComputeSquaredDistanceToPoint(point3f);
+                float rightDistance = nodes[node.right].bounds.ComputeSquaredDistanceToPoint(point3f);
+                if (leftDistance <= rightDistance) {
+                    stack.Add({ node.right, rightDistance });
+                    stack.Add({ node.left, leftDistance });
+                }
+                else {
+                    stack.Add({ node.left, leftDistance });
+                    stack.Add({ node.right, rightDistance });
+                }
+            }
+            return best;
+        }
+
+    private:
+        static constexpr int32 MaxLeafTriangles = 4;
+
+        // A leaf when count is above zero, its triangles are corners[first * 3] onwards
+        struct Node {
+            FBox3f bounds;
+            int32 first = 0;
+            int32 count = 0;
+            int32 left = INDEX_NONE;
+            int32 right = INDEX_NONE;
+        };
+
+        TArray<Node> nodes;
+        TArray<FVector> corners;
+    };
+}
+
+TSharedPtr<VoxelSDFVolume> VoxelSDFVolume::BuildFromTriangles(TConstArrayView<FVector3f> positions, TConstArrayView<uint32> indices, int32 resolution, float padding) {
+    if (positions.Num() == 0 || indices.Num() < 3 || resolution < 2) return nullptr;
+
+    TSharedPtr<VoxelSDFVolume> volume = MakeShared<VoxelSDFVolume>();
+    FBox3f meshBounds = FBox3f(positions.GetData(), positions.Num()).ExpandBy(padding);
+    FVector3f extent = meshBounds.GetSize();
+    float cellSize = FMath::Max(extent.GetMax() / (resolution - 1), UE_KINDA_SMALL_NUMBER);
+    volume->size = FIntVector(
+        FMath::Max(FMath::CeilToInt(extent.X / cellSize) + 1, 2),
+        FMath::Max(FMath::CeilToInt(extent.Y / cellSize) + 1, 2),
+        FMath::Max(FMath::CeilToInt(extent.Z / cellSize) + 1, 2));
+    volume->bounds = FBox3f(meshBounds.Min, meshBounds.Min + FVector3f(volume->size - FIntVector(1)) * cellSize);
+    volume->invCellSize = FVector3f(1.0f / cellSize);
+    volume->distances.SetNumUninitialized(volume->size.X * volume->size.Y * volume->size.Z);
+
+    FIntVector size = volume->size;
+    int32 triangleCount = indices.Num() / 3;
+    TriangleBVH bvh(positions, indices);
+
+    // Rows are nudged off the grid so they do not run exactly through the shared edges of an axis aligned mesh. Each
+    // z slice keeps only the triangles its rows can cross.
+    float nudge = cellSize * 1e-3f;
+    TArray<TArray<int32>> sliceTriangles;
+    sliceTriangles.SetNum(size.Z);
+    for (int32 t = 0; t < triangleCount; t++) {
+        float minZ = FMath::Min3(positions[indices[t * 3]].Z, positions[indices[t * 3 + 1]].Z, positions[indices[t * 3 + 2]].Z);
+        float maxZ = FMath::Max3(positions[indices[t * 3]].Z, positions[indices[t * 3 + 1]].Z, positions[indices[t * 3 + 2]].Z);
+        // One slice of slack either side, the row test itself decides
+        int32 firstSlice = FMath::Max(FMath::FloorToInt((minZ - meshBounds.Min.Z - nudge) / cellSize), 0);
+        int32 lastSlice = FMath::Min(FMath::CeilToInt((maxZ - meshBounds.Min.Z - nudge) / cellSize), size.Z - 1);
+        for (int32 z = firstSlice; z <= lastSlice; z++)
+            sliceTriangles[z].Add(t);
+    }
+
+    ParallelFor(size.Z, [&](int32 z) {
+        TArray<float> crossings;
+        for (int32 y = 0; y < size.Y; y++) {
+            FVector3f rowStart = meshBounds.Min + FVector3f(0.0f, y * cellSize, z * cellSize);
+
+            // A sample is inside when the row crosses the surface an odd number of times before it
+            crossings.Reset();
+            for (int32 t : sliceTriangles[z]) {
+                float crossing;
+                if (IntersectRowX(rowStart.Y + nudge, rowStart.Z + nudge, positions[indices[t * 3]], positions[indices[t * 3 + 1]], positions[indices[t * 3 + 2]], crossing))
+                    crossings.Add(crossing);
+            }
+            crossings.Sort();
+
+            // Neighbouring samples are one cell apart, so the last distance plus a cell bounds the search for the next
+            int32 crossed = 0;
+            double bound = UE_BIG_NUMBER;
+            for (int32 x = 0; x < size.X; x++) {
+                FVector point = FVector(rowStart + FVector3f(x * cellSize, 0.0f, 0.0f));
+                while (crossed < crossings.Num() && crossings[crossed] < point.X)
+                    crossed++;
+
+                double distanceSquared = bvh.GetDistanceSquared(point, bound);
+                if (distanceSquared >= bound)
+                    distanceSquared = bvh.GetDistanceSquared(point, UE_BIG_NUMBER);
+                float distance = FMath::Sqrt(distanceSquared);
+                bound = FMath::Square(distance + cellSize * 1.01);
+                volume->distances[x + size.X * (y + size.Y * z)] = (crossed & 1) ? -distance : distance;
+            }
+        }
+    });
+    return volume;
+}
+
+float VoxelSDFVolume::Sample(const FVector3f& position) const {
+    FVector3f clamped = position.BoundToBox(bounds.Min, bounds.Max);
+    float outside = (position - clamped).Size();
+
+    FVector3f cell = (clamped - bounds.Min) * invCellSize;
+    int32 x = FMath::Min((int32)cell.X, size.X - 2);
+    int32 y = FMath::Min((int32)cell.Y, size.Y - 2);
+    int32 z = FMath::Min((int32)cell.Z, size.Z - 2);
+    FVector3f t = cell - FVector3f((float)x, (float)y, (float)z);
+
+    auto At = [&](int32 dx, int32 dy, int32 dz) { return distances[(x + dx) + size.X * ((y + dy) + size.Y * (z + dz))]; };
+    float lower = FMath::Lerp(FMath::Lerp(At(0, 0, 0), At(1, 0, 0), t.X), FMath::Lerp(At(0, 1, 0), At(1, 1, 0), t.X), t.Y);
+    float upper = FMath::Lerp(FMath::Lerp(At(0, 0, 1), At(1, 0, 1), t.X), FMath::Lerp(At(0, 1, 1), At(1, 1, 1), t.X), t.Y);
+    return FMath::Lerp(lower, upper, t.Z) + outside;
+}
+
+TSharedPtr<VoxelSDFBrush> VoxelSDFBrush::MakePrimitive(EVoxelSDFPrimitive primitive, const FVector3f& size) {
+    TSharedPtr<VoxelSDFBrush> brush = MakeShared<VoxelSDFBrush>();
+    VoxelSDFShape shape;
+    shape.primitive = primitive;
+    shape.size = size;
+    brush->Add(shape);
+
+    // Full strength is reached at the middle of the thinnest part of the shape
+    switch (primitive) {
+    case EVoxelSDFPrimitive::Box: brush->falloff = size.GetMin(); break;
+    case EVoxelSDFPrimitive::Cylinder: brush->falloff = FMath::Min(size.X, size.Y); break;
+    case EVoxelSDFPrimitive::Torus: brush->falloff = size.Y; break;
+    default: brush->falloff = size.X; break;
+    }
+    return brush;
+}
+
+TSharedPtr<VoxelSDFBrush> VoxelSDFBrush::MakeVolume(TSharedPtr<const VoxelSDFVolume> volume, float scale) {
+    if (!volume.IsValid()) return nullptr;
+    TSharedPtr<VoxelSDFBrush> brush = MakeShared<VoxelSDFBrush>();
+    VoxelSDFShape shape;
+    shape.primitive = EVoxelSDFPrimitive::Volume;
+    shape.scale = scale;
+    shape.volume = volume;
+    brush->Add(shape);
+    brush->falloff = volume->GetBounds().GetExtent().GetMin() * scale;
+    return brush;
+}
+
+float VoxelSDFBrush::Evaluate(const FVector3f& position) const {
+    float distance;
+    EvaluateRow(&distance, 1, position, FVector3f::ZeroVector);
+    return distance;
+}
+
+// Every shape's part of the row is a line in its own space too, so start and step are taken into shape space once and
+// each lane is start + step * i there
+void VoxelSDFBrush::EvaluateRow(float* RESTRICT outDistances, int32 count, const FVector3f& start, const FVector3f& step) const {
+    struct ShapeRow {
+        VectorRegister4Float startX, startY, startZ;
+        VectorRegister4Float stepX, stepY, stepZ;
+        VectorRegister4Float scale;
+    };
+    TArray<ShapeRow, TInlineAllocator<8>> shapeRows;
+    for (const VoxelSDFShape& shape : shapes) {
+        float invScale = 1.0f / shape.scale;
+        FVector3f localStart = shape.rotation.UnrotateVector(start - shape.position) * invScale;
+        FVector3f localStep = shape.rotation.UnrotateVector(step) * invScale;
+        shapeRows.Add({
+            VectorSetFloat1(localStart.X), VectorSetFloat1(localStart.Y), VectorSetFloat1(localStart.Z),
+            VectorSetFloat1(localStep.X), VectorSetFloat1(localStep.Y), VectorSetFloat1(localStep.Z),
+            VectorSetFloat1(shape.scale) });
+    }
+
+    for (int32 i = 0; i < count; i += 4) {
+        VectorRegister4Float lane = MakeVectorRegisterFloat((float)i, (float)i + 1.0f, (float)i + 2.0f, (float)i + 3.0f);
+        VectorRegister4Float distance = VectorSetFloat1(UE_BIG_NUMBER);
+        for (int32 s = 0; s < shapes.Num(); s++) {
+            const ShapeRow& row = shapeRows[s];
+            VectorRegister4Float shapeDistance = VectorMultiply(EvaluatePrimitive(shapes[s],
+                VectorMultiplyAdd(lane, row.stepX, row.startX),
+                VectorMultiplyAdd(lane, row.stepY, row.startY),
+                VectorMultiplyAdd(lane, row.stepZ, row.startZ)), row.scale);
+            distance = s == 0 ? shapeDistance : Combine(shapes[s].op, distance, shapeDistance, shapes[s].blend);
+        }
+
+        if (i + 4 <= count) VectorStore(distance, outDistances + i);
+        else {
+            float tail[4];
+            VectorStore(distance, tail);
+            for (int32 j = 0; i + j < count; j++)
+                outDistances[i + j] = tail[j];
+        }
+    }
+}
+
+bool VoxelSDFBrush::GetBounds(FBox3f& outBounds) const {
+    FBox3f bounds(ForceInit);
+    bool bBounded = false;
+    for (int32 s = 0; s < shapes.Num(); s++) {
+        const VoxelSDFShape& shape = shapes[s];
+        FBox3f shapeBounds;
+        bool bShapeBounded = GetShapeBounds(shape, shapeBounds);
+        if (s == 0) {
+            bounds = shapeBounds;
+            bBounded = bShapeBounded;
+            continue;
+        }
+
+        switch (shape.op) {
+        case EVoxelCSGOp::Union:
+        case EVoxelCSGOp::SmoothUnion: {
+            if (!bShapeBounded) bBounded = false;
+            if (!bBounded) break;
+            // The blend can only reach as far as its width past either shape
+            float blend = shape.op == EVoxelCSGOp::SmoothUnion ? FMath::Max(shape.blend, 0.0f) : 0.0f;
+            if (shapeBounds.IsValid)
+                bounds = bounds.IsValid ? bounds.ExpandBy(blend) + shapeBounds.ExpandBy(blend) : shapeBounds.ExpandBy(blend);
+            break;
+        }
+        case EVoxelCSGOp::Subtract:
+            break;
+        case EVoxelCSGOp::Intersect:
+            if (!bShapeBounded) break;
+            bounds = bBounded ? bounds.Overlap(shapeBounds) : shapeBounds;
+            bBounded = true;
+            break;
+        }
+    }
+    outBounds = bounds;
+    return bBounded;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "CoreMinimal.h"
+
+/**
+ * Location codes for the linear octree. A key is a sentinel bit followed by 3 bits per level
+ * (x = bit 0, y = bit 1, z = bit 2), so the root is 1 and a child is (parent << 3) | childIndex.
+ */
+
+struct MortonCode {
+    static constexpr uint64 RootKey = 1;
+    static constexpr int MaxDepth = 21;
+
+    static FORCEINLINE uint64 SplitBy3(uint32 value) {
+        uint64 x = value & 0x1fffff;
+        x = (x | x << 32) & 0x1f00000000ffffull;
+        x = (x | x << 16) & 0x1f0000ff0000ffull;
+        x = (x | x << 8) & 0x100f00f00f00f00full;
+        x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+        x = (x | x << 2) & 0x1249249249249249ull;
+        return x;
+    }
+
+    static FORCEINLINE uint32 CompactBy3(uint64 x) {
+        x &= 0x1249249249249249ull;
+        x = (x ^ (x >> 2)) & 0x10c30c30c30c30c3ull;
+        x = (x ^ (x >> 4)) & 0x100f00f00f00f00full;
+        x = (x ^ (x >> 8)) & 0x1f0000ff0000ffull;
+        x = (x ^ (x >> 16)) & 0x1f00000000ffffull;
+        x = (x ^ (x >> 32)) & 0x1fffffull;
+        return (uint32)x;
+    }
+
+    static FORCEINLINE uint64 Encode(const FIntVector& coord, int depth) {
+        uint64 code = SplitBy3(coord.X) | (SplitBy3(coord.Y) << 1) | (SplitBy3(coord.Z) << 2);
+        return (1ull << (3 * depth)) | code;
+    }
+
+    static FORCEINLINE int GetDepth(uint64 key) {
+        return (int)(FMath::FloorLog2_64(key) / 3);
+    }
+
+    static FORCEINLINE FIntVector Decode(uint64 key) {
+        uint64 code = key & ~(1ull << (3 * GetDepth(key)));
+        return FIntVector(CompactBy3(code), CompactBy3(code >> 1), CompactBy3(code >> 2));
+    }
+
+    static FORCEINLINE uint64 GetParent(uint64 key) { return key >> 3; }
+    static FORCEINLINE uint64 GetChild(uint64 key, int childIndex) { return (key << 3) | (uint64)childIndex; }
+    static FORCEINLINE int GetChildIndex(uint64 key) { return (int)(key & 7); }
+
+    // Same-depth neighbour across a face, 0 when the neighbour would lie outside the root.
+    static FORCEINLINE uint64 GetNeighbour(uint64 key, const FIntVector& offset) {
+        int depth = GetDepth(key);
+        int cellsPerAxis = 1 << depth;
+        FIntVector coord = Decode(key) + offset;
+        if (coord.X < 0 || coord.Y < 0 || coord.Z < 0 || coord.X >= cellsPerAxis || coord.Y >= cellsPerAxis || coord.Z >= cellsPerAxis)
+            return 0;
+        return Encode(coord, depth);
+    }
+};
@@ -1,9 +1,24 @@
 #pragma once
 #include "CoreMinimal.h"
+#include "Containers/ChunkedArray.h"
 #include "OctreeNode.h"
 #include "AABB.h"
+#include "MortonCode.h"
+#include "VoxelResourcePool.h"
+#include "VoxelDeltaUploader.h"
+#include "VoxelLODSelector.h"
+#include "VoxelEditQueue.h"
+#include "VoxelConnectivity.h"
 #include "VoxelOctreeUtils.h"
 #include "VoxelRenderBuffers.h"
+#include "Tasks/Task.h"
+
+// A solid piece an edit cut off from the body, bounds in world space and volume in world units cubed
+struct VoxelDetachedChunk {
+    FBox bounds;
+    float volume;
+    int64 sampleCount;
+};
 
 class OCTREE_API Octree {
 public:
@@ -13,7 +28,8 @@ public:
     ~Octree();
 
     void Release();
-    OctreeNode* GetRoot() { return root; }
+    OctreeNode* GetRoot() { return nodes.Num() > 0 ? &nodes[0] : nullptr; }
+    AActor* GetParentActor() const { return parent; }
     FBoxSphereBounds CalcVoxelBounds(const FTransform& LocalToWorld);
 
     TSharedPtr<FIsoUniformBuffer> GetIsoBuffer() { return isoUniformBuffer; }
@@ -33,24 +49,208 @@ public:
     float GetIsoLevel() const { return isoLevel; }
 
     bool AreValuesDirty() const { return bIsoValuesDirty || bTypeValuesDirty; }
+    // Bumped by every edit and reset so callers can tell when cached state built from the densities is stale
+    uint32 GetEditVersion() const { return editVersion; }
     bool RaycastToVoxelBody(FHitResult& hit, FVector& start, FVector& end);
 
     FVector3f GetOctreePosition() const {
-        if (root) return root->GetBounds().Center();
+        if (nodeKeys.Num() > 0) return GetNodeBounds(0).Center();
         else return (FVector3f());
     }
 
+    // Linear node storage: index 0 is the root and the 8 children of a node are stored contiguously from its first child index.
+    int32 GetNodeCount() const { return nodeKeys.Num(); }
+    int GetMaxDepth() const { return maxDepth; }
+    OctreeNode* GetNode(int32 index) { return &nodes[index]; }
+    OctreeNode* FindNode(uint64 key);
+    int32 FindNodeIndex(uint64 key) const;
+    OctreeNode* GetFaceNeighbour(int32 index, int direction);
+    int32 GetFaceNeighbourIndex(int32 index, int direction) const;
+
+    bool IsLeafIndex(int32 index) const { return nodeFirstChild[index] == INDEX_NONE; }
+    bool IsNodeEdited(int32 index) const { return nodeEdited[index]; }
+
+    int32 GetFirstChildIndex(int32 index) const { return nodeFirstChild[index]; }
+    int GetNodeDepth(int32 index) const { return nodeDepths[index]; }
+    uint64 GetNodeKey(int32 index) const { return nodeKeys[index]; }
+    AABB GetNodeBounds(int32 index) const { return { nodeBoundsMin[index], nodeBoundsMax[index] }; }
+    EVoxelNodeClass ClassifyNode(int32 index) const;
+    bool IsNodeSingleType(int32 index) const { return nodeType[index] != MixedNodeType; }
+    float GetNodeMinIso(int32 index) const { return nodeMinIso[index]; }
+    float GetNodeMaxIso(int32 index) const { return nodeMaxIso[index]; }
+
+    // Visibility is stamped with the current epoch, so starting a new selection is O(1) instead of a sweep over every node
+    void BeginVisibilityEpoch();
+    bool IsNodeVisible(int32 index) const { return nodeVisibleEpoch[index] == visibilityEpoch; }
+    void SetNodeVisible(int32 index, bool visibility) { nodeVisibleEpoch[index] = visibility ? visibilityEpoch : 0; }
+    // Hysteresis memory of the game thread selection, VoxelLODSelector carries its own from one result to the next
+    bool WasNodeRefined(int32 index) const { return nodeRefined[index]; }
+    void SetNodeRefined(int32 index, bool refined) { nodeRefined[index] = refined; }
+
+    // Selection runs on a snapshot of the topology, the result is published back on the game thread. Only the pages
+    // changed since the last snapshot are copied.
+    TSharedPtr<const VoxelTopologySnapshot> GetTopologySnapshot();
+    void ApplyLODSelection(const TArray<int32>& visibleIndices, TArray<OctreeNode*>& outVisibleNodes);
+
+    // A node's content version is bumped whenever something its mesh is built from changes: the densities it covers,
+    // its transition cells or the resources it was meshed into. Only nodes whose meshed version lags are dispatched.
+    uint32 GetNodeContentVersion(int32 index) const { return nodeContentVersion[index]; }
+    void BumpNodeContentVersion(int32 index) { nodeContentVersion[index]++; }
+    void UpdateTransitionSignature(int32 index, uint32 signature);
+    bool IsNodeMeshCurrent(int32 index) const { return nodeMeshedVersion[index] == nodeContentVersion[index]; }
+    bool IsNodeDeformCurrent(int32 index) const { return nodeDeformedVersion[index] == nodeContentVersion[index]; }
+    void MarkNodeMeshed(int32 index) { nodeMeshedVersion[index] = nodeContentVersion[index]; }
+    void MarkNodeDeformed(int32 index) { nodeDeformedVersion[index] = nodeContentVersion[index]; }
+    bool HasNodeBeenMeshed(int32 index) const { return nodeMeshedVersion[index] != 0; }
+    uint32 GetNodeMeshedVersion(int32 index) const { return nodeMeshedVersion[index]; }
+    // Edits applied to the tree since this node's densities last changed, MAX_uint32 for nodes never edited
+    uint32 GetEditsSinceNodeEdit(int32 index) const { return nodeEditedVersion[index] == 0 ? MAX_uint32 : editVersion - nodeEditedVersion[index]; }
+
+    // Node GPU resources are acquired when a node enters the visible cut and pooled again once it has been
+    // out of view for residencyGraceFrames, least recently visible nodes are evicted first when over budget.
+    // Pinned nodes are never evicted, whatever the budget.
+    void UpdateResidency(const TArray<OctreeNode*>& visibleNodes);
+    // The owner pins every node its scene proxy draws, including nodes that left the cut and are still drawn until
+    // their replacement is meshed
+    void SetNodePinned(int32 index, bool bPinned) { nodePinned[index] = bPinned; }
+    void UnpinAllNodes() { nodePinned.SetRange(0, nodePinned.Num(), false); }
+    void SetResidencyBudget(uint64 inBudgetBytes, uint32 inGraceFrames);
+    uint64 GetResidentBytes() const { return (uint64)residentNodes.Num() * resourcePool->GetBytesPerResourceSet(); }
+    uint64 GetResidentBytesAtDepth(int depth) const { return residentBytesPerDepth.IsValidIndex(depth) ? residentBytesPerDepth[depth] : 0; }
+    uint64 GetPooledBytes() const { return resourcePool->GetPooledBytes(); }
+    int32 GetResidentNodeCount() const { return residentNodes.Num(); }
+
     int GetIsoValueFromIndex(FIntVector coord, int axisSize);
+    // additive adds density and paints type, otherwise density is removed. paintOnly keeps the density, so without
+    // additive the edit does nothing
     bool ApplyDeformationAtPosition(FVector position, float radius, float influence, uint32 type = 0, bool additive = false, bool paintOnly = false);
-    void UpdateIsoValuesDirty();
+    // Same edit swept from start to end in one pass, each voxel takes the falloff of its distance to the segment once
+    bool ApplySweptDeformation(FVector start, FVector end, float radius, float influence, uint32 type = 0, bool additive = false, bool paintOnly = false);
+    // An SDF brush placed at position, weighted by its own falloff instead of a radius
+    bool ApplyShapeDeformation(TSharedPtr<const VoxelSDFBrush> brush, FVector position, FQuat rotation, float influence, uint32 type = 0, bool additive = false, bool paintOnly = false);
+    // Applies a drained batch of edits in order, returns how many landed inside the tree
+    int32 ApplyEditBatch(TConstArrayView<VoxelEditCommand> commands);
+    struct BuildTiming {
+        int32 workers;
+        double seconds;
+        int32 nodeCount;
+    };
+    // Builds the subtrees below the parallel split depth again on 1, 2, 4 ... workers up to every task graph worker,
+    // leaving the tree untouched. Mean seconds per build for each worker count, empty when nothing is split that deep.
+    void BenchmarkBuild(int32 iterations, TArray<BuildTiming>& outTimings) const;
+    void BenchmarkBrushKernel(TConstArrayView<float> radii, int32 iterations);
+    void BenchmarkFilterKernel(TConstArrayView<float> radii, int32 iterations);
+    void BenchmarkConnectivity(TConstArrayView<float> radii, int32 iterations);
+    // Adopts the connectivity built on a task once it is done, or waits for it with bWait. False until there is one
+    // to detect detached pieces with.
+    bool FinishConnectivityBuild(bool bWait);
+    // Pieces cut off by the edit batches applied since the last call
+    void ConsumeDetachedChunks(TArray<VoxelDetachedChunk>& outChunks) { outChunks = MoveTemp(detachedChunks); detachedChunks.Reset(); }
     void UpdateValuesDirty();
-    void UpdateTypeValuesDirty();
+    uint64 GetLastDeltaUploadBytes() const { return deltaUploader->GetLastUploadBytes(); }
+    // What the edits so far have added to the initial densities and painted over its types, flat like the iso buffer
+    const TArray<float>& GetDeltaIsoValues() const { return deltaIsoArray; }
+    const TArray<uint32>& GetDeltaTypeValues() const { return deltaTypeArray; }
     void DebugOctreeNodes(UWorld* world);
     void ResetDeformation();
 
 protected:
     FBoxSphereBounds GetBoxSphereBoundsBounds();
-    OctreeNode* root;
+    struct SubtreeBuild {
+        TArray<uint64> keys;
+        TArray<int32> firstChild;
+        TArray<float> minIso;
+        TArray<float> maxIso;
+        TArray<uint32> type;
+    };
+
+    // An edit command resolved into iso space, with the box of samples it can touch
+    struct EditBrush {
+        const VoxelEditCommand* command;
+        FVector center;
+        // Capsules only, center is the end of the segment
+        FVector sweepStart;
+        FVector3f sweepAxis;
+        float invSweepLengthSquared;
+        bool bSwept;
+        // SDF brushes only, brush space positions of sample (0, 0, 0) and of one sample step along each axis
+        const VoxelSDFBrush* sdf;
+        FVector3f sdfOrigin;
+        FVector3f sdfStepX;
+        FVector3f sdfStepY;
+        FVector3f sdfStepZ;
+        float invFalloff;
+        // The EditBrickSize^3 bricks from brickMin that the brush reaches, culled on the distance at their centres
+        FIntVector brickMin;
+        FIntVector brickCount;
+        TBitArray<> activeBricks;
+        float isoRadius;
+        float invRadius;
+        float signedInfluence;
+        FIntVector min;
+        FIntVector max;
+    };
+    struct EditCluster {
+        FIntVector min;
+        FIntVector max;
+        TArray<int32> brushes;
+    };
+    static bool BoxesOverlap(const FIntVector& minA, const FIntVector& maxA, const FIntVector& minB, const FIntVector& maxB) {
+        return minA.X <= maxB.X && maxA.X >= minB.X && minA.Y <= maxB.Y && maxA.Y >= minB.Y && minA.Z <= maxB.Z && maxA.Z >= minB.Z;
+    }
+    static constexpr int32 EditBrickSize = 8;
+    bool MakeEditBrush(const VoxelEditCommand& command, const FTransform& parentTransform, EditBrush& outBrush) const;
+    bool MakeSDFEditBrush(const VoxelEditCommand& command, const FTransform& parentTransform, EditBrush& outBrush) const;
+    static bool GetSweepRowRange(const EditBrush& brush, int dy, int dz, int32& outMin, int32& outMax);
+    // Smooth and flatten run as separable 1D passes over tiles of the brush region, each tile on a worker with its own
+    // scratch brick holding the tile and a halo of the kernel radius
+    struct FilterScratch {
+        TArray<float> source;
+        TArray<float> target;
+    };
+    static constexpr int32 FilterTileSize = 32;
+    void ApplyEditClusterInOrder(const TArray<EditBrush>& brushes, const EditCluster& cluster, bool& outIsoEdited, bool& outTypeEdited);
+    void ApplyFilterBrush(const EditBrush& brush, bool& outIsoEdited, bool bAllowParallel = true);
+    void FilterIsoRegion(const FIntVector& regionMin, const FIntVector& regionMax, TConstArrayView<float> weights, TArray<float>& outFiltered, bool bAllowParallel) const;
+    void FilterIsoRegionReference(const FIntVector& regionMin, const FIntVector& regionMax, TConstArrayView<float> weights, TArray<float>& outFiltered) const;
+    static void ApplySDFBrushRow(const EditBrush& brush, int dy, int dz, int32 xMin, int32 xMax, float* isoRow, uint32* typeRow, float* distances, bool& outIsoEdited, bool& outTypeEdited);
+    void ApplyEditCluster(const TArray<EditBrush>& brushes, const EditCluster& cluster, bool& outIsoEdited, bool& outTypeEdited, bool bAllowParallel = true);
+    void ApplyEditClusterReference(const TArray<EditBrush>& brushes, const EditCluster& cluster, bool& outIsoEdited, bool& outTypeEdited);
+
+    int32 BuildNodes();
+    void BuildSubtree(uint64 rootKey, SubtreeBuild& outSubtree) const;
+    void BuildSubtrees(TConstArrayView<uint64> rootKeys, int32 workerCount, TArray<SubtreeBuild>& outSubtrees) const;
+    void AppendSubtree(int32 rootIndex, const SubtreeBuild& subtree);
+    int32 AllocateNode(uint64 key);
+    void ComputeNodeBounds(int32 index);
+    void AssignTransitionCells(int32 index);
+    void SubdivideNode(int32 index);
+    void CollapseNode(int32 index);
+    void MarkTopologyDirty(int32 firstIndex, int32 lastIndex);
+    void MakeNodeResident(int32 index);
+    void EvictResidentNode(int32 residentIndex);
+    void AdjustResidentBytes(int depth, int64 deltaBytes);
+    void GetNodeIsoRegion(int32 index, FIntVector& outMin, FIntVector& outMax) const;
+    void GetKeyIsoRegion(uint64 key, FIntVector& outMin, FIntVector& outMax) const;
+    bool NodeOverlapsIsoRegion(int32 index, const FIntVector& regionMin, const FIntVector& regionMax) const;
+    void ComputeNodeSummary(int32 index);
+    void ComputeRegionSummary(uint64 key, float& outMinIso, float& outMaxIso, uint32& outType) const;
+    void ComputeBoxSummary(const FIntVector& regionMin, const FIntVector& regionMax, float& outMinIso, float& outMaxIso, uint32& outType) const;
+    EVoxelNodeClass ClassifyIsoRange(float minIso, float maxIso) const;
+    void MergeChildSummaries(int32 index);
+    void RebuildNodeSummaries();
+    void UpdateEditedNode(int32 index, const FIntVector& editMin, const FIntVector& editMax);
+    void AppendDetachedChunks(TConstArrayView<VoxelSolidComponent> components, const FTransform& parentTransform);
+    void LaunchConnectivityBuild();
+    void CancelConnectivityBuild();
+    int32 FindDeepestNodeAt(const FVector& isoPosition) const;
+    float GetCombinedIso(int32 flatIndex) const { return FMath::Clamp(initIsoArray[flatIndex] + deltaIsoArray[flatIndex], 0.0f, 1.0f); }
+    uint32 GetCombinedType(int32 flatIndex) const {
+        uint32 initType = initTypeArray[flatIndex];
+        uint32 deltaType = deltaTypeArray[flatIndex];
+        return initType != deltaType && deltaType != 0 ? deltaType : initType;
+    }
+
     AActor* parent;
     int maxDepth;
     TSharedPtr<FTypeUniformBuffer> typeUniformBuffer;
@@ -65,7 +265,62 @@ protected:
 
     TArray<float> deltaIsoArray;
     TArray<float> initIsoArray;
+    TArray<uint32> initTypeArray;
     TArray<uint32> deltaTypeArray;
+    TUniquePtr<VoxelDeltaUploader> deltaUploader;
+    TUniquePtr<VoxelConnectivity> connectivity;
+    // Labelled from the base densities on a task at construction and after a reset, adopted by FinishConnectivityBuild
+    TUniquePtr<VoxelConnectivity> pendingConnectivity;
+    UE::Tasks::TTask<void> connectivityBuild;
+    std::atomic<bool> bCancelConnectivityBuild{ false };
+    // Iso regions edited while the connectivity was building, in samples
+    TArray<TPair<FIntVector, FIntVector>> pendingConnectivityRegions;
+    bool bPendingConnectivityRemovesSolid = false;
+    TArray<VoxelDetachedChunk> detachedChunks;
+
+    TChunkedArray<OctreeNode> nodes;
+    TArray<uint64> nodeKeys;
+    TArray<uint8> nodeDepths;
+    TArray<int32> nodeFirstChild;
+    TArray<FVector3f> nodeBoundsMin;
+    TArray<FVector3f> nodeBoundsMax;
+    TMap<uint64, int32> nodeLookUp;
+    // First child of every collapsed node, so splitting it again reuses the same eight slots
+    TMap<int32, int32> retiredChildren;
+    TBitArray<> nodeEdited;
+    TArray<uint32> nodeVisibleEpoch;
+    TBitArray<> nodeRefined;
+    TArray<uint32> nodeContentVersion;
+    TArray<uint32> nodeMeshedVersion;
+    TArray<uint32> nodeDeformedVersion;
+    TArray<uint32> nodeEditedVersion;
+    TArray<uint16> nodeTransitionSignature;
+    uint32 visibilityEpoch;
+    uint32 editVersion;
+    TSharedPtr<const VoxelTopologySnapshot> topologySnapshot;
+    // Snapshot pages whose nodes were appended or split since topologySnapshot was taken
+    TBitArray<> topologyDirtyPages;
+
+    // Per node density range and material, MixedNodeType when the node covers more than one material
+    static constexpr uint32 MixedNodeType = MAX_uint32;
+    TArray<float> nodeMinIso;
+    TArray<float> nodeMaxIso;
+    TArray<uint32> nodeType;
+
+    uint32 nodeVertexBufferSize;
+
+    TUniquePtr<VoxelResourcePool> resourcePool;
+    TArray<int32> residentNodes;
+    TArray<int32> nodeResidentSlot;
+    TArray<uint32> nodeLastVisibleFrame;
+    TBitArray<> nodePinned;
+    // Kept between updates so an over budget update sorts its candidates without allocating
+    TArray<int32> evictionCandidates;
+    TArray<uint64> residentBytesPerDepth;
+    uint32 residencyFrame;
+    uint32 residencyGraceFrames;
+    uint64 residencyBudgetBytes;
+
     bool bIsoValuesDirty;
     bool bTypeValuesDirty;
 
@@ -73,7 +328,6 @@ protected:
     void GetIsoPlaneInDirection(FVector direction, FVector position,
         float& isoA, float& isoB, float& isoC, float& isoD,
         FVector& posA, FVector& posB, FVector& posC, FVector& posD);
-    void DebugOctreeNodesRecursive(OctreeNode* node, UWorld* world, FQuat rotator, FTransform parentTransform);
 
 private:
     float scale;
@@ -4,39 +4,19 @@
 #include "FVoxelVertexFactory.h"
 #include "RenderResource.h"
 #include "VoxelRenderBuffers.h"
+#include "VoxelRenderResourceTable.h"
 #include "Materials/MaterialRelevance.h"
 
 class FVoxelVertexFactory;
 class OctreeNode;
-
-class VoxelCell {
-public:
-    TSharedPtr<FIsoDynamicBuffer> avgIsoBuffer;
-    TSharedPtr<FTypeDynamicBuffer> avgTypeBuffer;
-    VoxelCell() {}
-
-    void Initialize(uint32 bufferSize) {
-        avgIsoBuffer->Initialize(bufferSize);
-        avgTypeBuffer->Initialize(bufferSize);
-    }
-    void ReleaseResources() {
-        if (avgIsoBuffer.IsValid()) {
-            avgIsoBuffer->ReleaseResource();
-        }
-        if (avgTypeBuffer.IsValid()) {
-            avgTypeBuffer->ReleaseResource();
-        }
-    }
-
-    void ResetResources() {
-        avgIsoBuffer.Reset();
-        avgTypeBuffer.Reset();
-    }
-
-    VoxelCell(uint32 bufferSize) {
-        avgIsoBuffer = MakeShareable(new FIsoDynamicBuffer(bufferSize));
-        avgTypeBuffer = MakeShareable(new FTypeDynamicBuffer(bufferSize));
-    }
+class Octree;
+class VoxelResourcePool;
+
+// Empty and Solid nodes lie entirely on one side of the iso level and cannot produce a surface
+enum class EVoxelNodeClass : uint8 {
+    Empty,
+    Solid,
+    Surface
 };
 
 static const TArray<FIntVector> neighborOffsets = {
@@ -48,6 +28,18 @@ static const TArray<FIntVector> neighborOffsets = {
     FIntVector(0,  0,  1)
 };
 
+// View parameters for LOD selection, resolved into the tree's local space once per frame
+struct VoxelLODView {
+    FVector localPosition;
+    FVector localForward;
+    float localDistance;
+    bool forwardCheck;
+
+    // Screen space error selection: pixels covered by one local unit at distance one, and the pixel error allowed per voxel
+    float projectionScale;
+    float errorThreshold;
+};
+
 class TransitionCell  {
 public:
     TransitionCell() : direction(0), adjacentNodeIndex(0), enabled(false) {}
@@ -58,39 +50,40 @@ public:
     OctreeNode* adjacentNodes[4]{nullptr, nullptr, nullptr, nullptr};
 };
 
-class RegularCell : public VoxelCell {
-public:
-    RegularCell() : VoxelCell() {}
-    RegularCell(uint32 bufferSize) : VoxelCell(bufferSize){}
-};
-
-class OctreeNode {
+class OCTREE_API OctreeNode {
 public:
     OctreeNode();
-    OctreeNode(AActor* treeActor, OctreeNode* inParent, const AABB& inBounds, uint32 bufferSize, uint32 inVoxelsPerAxis, int depth, int maxDepth, bool bInIsRoot = false);
     ~OctreeNode();
 
-    void Release();
-    bool IsLeaf() const { return isLeaf; }
-    bool IsRoot() const { return isRoot; }
-    bool IsVisible() const { return isVisible; }
-    void SetVisible(bool visibility) { isVisible = visibility; }
-
-    TSharedPtr<FVoxelVertexFactory> GetVertexFactory(){ return vertexFactory; }
-    TSharedPtr<FIsoDynamicBuffer> GetIsoBuffer() { return regularCell.avgIsoBuffer; }
-    TSharedPtr<FTypeDynamicBuffer> GetTypeBuffer() { return regularCell.avgTypeBuffer; }
-    OctreeNode* GetNodeParent() const { return parent; }
-
-    FVector GetNodePosition() const { return FVector(bounds.Center().X, bounds.Center().Y, bounds.Center().Z);  }
-    FVector GetNodeSize() const { return FVector(bounds.Size().X, bounds.Size().Y, bounds.Size().Z); }
-    FVector GetWorldNodePosition() const { return  treeActor->GetTransform().TransformPosition(GetNodePosition()); }
-    void AssignChildNeighboursAsRoot();
-    AABB GetBounds() const { return bounds; }
-    int GetDepth() const { return depth; }
-
-    TransitionCell* GetTransitionCell(int index) { 
-        if (index < 3 && index >= 0)
-            return &transitonCells[index];
+    void Bind(Octree* inTree, int32 inIndex);
+    void AcquireResources(VoxelResourcePool& pool);
+    void ReturnResources(VoxelResourcePool& pool);
+    bool IsResident() const { return isResident; }
+
+    bool IsLeaf() const;
+    bool IsRoot() const { return index == 0; }
+    bool IsVisible() const;
+    void SetVisible(bool visibility);
+
+    VoxelRenderHandle GetRenderResources() const { return renderResources; }
+    OctreeNode* GetNodeParent() const;
+    OctreeNode* GetChild(int childIndex) const;
+    OctreeNode* GetNeighbour(int direction) const;
+    Octree* GetTree() const { return tree; }
+    AActor* GetTreeActor() const;
+
+    FVector GetNodePosition() const { FVector3f center = GetBounds().Center(); return FVector(center.X, center.Y, center.Z); }
+    FVector GetNodeSize() const { FVector3f size = GetBounds().Size(); return FVector(size.X, size.Y, size.Z); }
+    FVector GetWorldNodePosition() const { return GetTreeActor()->GetTransform().TransformPosition(GetNodePosition()); }
+    AABB GetBounds() const;
+    int GetDepth() const;
+    uint64 GetKey() const;
+    int32 GetIndex() const { return index; }
+    EVoxelNodeClass ClassifyNode() const;
+
+    TransitionCell* GetTransitionCell(int cellIndex) { 
+        if (cellIndex < 3 && cellIndex >= 0)
+            return &transitonCells[cellIndex];
         else return nullptr;
     }
 
@@ -128,57 +121,28 @@ public:
         }
     }
 
-    bool RayIntersectVoxelBody(FVector start, FQuat forwardView, float inDistance, bool forwardCheckFlag)
-    {
-        FTransform parentTransform = treeActor->GetTransform();
-        FVector worldDir = (GetWorldNodePosition() - start);
-        worldDir.Normalize();
-        FVector end = start + (worldDir * inDistance);
-        start = parentTransform.InverseTransformPosition(start);
-        end = parentTransform.InverseTransformPosition(end);
-
-        FVector segmentDir = end - start;
-        FVector normalView = segmentDir.GetSafeNormal();;
-
-        float dot = FVector::DotProduct(parentTransform.InverseTransformRotation(forwardView).GetForwardVector(), normalView);
-        bool isInFront = forwardCheckFlag ? dot > 0 : true;
-
-        float ratio = bounds.Size().X / 2.0;
-        FVector extent = FVector(ratio, ratio, ratio);
-
-        FBox boundsFBox = FBox();
-        FVector3f nodeCenterV3F = bounds.Center();
-        FVector nodeCenter = FVector(nodeCenterV3F.X, nodeCenterV3F.Y, nodeCenterV3F.Z);
-        boundsFBox = boundsFBox.BuildAABB(nodeCenter, extent * 2);
-
-        FVector oneOverDirection(
-            FMath::IsNearlyZero(segmentDir.X) ? 1e10f : 1.0f / segmentDir.X,
-            FMath::IsNearlyZero(segmentDir.Y) ? 1e10f : 1.0f / segmentDir.Y,
-            FMath::IsNearlyZero(segmentDir.Z) ? 1e10f : 1.0f / segmentDir.Z
-        );
-        bool bIntersects = FMath::LineBoxIntersection(boundsFBox, start, end, segmentDir, oneOverDirection);
-        bool bInsideOrOn = boundsFBox.IsInside(start);// || boundsFBox.IsInside(end);
-        return ((bIntersects && isInFront) || bInsideOrOn) ? true : false;
+    // Enabled state and direction of each transition cell slot, 4 bits per slot
+    uint32 GetTransitionSignature() const {
+        uint32 signature = 0;
+        for (int i = 0; i < 3; i++) {
+            if (transitonCells[i].enabled)
+                signature |= (0x8u | (uint32)transitonCells[i].direction) << (i * 4);
+        }
+        return signature;
     }
 
-    OctreeNode* children[8];
-    OctreeNode* neighbours[6]; // Post diss submission refactor to remove neighbours
+    bool RayIntersectVoxelBody(const VoxelLODView& view) const;
+    bool ExceedsScreenSpaceError(const VoxelLODView& view, float hysteresis, bool wasRefined) const;
+    // Bounds only forms of the refinement tests, for selection running on a topology snapshot
+    static bool RayIntersectsBounds(const AABB& bounds, const VoxelLODView& view);
+    static bool BoundsExceedScreenSpaceError(const AABB& bounds, int voxelsPerAxis, const VoxelLODView& view, float hysteresis, bool wasRefined);
 
 protected:
-    int depth;
-    uint32 voxelsPerAxis;
-    AActor* treeActor;
-    OctreeNode* parent;
-
-    bool isLeaf;
-    bool isVisible;
-    bool isRoot;
-    AABB bounds;
-
-    TSharedPtr<FVoxelVertexFactory> vertexFactory;
-    RegularCell regularCell;
-    TransitionCell transitonCells[3];
+    // Topology and bounds live in the owning Octree's linear arrays, the node only keeps its index into them.
+    Octree* tree;
+    int32 index;
+    bool isResident;
 
-    void AssignChildNeighbours(OctreeNode* inNeighbours[6]);
-    void Subdivide(int inDepth, int maxDepth, int bufferSize);
+    VoxelRenderHandle renderResources;
+    TransitionCell transitonCells[3];
 };
@@ -2,9 +2,11 @@
 #include "CoreMinimal.h"
 #include "OctreeNode.h"
 #include "Octree.h"
+#include "VoxelRenderResourceTable.h"
 
 /**
- * Update data for Compute dispatch
+ * Update data for Compute dispatch. Node resources are carried as render table handles and resolved on the render
+ * thread, so the per node structs stay plain data.
  */
 
 struct FVoxelComputeUpdateNodeData {
@@ -13,25 +15,24 @@ private:
 public:
 	int leafDepth;
 	FVector3f boundsCenter;
+	bool applyDeformation;
+	bool generateMesh;
 
-	TSharedPtr<class FVoxelVertexFactory> vertexFactory;
-	TSharedPtr<FIsoDynamicBuffer> isoBuffer;
-	TSharedPtr<FTypeDynamicBuffer> typeBuffer;
+	VoxelRenderHandle renderResources;
 
 	FVoxelComputeUpdateNodeData() : FVoxelComputeUpdateNodeData(nullptr) {}
 	FVoxelComputeUpdateNodeData(OctreeNode* inDataNode)
 		: dataNode(inDataNode)
 		, leafDepth(0)
 		, boundsCenter(FVector3f())
-		, vertexFactory(nullptr) {
+		, applyDeformation(true)
+		, generateMesh(true) {
 	}
 
 	bool BuildDataCache() {
 		if (dataNode)
 		{
-			vertexFactory = dataNode->GetVertexFactory();
-			isoBuffer = dataNode->GetIsoBuffer();
-			typeBuffer = dataNode->GetTypeBuffer();
+			renderResources = dataNode->GetRenderResources();
 			leafDepth = dataNode->GetDepth();
 			boundsCenter = dataNode->GetBounds().Center();
 			dataNode = nullptr;
@@ -89,6 +90,9 @@ public:
 	}
 };
 
+static_assert(std::is_trivially_copyable_v<FVoxelComputeUpdateNodeData>, "Node dispatch data is copied per node every update");
+static_assert(std::is_trivially_copyable_v<FVoxelTransVoxelNodeData>, "Transvoxel dispatch data is copied per cell every update");
+
 struct FVoxelComputeUpdateData {
 
 private:
@@ -116,6 +120,13 @@ public:
 	FVoxelComputeUpdateData(Octree* inOctree) : octree(inOctree), scale(0), isoLevel(0), octreePosition(FVector3f()), 
 		voxelsPerAxis(0), highResVoxelsPerAxis(0) {}
 
+	// Rebinds to a tree for the next BuildDataCache, the node lists are emptied but keep their capacity
+	void Reset(Octree* inOctree) {
+		octree = inOctree;
+		nodeData.Reset();
+		transVoxelNodeData.Reset();
+	}
+
 	bool BuildDataCache() {
 
 		if (!octree) return false;
@@ -155,19 +166,21 @@ private:
 	OctreeNode* dataNode;
 public:
 	uint8 leafDepth;
-	TSharedPtr<class FVoxelVertexFactory> vertexFactory;
+	uint64 nodeKey;
+	VoxelRenderHandle renderResources;
 
 	FVoxelProxyUpdateDataNode() : FVoxelProxyUpdateDataNode(0, nullptr) {}
 	FVoxelProxyUpdateDataNode(uint8 inLeafDepth, OctreeNode* inDataNode)
 		: dataNode(inDataNode)
 		, leafDepth(inLeafDepth)
-		, vertexFactory(nullptr) {
+		, nodeKey(0) {
 	}
 
 	bool BuildDataCache() {
 		if (dataNode)
 		{
-			vertexFactory = dataNode->GetVertexFactory();
+			renderResources = dataNode->GetRenderResources();
+			nodeKey = dataNode->GetKey();
 			dataNode = nullptr;
 			return  true;
 		}
@@ -176,3 +189,28 @@ public:
 		return false;
 	}
 };
+
+static_assert(std::is_trivially_copyable_v<FVoxelProxyUpdateDataNode>, "Proxy node data is copied into every diff");
+
+/**
+  * Changes to the proxy's node set since the last diff, keyed by morton key. Changed entries replace the stored state
+  * of a node the proxy already draws, removed keys that the proxy does not hold are ignored. A reset diff clears the
+  * proxy first and lists every node as added.
+ */
+
+struct FVoxelProxyNodeDiff
+{
+	TArray<FVoxelProxyUpdateDataNode> added;
+	TArray<FVoxelProxyUpdateDataNode> changed;
+	TArray<uint64> removed;
+	bool bReset = false;
+
+	bool IsEmpty() const { return !bReset && added.Num() == 0 && changed.Num() == 0 && removed.Num() == 0; }
+
+	void Reset() {
+		added.Reset();
+		changed.Reset();
+		removed.Reset();
+		bReset = false;
+	}
+};
@@ -0,0 +1,31 @@
+#pragma once
+#include "CoreMinimal.h"
+
+/**
+ * Row kernels for brush edits on the delta grid. Rows are contiguous in x, so a brush is applied one row at a time:
+ * the caller clips the row to the grid and to the sphere's chord up front, the kernel only runs the x range that can
+ * change. Each kernel returns whether any value in the range changed.
+ */
+
+class OCTREE_API VoxelBrushKernel {
+public:
+    // iso[x] += signedInfluence * (1 - d / radius)^2 clamped to [-1, 1], for x in [xMin, xMax], where
+    // d^2 = (x - centerX)^2 + distanceYZSquared. Four samples per step with a vector square root.
+    static bool ApplySphereIsoRow(float* RESTRICT isoRow, int32 xMin, int32 xMax, float centerX, float distanceYZSquared, float invRadius, float signedInfluence);
+    // Scalar form of the same falloff, one square root per sample
+    static bool ApplySphereIsoRowReference(float* RESTRICT isoRow, int32 xMin, int32 xMax, float centerX, float distanceYZSquared, float invRadius, float signedInfluence);
+    // The same falloff on the distance to the segment start + axis * t, t in [0, 1]. offsetY and offsetZ are the row's
+    // y and z minus the segment start's, invAxisLengthSquared is zero for a degenerate segment.
+    static bool ApplyCapsuleIsoRow(float* RESTRICT isoRow, int32 xMin, int32 xMax, float startX, float offsetY, float offsetZ, const FVector3f& axis, float invAxisLengthSquared, float invRadius, float signedInfluence);
+    static bool ApplyCapsuleIsoRowReference(float* RESTRICT isoRow, int32 xMin, int32 xMax, float startX, float offsetY, float offsetZ, const FVector3f& axis, float invAxisLengthSquared, float invRadius, float signedInfluence);
+    // iso[i] += signedInfluence * (depth / falloff)^2 clamped to [-1, 1], depth being -distances[i] clamped to [0, falloff]
+    static bool ApplyDistanceIsoRow(float* RESTRICT isoRow, const float* RESTRICT distances, int32 count, float invFalloff, float signedInfluence);
+    // Only samples on or inside the surface take the type
+    static bool FillTypeRowInside(uint32* RESTRICT typeRow, const float* RESTRICT distances, int32 count, uint32 type);
+    // combined = clamp(init + delta, 0, 1) moves towards target[x - xMin] by influence * (1 - d / radius)^2 and the
+    // delta is stored back clamped to [-1, 1], d^2 = (x - centerX)^2 + distanceYZSquared
+    static bool BlendSphereIsoRow(float* RESTRICT deltaRow, const float* RESTRICT initRow, const float* RESTRICT targetRow, int32 xMin, int32 xMax, float centerX, float distanceYZSquared, float invRadius, float influence);
+    // One 1D pass of a separable filter: target[x] = sum over taps of weights[tap] * source[x + tap * tapStride]
+    static void ConvolveRow(const float* RESTRICT source, float* RESTRICT target, int32 count, int32 tapStride, TConstArrayView<float> weights);
+    static bool FillTypeRow(uint32* RESTRICT typeRow, int32 xMin, int32 xMax, uint32 type);
+};
@@ -0,0 +1,98 @@
+#pragma once
+#include "CoreMinimal.h"
+#include <atomic>
+
+// A 6-connected set of solid samples, bounds inclusive and in samples
+struct VoxelSolidComponent {
+    FIntVector min;
+    FIntVector max;
+    int64 sampleCount;
+};
+
+/**
+ * Keeps track of which solid samples (combined density below the iso level) are connected, so pieces cut off from the
+ * body can be found without flood filling the grid. The grid is cut into BrickSize^3 bricks, each brick stores the
+ * components its own samples form and the links between those and the components of the bricks beside it. An edit
+ * relabels only the bricks it touched and relinks their faces.
+ *
+ * Loose pieces are found by searching the brick graph from every component in or beside the touched bricks at once,
+ * one node per search in turn. Searches that meet are merged, a search that runs out while another is still going is a
+ * piece that has come loose, and the search stops as soon as one is left: that one holds the body. The cost is the
+ * size of the pieces that came loose, not the size of the body.
+ *
+ * Pieces stay in the grid once reported, so every component remembers whether it is loose. A search that runs out is
+ * only reported if it holds a component that was attached before the edit; cutting up a loose piece again reports
+ * nothing. Relabelled components take the flag of the components they overlapped before the edit, and an edit that
+ * joins a loose piece back onto an attached one clears the flag across the piece. Build counts every component as
+ * attached.
+ */
+
+class OCTREE_API VoxelConnectivity {
+public:
+    VoxelConnectivity(const TArray<float>& inInitIso, const TArray<float>& inDeltaIso, int inSamplesPerAxis, float inIsoLevel);
+
+    void Build();
+    // Labels the base densities alone, so it can run on a worker while edits write the delta. Regions edited meanwhile
+    // are marked dirty and updated once it returns. Setting cancel stops it early and leaves the labels unusable.
+    void BuildFromBase(const std::atomic<bool>& cancel);
+    // Bricks overlapping the region are relabelled by the next Update
+    void MarkDirty(const FIntVector& regionMin, const FIntVector& regionMax);
+    // Relabels the dirty bricks, with bCanDetach also searches around them and appends the pieces no longer attached
+    void Update(bool bCanDetach, TArray<VoxelSolidComponent>& outDetached);
+
+    int32 GetBrickCount() const { return bricks.Num(); }
+    int32 GetLastRelabelledBricks() const { return lastRelabelledBricks; }
+    int32 GetLastSearchedNodes() const { return lastSearchedNodes; }
+    uint64 GetAllocatedBytes() const;
+
+    static constexpr int32 BrickSize = 8;
+
+private:
+    static constexpr int32 BrickVolume = BrickSize * BrickSize * BrickSize;
+
+    struct BrickComponent {
+        FIntVector min;
+        FIntVector max;
+        int32 sampleCount;
+        // Cut off from the body, either reported or added where nothing attached was
+        bool bLoose;
+    };
+    // Links are stored on both bricks of a face
+    struct BrickLink {
+        uint16 component;
+        uint16 neighbourComponent;
+        int32 neighbourBrick;
+    };
+    struct Brick {
+        TArray<BrickComponent> components;
+        TArray<BrickLink> links;
+    };
+    // Labels are BrickSize strided even where the brick overhangs the grid, 0 is empty and component c is c + 1
+    typedef TArray<uint16> BrickLabels;
+
+    // A graph node is a component of a brick
+    static uint64 MakeNode(int32 brick, int32 component) { return ((uint64)brick << 16) | (uint64)component; }
+    static int32 GetNodeBrick(uint64 node) { return (int32)(node >> 16); }
+    static int32 GetNodeComponent(uint64 node) { return (int32)(node & 0xffff); }
+
+    int32 GetBrickIndex(const FIntVector& brick) const { return brick.X + (brick.Y * bricksPerAxis) + (brick.Z * bricksPerAxis * bricksPerAxis); }
+    FIntVector GetBrickCoord(int32 index) const { return FIntVector(index % bricksPerAxis, (index / bricksPerAxis) % bricksPerAxis, index / (bricksPerAxis * bricksPerAxis)); }
+    void BuildLayers(bool bWithDelta, const std::atomic<bool>* cancel);
+    void LabelBrick(int32 brickIndex, BrickLabels& outLabels, TArray<BrickComponent>& outComponents, bool bWithDelta = true) const;
+    void LinkFace(int32 lowerBrick, const BrickLabels& lowerLabels, int32 upperBrick, const BrickLabels& upperLabels, int axis);
+    void InheritLoose(int32 brickIndex, const BrickLabels& labels, TConstArrayView<BrickComponent> previous, TArray<BrickComponent>& components) const;
+    void FindDetached(TConstArrayView<uint64> seeds, TArray<VoxelSolidComponent>& outDetached);
+    void ReattachLoose();
+
+    const TArray<float>& initIso;
+    const TArray<float>& deltaIso;
+    int samplesPerAxis;
+    int bricksPerAxis;
+    float isoLevel;
+
+    TArray<Brick> bricks;
+    TBitArray<> dirtyBricks;
+    TArray<int32> dirtyList;
+    int32 lastRelabelledBricks = 0;
+    int32 lastSearchedNodes = 0;
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "VoxelRenderBuffers.h"
+#include "VoxelOctreeUtils.h"
+
+/**
+ * Uploads the max resolution delta iso/type arrays to the GPU one brick at a time. The GPU buffers are brick major
+ * (voxelDeltaBrickSize^3 contiguous samples per brick), edits mark the bricks they touch and only runs of dirty bricks
+ * are copied into a versioned snapshot. The render command owns a reference to its snapshot, so the game thread keeps
+ * editing the live arrays without waiting; a pooled snapshot is only written again once nothing else references it.
+ */
+
+class OCTREE_API VoxelDeltaUploader {
+public:
+    VoxelDeltaUploader(int inIsoValuesPerAxis);
+
+    // Element count the brick major GPU buffers need, every brick is stored whole even where it overhangs the grid
+    int32 GetPaddedCount() const { return bricksPerAxis * bricksPerAxis * bricksPerAxis * BrickVolume; }
+    int32 GetBrickIndex(const FIntVector& brick) const { return brick.X + (brick.Y * bricksPerAxis) + (brick.Z * bricksPerAxis * bricksPerAxis); }
+
+    void MarkDirty(const FIntVector& regionMin, const FIntVector& regionMax, bool bIso, bool bType);
+    void MarkAllDirty();
+    bool HasDirtyBricks() const { return dirtyIsoCount > 0 || dirtyTypeCount > 0; }
+
+    static constexpr int BrickVolume = voxelDeltaBrickSize * voxelDeltaBrickSize * voxelDeltaBrickSize;
+
+    // Bricks firstBrick onwards, stored whole from stagingOffset in the snapshot's arrays
+    struct BrickRun {
+        int32 firstBrick;
+        int32 brickCount;
+        int32 stagingOffset;
+    };
+
+    struct BrickSnapshot {
+        uint64 version = 0;
+        uint32 checksum = 0;
+        bool bValidate = false;
+        TArray<float> iso;
+        TArray<uint32> type;
+        TArray<BrickRun> isoRuns;
+        TArray<BrickRun> typeRuns;
+
+        uint32 ComputeChecksum() const;
+    };
+
+    // Copies the dirty bricks out of the live arrays and clears them. Whoever holds the snapshot sees the arrays as they
+    // were here, however they are edited afterwards. Null when nothing is dirty.
+    TSharedPtr<const BrickSnapshot> TakeSnapshot(const TArray<float>& deltaIso, const TArray<uint32>& deltaType);
+    void Upload(const TArray<float>& deltaIso, const TArray<uint32>& deltaType,
+        const TSharedPtr<FIsoDynamicBuffer>& isoBuffer, const TSharedPtr<FTypeDynamicBuffer>& typeBuffer);
+
+    int GetBricksPerAxis() const { return bricksPerAxis; }
+    uint64 GetLastUploadBytes() const { return lastUploadBytes; }
+    uint64 GetSnapshotVersion() const { return snapshotVersion; }
+
+private:
+    static constexpr int MaxPooledSnapshots = 4;
+
+    // Render thread only: the last snapshot version copied to the GPU, used to check snapshots land in order
+    struct RenderState {
+        uint64 lastAppliedVersion = 0;
+    };
+
+    TSharedPtr<BrickSnapshot> AcquireSnapshot();
+
+    template<typename T>
+    void GatherDirtyBricks(TBitArray<>& dirtyBricks, int32& dirtyCount, const TArray<T>& source, TArray<T>& outStaging, TArray<BrickRun>& outRuns) const;
+
+    int isoValuesPerAxis;
+    int bricksPerAxis;
+    TBitArray<> dirtyIsoBricks;
+    TBitArray<> dirtyTypeBricks;
+    int32 dirtyIsoCount;
+    int32 dirtyTypeCount;
+
+    TArray<TSharedPtr<BrickSnapshot>> snapshotPool;
+    TSharedPtr<RenderState> renderState;
+    uint64 snapshotVersion;
+    uint64 lastUploadBytes;
+};
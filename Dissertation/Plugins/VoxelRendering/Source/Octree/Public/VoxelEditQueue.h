@@ -0,0 +1,87 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "VoxelSDFBrush.h"
+
+// Add raises the surface and paints it, Subtract carves without touching types, Paint only changes types.
+// Smooth blends density towards its blurred neighbourhood, Flatten towards a plane facing away from the body's centre.
+enum class EVoxelEditOp : uint8 {
+    Add,
+    Subtract,
+    Paint,
+    Smooth,
+    Flatten
+};
+
+enum class EVoxelEditShape : uint8 {
+    Sphere,
+    Capsule,    // The sphere swept from sweepStart to position
+    SDF         // sdfBrush placed at position with rotation, radius is unused
+};
+
+// A brush edit in world space, radius, influence and paint type come from the editing palette
+struct VoxelEditCommand {
+    EVoxelEditOp op = EVoxelEditOp::Subtract;
+    EVoxelEditShape shape = EVoxelEditShape::Sphere;
+    FVector position = FVector::ZeroVector;
+    FVector sweepStart = FVector::ZeroVector;
+    FQuat rotation = FQuat::Identity;
+    TSharedPtr<const VoxelSDFBrush> sdfBrush;
+    float radius = 0.0f;
+    float influence = 0.0f;
+    uint32 paintType = 0;
+
+    bool WritesIso() const { return op != EVoxelEditOp::Paint; }
+    bool WritesType() const { return op == EVoxelEditOp::Add || op == EVoxelEditOp::Paint; }
+    // Filters read the density around the brush as well as under it, so they are sphere only and never folded
+    bool IsFilter() const { return op == EVoxelEditOp::Smooth || op == EVoxelEditOp::Flatten; }
+};
+
+/**
+ * Lock free multi producer, single consumer queue of edit commands. Any thread may push, the owner drains once per
+ * frame on the game thread and hands the batch to Octree::ApplyEditBatch, so voxel memory is only touched there.
+ */
+
+class OCTREE_API VoxelEditQueue {
+public:
+    // Any thread
+    void Push(const VoxelEditCommand& command);
+
+    // Consumer only. Stops after maxCommands so producers outrunning the consumer cannot stall a frame
+    int32 Drain(TArray<VoxelEditCommand>& outCommands, int32 maxCommands = MAX_int32);
+    bool IsEmpty() const { return queue.IsEmpty(); }
+
+    // Folds repeats of an identical brush into its first occurrence, summing iso influence and dropping repeated
+    // paints. A repeat is only folded while every iso and type write between the two goes the same way as its own,
+    // so clamping and type order come out as if the commands were applied in turn. Returns the number removed.
+    static int32 Coalesce(TArray<VoxelEditCommand>& commands);
+
+private:
+    TQueue<VoxelEditCommand, EQueueMode::Mpsc> queue;
+};
+
+/**
+ * Turns a brush that moves every frame into capsule edits issued at a fixed step rate, so a stroke removes the same
+ * amount per second and covers its whole path whatever the framerate. Frames shorter than a step only extend the
+ * pending segment, a frame spanning several steps issues one segment and the number of steps it covers, which the
+ * caller splits into one edit per step.
+ */
+
+class OCTREE_API VoxelEditStroke {
+public:
+    // True when a step is due, with the start of the segment ending at position and how many steps it carries.
+    // The first call of a stroke, or one with a different op, starts a new stroke and is due at once.
+    bool Advance(EVoxelEditOp op, const FVector& position, float deltaSeconds, float stepSeconds, FVector& outSweepStart, int32& outSteps);
+    void End() { bActive = false; }
+    bool IsActive() const { return bActive; }
+    const FVector& GetSegmentStart() const { return segmentStart; }
+
+    // Caps the influence a single hitch can put into one segment
+    static constexpr int32 MaxStepsPerSegment = 4;
+
+private:
+    FVector segmentStart = FVector::ZeroVector;
+    float pendingSeconds = 0.0f;
+    EVoxelEditOp strokeOp = EVoxelEditOp::Subtract;
+    bool bActive = false;
+};
@@ -0,0 +1,77 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "AABB.h"
+#include "OctreeNode.h"
+
+/**
+ * LOD selection and balancing over an immutable copy of the octree's topology, so it can run on a worker while the
+ * game thread keeps editing the live tree. Nodes are only ever appended to the tree and collapsed children keep their
+ * storage, so indices selected on a snapshot stay valid in the live tree. The copy is split into pages of consecutive
+ * nodes and a new snapshot shares every page with the one before it except those holding appended nodes or a node that
+ * was split or collapsed.
+ */
+
+struct OCTREE_API VoxelTopologySnapshot {
+    static constexpr int32 PageShift = 12;
+    static constexpr int32 PageSize = 1 << PageShift;
+
+    struct Page {
+        TArray<uint64> keys;
+        TArray<uint8> depths;
+        TArray<int32> firstChild;
+        TArray<FVector3f> boundsMin;
+        TArray<FVector3f> boundsMax;
+    };
+
+    TArray<TSharedPtr<const Page>> pages;
+    int32 nodeCount = 0;
+    int voxelsPerAxis = 0;
+
+    int32 Num() const { return nodeCount; }
+    uint64 GetKey(int32 index) const { return GetPage(index).keys[index & (PageSize - 1)]; }
+    uint8 GetDepth(int32 index) const { return GetPage(index).depths[index & (PageSize - 1)]; }
+    int32 GetFirstChild(int32 index) const { return GetPage(index).firstChild[index & (PageSize - 1)]; }
+    bool IsLeaf(int32 index) const { return GetFirstChild(index) == INDEX_NONE; }
+    AABB GetBounds(int32 index) const {
+        const Page& page = GetPage(index);
+        return { page.boundsMin[index & (PageSize - 1)], page.boundsMax[index & (PageSize - 1)] };
+    }
+
+private:
+    const Page& GetPage(int32 index) const { return *pages[index >> PageShift]; }
+};
+
+struct VoxelLODSelectionInput {
+    TSharedPtr<const VoxelTopologySnapshot> topology;
+    VoxelLODView view;
+    bool bScreenSpaceError = false;
+    // Shared with the owner and only replaced when the settings change, so launching a selection copies neither
+    TSharedPtr<const TArray<float>> hysteresisPerDepth;
+    // Refinement decisions of the previous selection, screen space error keeps them inside its hysteresis band
+    TSharedPtr<const TBitArray<>> wasRefined;
+    // Nodes at this depth are never refined, lets the benchmark emulate shallower trees
+    int maxDepth = MAX_int32;
+    // Off leaves the cut unbalanced, lets the benchmark run both balancers on the same cut
+    bool bBalance = true;
+};
+
+struct VoxelLODSelectionResult {
+    TArray<int32> visibleNodes;
+    TBitArray<> refined;
+    float finestNodeSize = MAX_flt;
+    // Working storage of the selection, kept with the result so a reused result selects without allocating
+    TBitArray<> visible;
+    TArray<int32> workList;
+};
+
+class OCTREE_API VoxelLODSelector {
+public:
+    static void Select(const VoxelLODSelectionInput& input, VoxelLODSelectionResult& outResult);
+    static void Balance(const VoxelTopologySnapshot& topology, TBitArray<>& visible, TArray<int32>& visibleNodes, TArray<int32>& workList);
+    // The original quadratic balancing over the live tree's visible nodes, behind voxel.LegacyLODBalance
+    static void BalanceLegacy(TArray<OctreeNode*>& visibleNodes);
+
+private:
+    static bool ShouldRefine(const VoxelLODSelectionInput& input, int32 index, TBitArray<>& refined);
+    static int32 FindVisibleAncestor(const VoxelTopologySnapshot& topology, const TBitArray<>& visible, uint64 key);
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "FVoxelVertexFactory.h"
+#include "VoxelRenderBuffers.h"
+#include "Containers/StaticArray.h"
+
+/**
+ * 32 bit reference to a set of node render resources: the low bits index a slot of the resource table, the high bits
+ * hold the slot's generation when the set was created. Zero is never handed out.
+ */
+
+struct VoxelRenderHandle {
+    static constexpr uint32 IndexBits = 20;
+    static constexpr uint32 IndexMask = (1u << IndexBits) - 1;
+    static constexpr uint32 GenerationMask = (1u << (32 - IndexBits)) - 1;
+
+    uint32 value = 0;
+
+    static VoxelRenderHandle Make(uint32 index, uint32 generation) { return { (generation << IndexBits) | index }; }
+    bool IsValid() const { return value != 0; }
+    uint32 GetIndex() const { return value & IndexMask; }
+    uint32 GetGeneration() const { return value >> IndexBits; }
+
+    bool operator==(VoxelRenderHandle other) const { return value == other.value; }
+    bool operator!=(VoxelRenderHandle other) const { return value != other.value; }
+    friend uint32 GetTypeHash(VoxelRenderHandle handle) { return handle.value; }
+};
+
+struct VoxelRenderResources {
+    FVoxelVertexFactory* vertexFactory = nullptr;
+    FIsoDynamicBuffer* isoBuffer = nullptr;
+    FTypeDynamicBuffer* typeBuffer = nullptr;
+};
+
+/**
+ * Process wide owner of the per node vertex factories and avg iso/type buffers. Dispatch and proxy data carry handles
+ * and the render thread resolves them when it records a pass or draws, so nothing per node is reference counted.
+ * Release is deferred to a render command that frees the objects, bumps the slot generation and recycles the slot,
+ * so commands enqueued before a release still resolve and any handle kept past it resolves to null.
+ */
+
+class OCTREE_API VoxelRenderResourceTable {
+public:
+    static VoxelRenderResourceTable& Get();
+
+    // Game thread. The GPU objects are created uninitialised, the caller initialises them on the render thread
+    VoxelRenderHandle Create(uint32 isoBufferSize, uint32 vertexBufferSize);
+    void Release(TConstArrayView<VoxelRenderHandle> handles);
+
+    // Render thread
+    const VoxelRenderResources* Resolve(VoxelRenderHandle handle) const;
+
+    int32 GetLiveCount() const { return liveCount; }
+
+private:
+    struct Slot {
+        VoxelRenderResources resources;
+        uint32 generation = 1;
+    };
+
+    static constexpr uint32 SlotsPerChunk = 1024;
+    static constexpr uint32 MaxChunks = (VoxelRenderHandle::IndexMask + 1) / SlotsPerChunk;
+
+    Slot& GetSlot(uint32 index) const { return chunks[index / SlotsPerChunk][index % SlotsPerChunk]; }
+    void ReleaseRenderThread(TConstArrayView<VoxelRenderHandle> handles);
+
+    // Chunks never move once allocated, the render thread reads slots while the game thread creates new ones
+    TStaticArray<TUniquePtr<Slot[]>, MaxChunks> chunks;
+    uint32 slotCount = 0;
+    int32 liveCount = 0;
+
+    // Slots are freed on the render thread and reused on the game thread
+    FCriticalSection freeSlotsLock;
+    TArray<uint32> freeSlots;
+};
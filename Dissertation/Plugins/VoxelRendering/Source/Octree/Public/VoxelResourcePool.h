@@ -0,0 +1,35 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "OctreeNode.h"
+#include "VoxelRenderResourceTable.h"
+
+/**
+ * Recycles the per node resource sets of the render resource table. Every node of a tree uses the same buffer sizes,
+ * so any pooled set can be handed to any node. GPU objects are only created when the RHI can render, the byte
+ * bookkeeping runs either way so residency can be exercised under -nullrhi.
+ */
+
+class OCTREE_API VoxelResourcePool {
+public:
+    VoxelResourcePool(uint32 inIsoBufferSize, uint32 inVertexBufferSize);
+    ~VoxelResourcePool();
+
+    VoxelRenderHandle Acquire();
+    void Recycle(VoxelRenderHandle& handle);
+    void SubmitPendingInit();
+    void TrimPooled(uint64 bytesToFree);
+    void ReleasePooled();
+
+    uint64 GetBytesPerResourceSet() const { return bytesPerResourceSet; }
+    uint64 GetPooledBytes() const { return (uint64)pooledResources.Num() * bytesPerResourceSet; }
+    int32 GetPooledCount() const { return pooledResources.Num(); }
+
+private:
+    // Sets created since the last submit, initialised together by a single render command
+    TArray<VoxelRenderHandle> pendingInit;
+    TArray<VoxelRenderHandle> pooledResources;
+    uint32 isoBufferSize;
+    uint32 vertexBufferSize;
+    uint64 bytesPerResourceSet;
+    bool bCreateGPUResources;
+};
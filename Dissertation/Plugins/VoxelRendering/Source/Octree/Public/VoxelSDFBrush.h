@@ -0,0 +1,84 @@
+#pragma once
+#include "CoreMinimal.h"
+
+enum class EVoxelSDFPrimitive : uint8 {
+    Sphere,
+    Box,
+    Capsule,
+    Cylinder,
+    Torus,
+    HalfSpace,  // Solid below the shape's xy plane
+    Volume      // Sampled from a VoxelSDFVolume, usually built from a static mesh
+};
+
+enum class EVoxelCSGOp : uint8 {
+    Union,
+    Subtract,
+    Intersect,
+    SmoothUnion
+};
+
+/**
+ * Signed distances sampled on a regular grid over a mesh's bounds, negative inside. Built once per mesh and shared by
+ * every brush using it. The sign comes from ray parity along x, so the mesh should be closed.
+ */
+
+class OCTREE_API VoxelSDFVolume {
+public:
+    // resolution samples along the longest axis of the bounds grown by padding, the other axes keep the same spacing.
+    // Distances come from a bounding volume hierarchy over the triangles, searched within a cell of the last sample's
+    // distance. Still too slow for the game thread at high resolutions, so callers build it on a task.
+    static TSharedPtr<VoxelSDFVolume> BuildFromTriangles(TConstArrayView<FVector3f> positions, TConstArrayView<uint32> indices, int32 resolution, float padding);
+
+    // Trilinear inside the grid, outside it the clamped sample plus the distance to the grid
+    float Sample(const FVector3f& position) const;
+    const FBox3f& GetBounds() const { return bounds; }
+
+private:
+    FBox3f bounds;
+    FIntVector size;
+    FVector3f invCellSize;
+    TArray<float> distances;
+};
+
+struct VoxelSDFShape {
+    EVoxelSDFPrimitive primitive = EVoxelSDFPrimitive::Sphere;
+    // How the shape folds into the shapes before it, ignored for the first shape
+    EVoxelCSGOp op = EVoxelCSGOp::Union;
+    FVector3f position = FVector3f::ZeroVector;
+    FQuat4f rotation = FQuat4f::Identity;
+    float scale = 1.0f;
+    // Sphere: x radius. Box: half extents. Capsule and cylinder: x radius, y half height along z.
+    // Torus: x ring radius, y tube radius, the ring lies in the xy plane
+    FVector3f size = FVector3f(50.0f);
+    // SmoothUnion only, how far the blend reaches
+    float blend = 0.0f;
+    TSharedPtr<const VoxelSDFVolume> volume;
+};
+
+/**
+ * A brush built from SDF primitives folded together in order with CSG operators, in brush space and world units.
+ * Edits weigh a sample by (depth / falloff)^2 where depth is how far inside the surface it lies, capped at falloff,
+ * so the weight is zero on the surface and full from falloff deep. A lone sphere with a falloff of its radius matches
+ * the sphere brush.
+ */
+
+class OCTREE_API VoxelSDFBrush {
+public:
+    static TSharedPtr<VoxelSDFBrush> MakePrimitive(EVoxelSDFPrimitive primitive, const FVector3f& size);
+    static TSharedPtr<VoxelSDFBrush> MakeVolume(TSharedPtr<const VoxelSDFVolume> volume, float scale);
+
+    VoxelSDFBrush& Add(const VoxelSDFShape& shape) { shapes.Add(shape); return *this; }
+    bool IsEmpty() const { return shapes.Num() == 0; }
+
+    float Evaluate(const FVector3f& position) const;
+    // Distances at start + step * i for i in [0, count), four samples per step
+    void EvaluateRow(float* RESTRICT outDistances, int32 count, const FVector3f& start, const FVector3f& step) const;
+    // Box outside which the brush is positive, false when the brush is unbounded
+    bool GetBounds(FBox3f& outBounds) const;
+
+    float falloff = 50.0f;
+
+private:
+    TArray<VoxelSDFShape> shapes;
+};
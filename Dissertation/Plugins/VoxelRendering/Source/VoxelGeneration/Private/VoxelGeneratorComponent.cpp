@@ -26,7 +26,12 @@ void UVoxelGeneratorComponent::InitIsoDispatch() {
 void UVoxelGeneratorComponent::InitVoxelMesh(int inSize, int inDepth, float inScale, int inVoxelsPerAxis)
 {
     UWorld* world = GetWorld();
-    AVoxelBody::CreateVoxelMeshActor(world, inScale, inSize, inDepth, inVoxelsPerAxis, isoValueBuffer, typeValueBuffer, targetEraser, targetPlayer, pointer);
+    AVoxelBody* voxelBody = AVoxelBody::CreateVoxelMeshActor(world, inScale, inSize, inDepth, inVoxelsPerAxis, isoValueBuffer, typeValueBuffer, targetEraser, targetPlayer, pointer);
+    if (!voxelBody) return;
+    voxelBody->SetResidencyBudget(residencyBudgetMB, residencyGraceFrames);
+    voxelBody->SetLODSelector(lodSelector, screenSpaceErrorPixels, lodHysteresis);
+    if (lodHysteresisPerDepth.Num() > 0)
+        voxelBody->SetLODHysteresisPerDepth(lodHysteresisPerDepth);
 }
 
 void UVoxelGeneratorComponent::DispatchIsoBuffer(int inSize, int inDepth, float inScale, int inVoxelsPerAxis) {
@@ -64,6 +64,24 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MyCategory")
 	int surfaceLayers = 3;
 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MyCategory")
+	int residencyBudgetMB = 512; // GPU memory node meshes may hold before out of view nodes are evicted
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MyCategory")
+	int residencyGraceFrames = 120; // Frames a node may stay out of view before its resources return to the pool
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MyCategory")
+	EVoxelLODSelector lodSelector = EVoxelLODSelector::ViewRay;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MyCategory")
+	float screenSpaceErrorPixels = 8.0f; // Projected voxel size above which a node is refined
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MyCategory")
+	float lodHysteresis = 0.2f; // Fraction of the error threshold a finest node must cross before switching LOD, coarser depths get a wider band
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MyCategory")
+	TArray<float> lodHysteresisPerDepth; // Overrides the band derived from lodHysteresis for each depth given, index 0 is the root
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MyCategory")
 	UNiagaraSystem* pointer;
 
@@ -110,6 +110,21 @@ void AVoxelBody::SetBrushRadius(float radius) {
     meshComponent->SetBrushRadius(radius);
 }
 
+void AVoxelBody::SetBrushShape(EVoxelBrushShape shape) {
+    if (!meshComponent) return;
+    meshComponent->SetBrushShape(shape);
+}
+
+void AVoxelBody::SetBrushMesh(UStaticMesh* mesh, int resolution) {
+    if (!meshComponent) return;
+    meshComponent->SetBrushMesh(mesh, FMath::Clamp(resolution, 4, 128));
+}
+
+void AVoxelBody::SetBrushTool(EVoxelBrushTool tool) {
+    if (!meshComponent) return;
+    meshComponent->SetBrushTool(tool);
+}
+
 void AVoxelBody::SetBrushType(int type) {
     if (!meshComponent) return;
     meshComponent->SetPaintType(type);
@@ -120,6 +135,22 @@ void AVoxelBody::ToggleLOD() {
     meshComponent->ToggleLODState();
 }
 
+void AVoxelBody::SetResidencyBudget(int budgetMB, int graceFrames) {
+    if (!meshComponent) return;
+    meshComponent->SetResidencyBudget((uint64)FMath::Max(budgetMB, 0) * 1024 * 1024, FMath::Max(graceFrames, 0));
+}
+
+void AVoxelBody::SetLODSelector(EVoxelLODSelector selector, float errorPixels, float hysteresis) {
+    if (!meshComponent) return;
+    meshComponent->SetLODSelector(selector, FMath::Max(errorPixels, 0.01f));
+    meshComponent->SetLODHysteresis(hysteresis);
+}
+
+void AVoxelBody::SetLODHysteresisPerDepth(const TArray<float>& hysteresisPerDepth) {
+    if (!meshComponent) return;
+    meshComponent->SetLODHysteresis(hysteresisPerDepth);
+}
+
 void AVoxelBody::ToggleDeform() {
     if (!meshComponent) return;
     meshComponent->ToggleDeform();
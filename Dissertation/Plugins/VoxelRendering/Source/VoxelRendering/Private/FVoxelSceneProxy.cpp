@@ -119,27 +119,42 @@ FORCENOINLINE void FVoxelSceneProxy::GetDynamicMeshElements(
 		if (!(VisibilityMap & (1 << viewIndex))) continue;
 		if (selectedNodes.Num() == 0) continue; 
 
-		TArray<FVoxelProxyUpdateDataNode> nodeData = selectedNodes;
-		for (const FVoxelProxyUpdateDataNode node : nodeData)
+		const VoxelRenderResourceTable& resourceTable = VoxelRenderResourceTable::Get();
+		for (const TPair<uint64, FVoxelProxyUpdateDataNode>& entry : selectedNodes)
 		{
-			if ((node.vertexFactory.IsValid() && node.vertexFactory->IsInitialized()))
+			const VoxelRenderResources* resources = resourceTable.Resolve(entry.Value.renderResources);
+			if (resources && resources->vertexFactory->IsInitialized())
 			{
 				FMeshBatch& meshBatch = Collector.AllocateMesh();
-				SetMeshBatchGeneric(meshBatch, node, viewIndex);
-				SetMeshBatchElementsGeneric(meshBatch, node, viewIndex);
+				SetMeshBatchGeneric(meshBatch, resources->vertexFactory, viewIndex);
+				SetMeshBatchElementsGeneric(meshBatch, resources->vertexFactory, viewIndex);
 				Collector.AddMesh(viewIndex, meshBatch);
 			}
 		}
 	}
 }
 
-void FVoxelSceneProxy::UpdateSelectedNodes(const TArray<FVoxelProxyUpdateDataNode>& renderData) {
-	selectedNodes = renderData;
+void FVoxelSceneProxy::ApplyNodeDiff(const FVoxelProxyNodeDiff& diff) {
+	check(IsInRenderingThread());
+	if (diff.bReset)
+		selectedNodes.Reset();
+	for (uint64 key : diff.removed)
+		selectedNodes.Remove(key);
+	for (const FVoxelProxyUpdateDataNode& node : diff.added)
+		selectedNodes.Add(node.nodeKey, node);
+	for (const FVoxelProxyUpdateDataNode& node : diff.changed)
+		selectedNodes.Add(node.nodeKey, node);
 }
 
-void FVoxelSceneProxy::SetMeshBatchGeneric(FMeshBatch& meshBatch, const FVoxelProxyUpdateDataNode& node, int32 viewIndex, bool bWireframe) const {
-	check(node.vertexFactory);
-	meshBatch.VertexFactory = node.vertexFactory.Get();
+TArray<FVoxelProxyUpdateDataNode> FVoxelSceneProxy::GetVisibleNodes() const {
+	TArray<FVoxelProxyUpdateDataNode> nodes;
+	selectedNodes.GenerateValueArray(nodes);
+	return nodes;
+}
+
+void FVoxelSceneProxy::SetMeshBatchGeneric(FMeshBatch& meshBatch, FVoxelVertexFactory* vertexFactory, int32 viewIndex, bool bWireframe) const {
+	check(vertexFactory);
+	meshBatch.VertexFactory = vertexFactory;
 	meshBatch.ReverseCulling = IsLocalToWorldDeterminantNegative();
 	meshBatch.Type = PT_TriangleList;
 	meshBatch.DepthPriorityGroup = SDPG_World;
@@ -161,10 +176,10 @@ void FVoxelSceneProxy::SetMeshBatchRenderProxy(FMeshBatch& meshBatch) const {
 	meshBatch.MaterialRenderProxy = renderProxy;
 }
 
-void FVoxelSceneProxy::SetMeshBatchElementsGeneric(FMeshBatch& meshBatch, const FVoxelProxyUpdateDataNode& node, int32 viewIndex) const {
-	FVoxelIndexBuffer* indexBuffer = node.vertexFactory->GetIndexBuffer();
+void FVoxelSceneProxy::SetMeshBatchElementsGeneric(FMeshBatch& meshBatch, FVoxelVertexFactory* vertexFactory, int32 viewIndex) const {
+	FVoxelIndexBuffer* indexBuffer = vertexFactory->GetIndexBuffer();
 	uint32 numTriangles = (indexBuffer->GetVisibleIndiceCount()) / 3;
-	uint32 maxVertexIndex = node.vertexFactory->GetVertexBuffer()->GetVisibleVerticiesCount() - 1;
+	uint32 maxVertexIndex = vertexFactory->GetVertexBuffer()->GetVisibleVerticiesCount() - 1;
 
 	check(indexBuffer);
 	FMeshBatchElement& batchElement = meshBatch.Elements[0];
@@ -0,0 +1,33 @@
+#include "Misc/AutomationTest.h"
+#include "VoxelMeshComponent.h"
+#include "Engine/World.h"
+#include "UObject/UObjectIterator.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVoxelTickAllocationTest, "VoxelRendering.Mesh.TickAllocationFree",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::EngineFilter)
+
+// Runs against every voxel body of a game or play in editor world, since the update needs a scene proxy and a player
+// view. Once warm, an update that reselects the cut, remeshes and dispatches must not touch the heap on the game thread.
+bool FVoxelTickAllocationTest::RunTest(const FString& Parameters) {
+    int32 checked = 0;
+    for (TObjectIterator<UVoxelMeshComponent> it; it; ++it) {
+        UWorld* world = it->GetWorld();
+        if (!world || !world->IsGameWorld()) continue;
+
+        UVoxelMeshComponent::TickAllocationCheck check;
+        if (!it->CheckTickAllocations(check)) continue;
+        checked++;
+        AddInfo(FString::Printf(TEXT("%s: %d of %d forced nodes remeshed and dispatched with %u heap allocations"),
+            *it->GetOwner()->GetName(), check.remeshed, check.forcedNodes, check.allocations));
+        TestTrue(TEXT("A forced node was remeshed, so something was dispatched"), check.remeshed > 0);
+        TestTrue(FString::Printf(TEXT("The update made no heap allocations (made %u)"), check.allocations), check.allocations == 0);
+    }
+
+    if (checked == 0)
+        AddError(TEXT("No voxel body with a scene proxy in a game world, run this in play in editor or a game client"));
+    return !HasAnyErrors();
+}
+
+#endif
@@ -0,0 +1,138 @@
+#include "VoxelFrameArena.h"
+#include "HAL/MemoryBase.h"
+
+static thread_local FVoxelFrameArena* CurrentFrameArena = nullptr;
+
+FVoxelFrameArena::~FVoxelFrameArena() {
+    for (void* overflow : overflowBlocks)
+        FMemory::Free(overflow);
+    if (block)
+        FMemory::Free(block);
+}
+
+void* FVoxelFrameArena::Allocate(SIZE_T size, uint32 alignment) {
+    alignment = FMath::Max(alignment, MinAlignment);
+    if (block) {
+        SIZE_T alignedOffset = Align(offset, alignment);
+        if (alignedOffset + size <= capacity) {
+            offset = alignedOffset + size;
+            return block + alignedOffset;
+        }
+    }
+
+    void* overflow = FMemory::Malloc(size, alignment);
+    overflowBlocks.Add(overflow);
+    overflowBytes += size + alignment;
+    heapAllocationCount++;
+    return overflow;
+}
+
+void FVoxelFrameArena::Reset() {
+    if (overflowBlocks.Num() > 0) {
+        SIZE_T peak = offset + overflowBytes;
+        for (void* overflow : overflowBlocks)
+            FMemory::Free(overflow);
+        overflowBlocks.Reset();
+
+        if (block)
+            FMemory::Free(block);
+        capacity = FMath::Max(FMath::RoundUpToPowerOfTwo64(peak), (uint64)MinBlockSize);
+        block = (uint8*)FMemory::Malloc(capacity, PLATFORM_CACHE_LINE_SIZE);
+        heapAllocationCount++;
+    }
+    offset = 0;
+    overflowBytes = 0;
+}
+
+FVoxelFrameArena::FScope::FScope(FVoxelFrameArena& arena) : previous(CurrentFrameArena) {
+    arena.Reset();
+    CurrentFrameArena = &arena;
+}
+
+FVoxelFrameArena::FScope::~FScope() {
+    CurrentFrameArena = previous;
+}
+
+FVoxelFrameArena& FVoxelFrameArena::GetCurrent() {
+    check(CurrentFrameArena);
+    return *CurrentFrameArena;
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+static thread_local uint32 HeapAllocationScopeDepth = 0;
+static thread_local uint32 HeapAllocationCount = 0;
+
+namespace {
+    // Forwards everything to the allocator it wraps, counting allocations made on threads with a scope open
+    class FVoxelCountingMalloc final : public FMalloc {
+    public:
+        void SetInner(FMalloc* inInner) { inner = inInner; }
+        FMalloc* GetInner() const { return inner; }
+
+        virtual void* Malloc(SIZE_T count, uint32 alignment) override { Count(); return inner->Malloc(count, alignment); }
+        virtual void* TryMalloc(SIZE_T count, uint32 alignment) override { Count(); return inner->TryMalloc(count, alignment); }
+        virtual void* Realloc(void* original, SIZE_T count, uint32 alignment) override {
+            if (count > 0) Count();
+            return inner->Realloc(original, count, alignment);
+        }
+        virtual void* TryRealloc(void* original, SIZE_T count, uint32 alignment) override {
+            if (count > 0) Count();
+            return inner->TryRealloc(original, count, alignment);
+        }
+        virtual void Free(void* original) override { inner->Free(original); }
+
+        virtual SIZE_T QuantizeSize(SIZE_T count, uint32 alignment) override { return inner->QuantizeSize(count, alignment); }
+        virtual bool GetAllocationSize(void* original, SIZE_T& outSize) override { return inner->GetAllocationSize(original, outSize); }
+        virtual void Trim(bool bTrimThreadCaches) override { inner->Trim(bTrimThreadCaches); }
+        virtual void SetupTLSCachesOnCurrentThread() override { inner->SetupTLSCachesOnCurrentThread(); }
+        virtual void MarkTLSCachesAsUsedOnCurrentThread() override { inner->MarkTLSCachesAsUsedOnCurrentThread(); }
+        virtual void MarkTLSCachesAsUnusedOnCurrentThread() override { inner->MarkTLSCachesAsUnusedOnCurrentThread(); }
+        virtual void ClearAndDisableTLSCachesOnCurrentThread() override { inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+        virtual void InitializeStatsMetadata() override { inner->InitializeStatsMetadata(); }
+        virtual void UpdateStats() override { inner->UpdateStats(); }
+        virtual void GetAllocatorStats(FGenericMemoryStats& outStats) override { inner->GetAllocatorStats(outStats); }
+        virtual void DumpAllocatorStats(FOutputDevice& ar) override { inner->DumpAllocatorStats(ar); }
+        virtual bool IsInternallyThreadSafe() const override { return inner->IsInternallyThreadSafe(); }
+        virtual bool ValidateHeap() override { return inner->ValidateHeap(); }
+        virtual const TCHAR* GetDescriptiveName() override { return inner->GetDescriptiveName(); }
+
+    private:
+        static void Count() {
+            if (HeapAllocationScopeDepth > 0)
+                HeapAllocationCount++;
+        }
+
+        FMalloc* inner = nullptr;
+    };
+
+    FVoxelCountingMalloc CountingMalloc;
+    bool bCountingMallocInstalled = false;
+}
+
+// Only the game thread opens scopes, so the proxy is installed and removed by one thread. Allocations other threads make
+// through it in the meantime are forwarded uncounted, and frees of memory allocated on either side of the swap reach the
+// same allocator.
+FVoxelHeapAllocationScope::FVoxelHeapAllocationScope() {
+    check(IsInGameThread());
+    if (HeapAllocationScopeDepth++ == 0 && !bCountingMallocInstalled) {
+        CountingMalloc.SetInner(GMalloc);
+        FPlatformMisc::MemoryBarrier();
+        GMalloc = &CountingMalloc;
+        bCountingMallocInstalled = true;
+    }
+    startCount = HeapAllocationCount;
+}
+
+// Left in place if something wrapped GMalloc again while the scope was open, rather than dropping that wrapper, and
+// the next scope counts through it as it is
+FVoxelHeapAllocationScope::~FVoxelHeapAllocationScope() {
+    if (--HeapAllocationScopeDepth == 0 && GMalloc == &CountingMalloc) {
+        GMalloc = CountingMalloc.GetInner();
+        bCountingMallocInstalled = false;
+    }
+}
+
+uint32 FVoxelHeapAllocationScope::GetAllocationCount() const {
+    return HeapAllocationCount - startCount;
+}
+#endif
@@ -1,4 +1,5 @@
 #include "VoxelMeshComponent.h"
+#include "AVoxelBody.h"
 #include "FVoxelVertexFactory.h"
 #include "FVoxelSceneProxy.h"
 #include "FVoxelVertexFactoryShaderParameters.h"
@@ -7,8 +8,227 @@
 #include "VoxelWorldSubsystem.h"
 #include "RenderData.h"
 #include "PhysicsEngine/BodySetup.h"
+#include "HAL/IConsoleManager.h"
+#include "Engine/GameViewportClient.h"
+#include "Camera/PlayerCameraManager.h"
+#include "UObject/UObjectIterator.h"
+#include "Engine/StaticMesh.h"
+#include "StaticMeshResources.h"
+#include "DrawDebugHelpers.h"
+
+// Kept as a reference to benchmark the linear VoxelLODSelector balancing against, see VoxelLODSelector::BalanceLegacy
+static TAutoConsoleVariable<int32> CVarLegacyLODBalance(
+    TEXT("voxel.LegacyLODBalance"), 0,
+    TEXT("Use the original quadratic LOD balancing instead of the ripple balancing in VoxelLODSelector."));
+
+static TAutoConsoleVariable<int32> CVarAsyncLOD(
+    TEXT("voxel.AsyncLOD"), 1,
+    TEXT("Select and balance the LOD cut on a task from a topology snapshot and publish it next frame. 0 selects on the game thread."));
+
+static TAutoConsoleVariable<float> CVarLODCacheMoveFraction(
+    TEXT("voxel.LODCacheMoveFraction"), 0.25f,
+    TEXT("Fraction of the finest visible node size the camera may move in octree local space before the LOD cut is reselected. 0 reselects every frame."));
+
+static TAutoConsoleVariable<float> CVarLODCacheAngle(
+    TEXT("voxel.LODCacheAngle"), 2.0f,
+    TEXT("Degrees the view direction may turn before the LOD cut is reselected, only used when the view ray selector checks the forward direction."));
+
+static TAutoConsoleVariable<int32> CVarLogRemesh(
+    TEXT("voxel.LogRemesh"), 0,
+    TEXT("Log how many visible nodes were remeshed on every frame that remeshes any."));
+
+static TAutoConsoleVariable<int32> CVarRemeshBudgetNodes(
+    TEXT("voxel.RemeshBudgetNodes"), 64,
+    TEXT("Most visible nodes remeshed per frame, the rest stay queued and keep drawing their previous mesh. 0 removes the cap."));
+
+static TAutoConsoleVariable<float> CVarRemeshBudgetMs(
+    TEXT("voxel.RemeshBudgetMs"), 2.0f,
+    TEXT("Game thread milliseconds spent gathering remesh work per frame before the remaining nodes wait for the next frame. 0 removes the cap."));
+
+static TAutoConsoleVariable<int32> CVarMaxEditsPerFrame(
+    TEXT("voxel.MaxEditsPerFrame"), 4096,
+    TEXT("Most queued edit commands applied in one frame, the rest wait in the queue for the next."));
+
+static TAutoConsoleVariable<float> CVarStrokeStepRate(
+    TEXT("voxel.StrokeStepRate"), 60.0f,
+    TEXT("Steps per second at which mining and eraser strokes issue capsule edits, independent of framerate. 0 issues one every frame."));
+
+// Brush radii a stroke may move between two steps before it is broken and restarted at the new position
+static constexpr float MaxStrokeJumpRadii = 8.0f;
+
+// Hysteresis band growth per depth above the finest, and the widest band any depth may have
+static constexpr float LODHysteresisGrowthPerDepth = 0.25f;
+static constexpr float MaxLODHysteresis = 0.9f;
+
+#if WITH_DEV_AUTOMATION_TESTS
+// Surface nodes the tick allocation check forces stale, and the runs it makes before the one it counts
+static constexpr int32 CheckTickAllocationsNodes = 8;
+static constexpr int32 CheckTickAllocationsWarmUps = 2;
+#endif
+
+// Pair with voxel.ValidateDeltaSnapshots to check that uploads in flight never see a torn snapshot
+static TAutoConsoleVariable<int32> CVarDeltaUploadStress(
+    TEXT("voxel.DeltaUploadStress"), 0,
+    TEXT("Apply this many random brush edits every tick, so the delta arrays change while earlier uploads are still queued."));
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkLODCommand(
+    TEXT("voxel.BenchmarkLOD"),
+    TEXT("Log the game thread time of serial and task based LOD selection at every tree depth. Argument: iterations per depth (default 16)."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world) {
+        int32 iterations = args.Num() > 0 ? FMath::Max(FCString::Atoi(*args[0]), 1) : 16;
+        for (TObjectIterator<UVoxelMeshComponent> it; it; ++it) {
+            if (it->GetWorld() == world)
+                it->BenchmarkLODSelection(iterations);
+        }
+    }));
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkBuildCommand(
+    TEXT("voxel.BenchmarkBuild"),
+    TEXT("Log the cost of building the octree's subtrees on 1, 2, 4 ... workers up to every worker, and the speedup over one. Argument: iterations (default 4)."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world) {
+        int32 iterations = args.Num() > 0 ? FMath::Max(FCString::Atoi(*args[0]), 1) : 4;
+        for (TObjectIterator<UVoxelMeshComponent> it; it; ++it) {
+            if (it->GetWorld() == world)
+                it->BenchmarkBuild(iterations);
+        }
+    }));
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkBrushCommand(
+    TEXT("voxel.BenchmarkBrush"),
+    TEXT("Log the cost of one sphere and one capsule brush for radii 10 to 1000 through the reference, SIMD and parallel SIMD kernels. Argument: iterations per radius (default 8)."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world) {
+        int32 iterations = args.Num() > 0 ? FMath::Max(FCString::Atoi(*args[0]), 1) : 8;
+        static const float radii[] = { 10.0f, 25.0f, 50.0f, 100.0f, 250.0f, 500.0f, 1000.0f };
+        for (TObjectIterator<UVoxelMeshComponent> it; it; ++it) {
+            if (it->GetWorld() == world)
+                it->BenchmarkBrush(radii, iterations);
+        }
+    }));
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkSmoothCommand(
+    TEXT("voxel.BenchmarkSmooth"),
+    TEXT("Log the cost of smoothing spheres of radius 25 to 200 through the naive, separable and parallel separable filters. Argument: iterations per radius (default 4)."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world) {
+        int32 iterations = args.Num() > 0 ? FMath::Max(FCString::Atoi(*args[0]), 1) : 4;
+        static const float radii[] = { 25.0f, 50.0f, 100.0f, 200.0f };
+        for (TObjectIterator<UVoxelMeshComponent> it; it; ++it) {
+            if (it->GetWorld() == world)
+                it->BenchmarkSmooth(radii, iterations);
+        }
+    }));
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkConnectivityCommand(
+    TEXT("voxel.BenchmarkConnectivity"),
+    TEXT("Log the cost of updating solid connectivity after carving spheres of radius 25 to 200 into the surface, against relabelling the whole grid. Argument: iterations per radius (default 4)."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world) {
+        int32 iterations = args.Num() > 0 ? FMath::Max(FCString::Atoi(*args[0]), 1) : 4;
+        static const float radii[] = { 25.0f, 50.0f, 100.0f, 200.0f };
+        for (TObjectIterator<UVoxelMeshComponent> it; it; ++it) {
+            if (it->GetWorld() == world)
+                it->BenchmarkConnectivity(radii, iterations);
+        }
+    }));
+
+static FAutoConsoleCommandWithWorldAndArgs BrushToolCommand(
+    TEXT("voxel.BrushTool"),
+    TEXT("Set what the left mouse button does: Sculpt, Smooth or Flatten."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world) {
+        int64 tool = args.Num() > 0 ? StaticEnum<EVoxelBrushTool>()->GetValueByNameString(args[0]) : INDEX_NONE;
+        if (tool == INDEX_NONE) {
+            UE_LOG(LogTemp, Warning, TEXT("voxel.BrushTool: unknown tool"));
+            return;
+        }
+        for (TObjectIterator<UVoxelMeshComponent> it; it; ++it) {
+            if (it->GetWorld() == world)
+                it->SetBrushTool((EVoxelBrushTool)tool);
+        }
+    }));
+
+static FAutoConsoleCommandWithWorldAndArgs BrushShapeCommand(
+    TEXT("voxel.BrushShape"),
+    TEXT("Set the editing brush shape: Sphere, Box, Capsule, Cylinder, Torus or Mesh. Mesh uses the last voxel.BrushMesh."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world) {
+        int64 shape = args.Num() > 0 ? StaticEnum<EVoxelBrushShape>()->GetValueByNameString(args[0]) : INDEX_NONE;
+        if (shape == INDEX_NONE) {
+            UE_LOG(LogTemp, Warning, TEXT("voxel.BrushShape: unknown shape"));
+            return;
+        }
+        for (TObjectIterator<UVoxelMeshComponent> it; it; ++it) {
+            if (it->GetWorld() == world)
+                it->SetBrushShape((EVoxelBrushShape)shape);
+        }
+    }));
+
+static FAutoConsoleCommandWithWorldAndArgs BrushMeshCommand(
+    TEXT("voxel.BrushMesh"),
+    TEXT("Use a static mesh as the editing brush. Arguments: mesh object path, SDF samples along its longest axis (default 32)."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world) {
+        UStaticMesh* mesh = args.Num() > 0 ? LoadObject<UStaticMesh>(nullptr, *args[0]) : nullptr;
+        if (!mesh) {
+            UE_LOG(LogTemp, Warning, TEXT("voxel.BrushMesh: could not load a static mesh"));
+            return;
+        }
+        int32 resolution = args.Num() > 1 ? FMath::Clamp(FCString::Atoi(*args[1]), 4, 128) : 32;
+        for (TObjectIterator<UVoxelMeshComponent> it; it; ++it) {
+            if (it->GetWorld() == world)
+                it->SetBrushMesh(mesh, resolution);
+        }
+    }));
+
+DECLARE_STATS_GROUP(TEXT("VoxelMesh"), STATGROUP_VoxelMesh, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("LOD Selection"), STAT_VoxelMesh_LODSelect, STATGROUP_VoxelMesh);
+DECLARE_CYCLE_STAT(TEXT("LOD Balance"), STAT_VoxelMesh_LODBalance, STATGROUP_VoxelMesh);
+DECLARE_CYCLE_STAT(TEXT("LOD Game Thread"), STAT_VoxelMesh_LODGameThread, STATGROUP_VoxelMesh);
+DECLARE_CYCLE_STAT(TEXT("LOD Task Wait"), STAT_VoxelMesh_LODTaskWait, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("LOD Cut Reselected"), STAT_VoxelMesh_LODCutRebuilds, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Visible Nodes"), STAT_VoxelMesh_VisibleNodes, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Nodes Remeshed"), STAT_VoxelMesh_RemeshedNodes, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Remesh Queue Length"), STAT_VoxelMesh_RemeshQueued, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Surface Nodes"), STAT_VoxelMesh_SurfaceNodes, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Deformation Dispatches Skipped"), STAT_VoxelMesh_DeformationSkipped, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("MarchingCubes Dispatches Skipped"), STAT_VoxelMesh_MarchingCubesSkipped, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Transvoxel Dispatches Skipped"), STAT_VoxelMesh_TransvoxelSkipped, STATGROUP_VoxelMesh);
+DECLARE_MEMORY_STAT(TEXT("Frame Arena Used"), STAT_VoxelMesh_ArenaUsed, STATGROUP_VoxelMesh);
+DECLARE_MEMORY_STAT(TEXT("Frame Arena Capacity"), STAT_VoxelMesh_ArenaCapacity, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frame Arena Heap Allocations"), STAT_VoxelMesh_ArenaHeapAllocations, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Proxy Nodes Added"), STAT_VoxelMesh_ProxyAdded, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Proxy Nodes Removed"), STAT_VoxelMesh_ProxyRemoved, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Proxy Nodes Changed"), STAT_VoxelMesh_ProxyChanged, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Selected Nodes Depth 0"), STAT_VoxelMesh_SelectedDepth0, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Selected Nodes Depth 1"), STAT_VoxelMesh_SelectedDepth1, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Selected Nodes Depth 2"), STAT_VoxelMesh_SelectedDepth2, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Selected Nodes Depth 3"), STAT_VoxelMesh_SelectedDepth3, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Selected Nodes Depth 4"), STAT_VoxelMesh_SelectedDepth4, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Selected Nodes Depth 5"), STAT_VoxelMesh_SelectedDepth5, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Selected Nodes Depth 6"), STAT_VoxelMesh_SelectedDepth6, STATGROUP_VoxelMesh);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Selected Nodes Depth 7+"), STAT_VoxelMesh_SelectedDepth7, STATGROUP_VoxelMesh);
+
+// Screen importance is doubled for nodes that have never been meshed, the coarser mesh they replace is still drawn but
+// at the wrong LOD. Recently edited nodes get a bonus that decays with every later edit so brush feedback comes first.
+static constexpr float RemeshNewlyVisibleWeight = 2.0f;
+static constexpr float RemeshEditWeight = 1.0f;
+
+// Enough for the diff or dispatch of the last few frames still queued on the render thread, and for the published,
+// running and next LOD selection
+static constexpr int32 MaxPooledRenderData = 4;
+
+// Copy on write as in VoxelDeltaUploader: a pooled object is refilled only when the pool holds the last reference to
+// it, otherwise a render command or selection may still be reading it and a fresh one is allocated instead
+template<typename T, typename... ArgTypes>
+static TSharedPtr<T> AcquirePooled(TArray<TSharedPtr<T>>& pool, ArgTypes&&... args) {
+    for (TSharedPtr<T>& item : pool) {
+        if (item.GetSharedReferenceCount() == 1)
+            return item;
+    }
 
-UVoxelMeshComponent::UVoxelMeshComponent() : voxelBodySetup(nullptr), viewDistance(10.0f), rotatePlanet(true), debugNodes(false), usePlayerLOD(true), deform(true)
+    TSharedPtr<T> item = MakeShared<T>(Forward<ArgTypes>(args)...);
+    if (pool.Num() < MaxPooledRenderData)
+        pool.Add(item);
+    return item;
+}
+
+UVoxelMeshComponent::UVoxelMeshComponent() : voxelBodySetup(nullptr), viewDistance(10.0f), lodSelector(EVoxelLODSelector::ViewRay), screenSpaceErrorThreshold(8.0f),
+    cachedFinestNodeSize(0.0f), cachedEditVersion(0), bLODCutValid(false), lodParamsVersion(0), lodTaskEditVersion(0), lodTaskParamsVersion(0), bProxyResync(true), rotatePlanet(true), debugNodes(false), usePlayerLOD(true), deform(true)
 {
     PrimaryComponentTick.bCanEverTick = true;
     bUseAsOccluder = false;
@@ -38,6 +258,12 @@ void UVoxelMeshComponent::InitVoxelMesh(
     vfxSystem = inVfxSystem;
     AActor* owner = GetOwner();
     tree = new Octree(owner, isoLevel, scale, voxelsPerAxis, depth, inBufferSizePerAxis, in_isoValueBuffer, in_typeValueBuffer);
+    lodHysteresisPerDepth.SetNum(depth + 1);
+    SetLODHysteresis(0.2f);
+    lodPublishedResult.Reset();
+    selectedNodesPerDepth.Init(0, depth + 1);
+    cachedVisibleNodes.Reset();
+    InvalidateLODCut();
 }
 
 void UVoxelMeshComponent::OnRegister()
@@ -49,6 +275,8 @@ void UVoxelMeshComponent::BeginPlay() {
     Super::BeginPlay();
 }
 void UVoxelMeshComponent::BeginDestroy() {
+    if (lodTask.IsValid())
+        lodTask.Wait();
     delete tree;
     Super::BeginDestroy();
 }
@@ -64,6 +292,8 @@ void UVoxelMeshComponent::SetMaterial(int32 ElementIndex, UMaterialInterface* In
 FPrimitiveSceneProxy* UVoxelMeshComponent::CreateSceneProxy()
 {
     sceneProxy = new FVoxelSceneProxy(this);
+    proxyNodeStates.Reset();
+    bProxyResync = true;
     return sceneProxy;
 }
 
@@ -82,6 +312,7 @@ void UVoxelMeshComponent::TickComponent(float DeltaTime, ELevelTick TickType, FA
     Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
     if (!tree) return;
+    FinishMeshVolumeBuild();
     TraverseAndDraw();
     InvokeVoxelRenderPasses();
     CheckRotation(DeltaTime);
@@ -114,7 +345,10 @@ void UVoxelMeshComponent::CheckVoxelMining() {
     bool leftMouseDown = playerController->IsInputKeyDown(EKeys::LeftMouseButton);
     bool keyDown = leftMouseDown || playerController->IsInputKeyDown(EKeys::RightMouseButton);
 
-    if (!keyDown || playerController->IsInputKeyDown(EKeys::LeftShift)) return;
+    if (!keyDown || playerController->IsInputKeyDown(EKeys::LeftShift)) {
+        miningStroke.End();
+        return;
+    }
 
     FVector worldLoc, worldDir;
     if (playerController->DeprojectMousePositionToWorld(worldLoc, worldDir))
@@ -126,12 +360,15 @@ void UVoxelMeshComponent::CheckVoxelMining() {
         if (tree->RaycastToVoxelBody(hit, start, end))
         {
             FVector position = hit.Location;
-            if (deform) {
-                bool terrainEdit = leftMouseDown ?
-                    tree->ApplyDeformationAtPosition(position, palette->GetBrushRadius(), palette->GetBrushPower()) :
-                    tree->ApplyDeformationAtPosition(position, palette->GetBrushRadius(), palette->GetBrushPower(), palette->GetPaintType(), true, false);
+            EVoxelBrushTool tool = palette->GetBrushTool();
+            if (deform && tool != EVoxelBrushTool::Sculpt && leftMouseDown) {
+                AdvanceStroke(miningStroke, MakeBrushEdit(tool == EVoxelBrushTool::Smooth ? EVoxelEditOp::Smooth : EVoxelEditOp::Flatten, position));
+            }
+            else if (deform) {
+                AdvanceStroke(miningStroke, MakeBrushEdit(leftMouseDown ? EVoxelEditOp::Subtract : EVoxelEditOp::Add, position));
 
-                if (vfxSystem && terrainEdit && leftMouseDown) {
+                // The ray hit the body, so the queued edit lands there when this frame's batch is applied
+                if (vfxSystem && leftMouseDown) {
                     UNiagaraFunctionLibrary::SpawnSystemAtLocation(
                         GetWorld(),
                         vfxSystem,
@@ -144,42 +381,95 @@ void UVoxelMeshComponent::CheckVoxelMining() {
                 }
             }
             else {
-                tree->ApplyDeformationAtPosition(position, palette->GetBrushRadius(), palette->GetBrushPower(), palette->GetPaintType(), true, true);
+                AdvanceStroke(miningStroke, MakeBrushEdit(EVoxelEditOp::Paint, position));
             }
+            return;
         }
     }
+    miningStroke.End();
 }
 
-void ResetVisibleNodes(OctreeNode* node) {
-    if (!node) return;
-    node->SetVisible(false);
+// Strokes are tracked in the tree's local space so the planet turning under a brush does not bend them, each segment
+// goes back to world space with the current transform. A segment covering several steps is cut into one piece per
+// step, each with the brush's own influence, so a moving brush leaves the same amount per unit of path whatever the
+// framerate. A still brush's pieces are identical and coalesce into one carrying every step's influence.
+void UVoxelMeshComponent::AdvanceStroke(VoxelEditStroke& stroke, VoxelEditCommand command) {
+    const FTransform& treeTransform = tree->GetParentActor()->GetTransform();
+    FVector localPosition = treeTransform.InverseTransformPosition(command.position);
+    // A mouse ray jumping across the horizon would otherwise sweep a tunnel through the body between the two hits
+    if (stroke.IsActive() && FVector::DistSquared(stroke.GetSegmentStart(), localPosition) > FMath::Square(command.radius * MaxStrokeJumpRadii))
+        stroke.End();
+
+    float stepRate = CVarStrokeStepRate.GetValueOnGameThread();
+    FVector sweepStart;
+    int32 steps;
+    if (!stroke.Advance(command.op, localPosition, GetWorld()->GetDeltaSeconds(),
+        stepRate > 0.0f ? 1.0f / stepRate : 0.0f, sweepStart, steps))
+        return;
 
-    for (int i = 0; i < 8; ++i)
-        ResetVisibleNodes(node->children[i]);
+    // Shape brushes and filters are stamped at the end of every step, only the sphere is swept
+    bool bSwept = command.shape == EVoxelEditShape::Sphere && !command.IsFilter();
+    for (int32 step = 0; step < steps; step++) {
+        VoxelEditCommand stepCommand = command;
+        stepCommand.position = treeTransform.TransformPosition(FMath::Lerp(sweepStart, localPosition, (step + 1) / (float)steps));
+        if (bSwept) {
+            stepCommand.shape = EVoxelEditShape::Capsule;
+            stepCommand.sweepStart = treeTransform.TransformPosition(FMath::Lerp(sweepStart, localPosition, step / (float)steps));
+        }
+        EnqueueEdit(stepCommand);
+    }
 }
 
 void UVoxelMeshComponent::SetRenderDataLOD() 
 {
-    TArray<OctreeNode*> visibleNodes;
+    VoxelLODView view;
+    if (!BuildLODView(view)) return;
+
+    bool bReselect = UpdateLODCut(view);
+
+    const TArray<OctreeNode*>& visibleNodes = cachedVisibleNodes;
+    tree->UpdateResidency(visibleNodes);
+
+    TVoxelFrameArray<FVoxelComputeUpdateNodeData> computeUpdateDataNodes;
+    TVoxelFrameArray<FVoxelTransVoxelNodeData> computeTransvoxelData;
+    TVoxelFrameArray<OctreeNode*> surfaceNodes;
+
+    // Nodes entirely inside or outside the body produce no triangles, they are only deformed when a
+    // transition cell of a surface node samples them. Nodes whose mesh is still current are not dispatched at all.
+    TVoxelFrameSet<OctreeNode*> deformNodes;
+    TVoxelFrameSet<OctreeNode*> remeshNodes;
+    uint32 transvoxelSkipped = 0;
 
-    ResetVisibleNodes(tree->GetRoot());
-    GetVisibleNodes(visibleNodes, tree->GetRoot());
-    BalanceVisibleNodes(visibleNodes);
+    remeshQueue.Reset();
+    for (OctreeNode* node : visibleNodes) {
+        if (node->ClassifyNode() == EVoxelNodeClass::Surface)
+            surfaceNodes.Add(node);
+        if (!tree->IsNodeMeshCurrent(node->GetIndex()))
+            remeshQueue.Add({ node, GetRemeshPriority(node, view) });
+    }
+
+    auto HigherPriority = [](const RemeshJob& a, const RemeshJob& b) { return a.priority > b.priority; };
+    remeshQueue.Heapify(HigherPriority);
 
-    TArray<FVoxelComputeUpdateNodeData> computeUpdateDataNodes;
-    TArray<FVoxelProxyUpdateDataNode> proxyNodes;
-    TArray<FVoxelTransVoxelNodeData> computeTransvoxelData;
+    // At least one node is always remeshed so a tiny budget still makes progress
+    int32 nodeBudget = CVarRemeshBudgetNodes.GetValueOnGameThread();
+    double timeBudget = CVarRemeshBudgetMs.GetValueOnGameThread() / 1000.0;
+    double startTime = FPlatformTime::Seconds();
 
-    for (OctreeNode* node : visibleNodes)
+    while (remeshQueue.Num() > 0)
     {
-        uint8 nodeDepth = node->GetDepth();
-        FVoxelProxyUpdateDataNode proxyNode(nodeDepth, node);
-        FVoxelComputeUpdateNodeData computeUpdateDataNode(node);
+        if (remeshNodes.Num() > 0) {
+            if (nodeBudget > 0 && remeshNodes.Num() >= nodeBudget) break;
+            if (timeBudget > 0.0 && FPlatformTime::Seconds() - startTime >= timeBudget) break;
+        }
 
-        if (proxyNode.BuildDataCache())
-            proxyNodes.Emplace(proxyNode);
-        if (computeUpdateDataNode.BuildDataCache())
-            computeUpdateDataNodes.Emplace(computeUpdateDataNode);
+        RemeshJob job;
+        remeshQueue.HeapPop(job, HigherPriority, EAllowShrinking::No);
+        OctreeNode* node = job.node;
+        bool bSurface = node->ClassifyNode() == EVoxelNodeClass::Surface;
+        remeshNodes.Add(node);
+        if (bSurface)
+            deformNodes.Add(node);
 
         for (int i = 0; i < 3; i++) {
             TransitionCell* cell = nullptr;
@@ -189,220 +479,685 @@ void UVoxelMeshComponent::SetRenderDataLOD()
                     UE_LOG(LogTemp, Warning, TEXT("Debug: cell has non-3 index: %d"), cell->adjacentNodeIndex);
                     continue;
                 }
+
+                bool bCellSurface = bSurface;
+                for (int j = 0; j < 4; j++)
+                    bCellSurface |= cell->adjacentNodes[j] && cell->adjacentNodes[j]->ClassifyNode() == EVoxelNodeClass::Surface;
+                if (!bCellSurface) {
+                    transvoxelSkipped++;
+                    continue;
+                }
+
+                deformNodes.Add(node);
+                for (int j = 0; j < 4; j++)
+                    deformNodes.Add(cell->adjacentNodes[j]);
+
                 FVoxelTransVoxelNodeData nodeData(cell, node, i);
                 nodeData.BuildDataCache();
                 computeTransvoxelData.Add(nodeData);
             }
-            else {
+            else if (bSurface) {
                 FVoxelTransVoxelNodeData nodeData(node, i);
                 nodeData.BuildDataCache();
                 computeTransvoxelData.Add(nodeData);
             }
+            else transvoxelSkipped++;
         }
     }
-    InvokeVoxelRenderer(computeUpdateDataNodes, computeTransvoxelData, proxyNodes);
-}
 
-void UVoxelMeshComponent::SetNodeVisible(TArray<OctreeNode*>& nodes, OctreeNode* node) {
-    node->SetVisible(true);
-    nodes.Add(node);
-}
-
-void UVoxelMeshComponent::SetChildrenVisible(TArray<OctreeNode*>& pushStack, OctreeNode* node, int currentDepth, int targetDepth) {
-    if (!node) return;
+    for (OctreeNode* node : deformNodes) {
+        int32 index = node->GetIndex();
+        FVoxelComputeUpdateNodeData computeUpdateDataNode(node);
+        computeUpdateDataNode.applyDeformation = !tree->IsNodeDeformCurrent(index);
+        computeUpdateDataNode.generateMesh = remeshNodes.Contains(node) && node->IsVisible() && node->ClassifyNode() == EVoxelNodeClass::Surface;
+        if (!computeUpdateDataNode.applyDeformation && !computeUpdateDataNode.generateMesh) continue;
 
-    if (currentDepth >= targetDepth || node->IsLeaf()) {
-        pushStack.Add(node);
-        node->SetVisible(true);
-        return;
+        if (computeUpdateDataNode.BuildDataCache())
+            computeUpdateDataNodes.Emplace(computeUpdateDataNode);
+        tree->MarkNodeDeformed(index);
     }
 
-    for (int l = 0; l < 8; l++)
-        SetChildrenVisible(pushStack, node->children[l], (currentDepth + 1), targetDepth);
-}
+    for (OctreeNode* node : remeshNodes)
+        tree->MarkNodeMeshed(node->GetIndex());
 
-bool AreAdjacent(OctreeNode* a, OctreeNode* b, const FIntVector& direction) {
-    const float epsilon = 0.0001f;
-    const AABB& boundsA = a->GetBounds();
-    const AABB& boundsB = b->GetBounds();
-
-    for (int axis = 0; axis < 3; axis++) {
-        if (FMath::Abs(direction[axis]) > 0.5f) {
-            float faceA = direction[axis] > 0 ? boundsA.max[axis] : boundsA.min[axis];
-            float faceB = direction[axis] > 0 ? boundsB.min[axis] : boundsB.max[axis];
+    if (CVarLogRemesh.GetValueOnGameThread() != 0 && remeshNodes.Num() > 0) {
+        UE_LOG(LogTemp, Log, TEXT("Voxel remesh: %d of %d visible nodes, %d queued, %d deformation, %d transvoxel passes"),
+            remeshNodes.Num(), visibleNodes.Num(), remeshQueue.Num(), computeUpdateDataNodes.Num(), computeTransvoxelData.Num());
+    }
 
-            if (FMath::Abs(faceA - faceB) > epsilon) // faceA != faceB
-                return false;
-        }
-        else {
-            if (boundsA.max[axis] <= boundsB.min[axis] + epsilon || boundsA.min[axis] >= boundsB.max[axis] - epsilon)
-                return false;
+    if (bReselect) {
+        for (uint32& count : selectedNodesPerDepth)
+            count = 0;
+        for (OctreeNode* node : visibleNodes) {
+            int depth = FMath::Min(node->GetDepth(), selectedNodesPerDepth.Num() - 1);
+            selectedNodesPerDepth[depth]++;
         }
     }
-    return true;
+
+#if STATS
+    static const FName depthStats[] = {
+        GET_STATFNAME(STAT_VoxelMesh_SelectedDepth0), GET_STATFNAME(STAT_VoxelMesh_SelectedDepth1),
+        GET_STATFNAME(STAT_VoxelMesh_SelectedDepth2), GET_STATFNAME(STAT_VoxelMesh_SelectedDepth3),
+        GET_STATFNAME(STAT_VoxelMesh_SelectedDepth4), GET_STATFNAME(STAT_VoxelMesh_SelectedDepth5),
+        GET_STATFNAME(STAT_VoxelMesh_SelectedDepth6), GET_STATFNAME(STAT_VoxelMesh_SelectedDepth7)
+    };
+    uint32 depthCounts[UE_ARRAY_COUNT(depthStats)] = {};
+    for (int depth = 0; depth < selectedNodesPerDepth.Num(); depth++)
+        depthCounts[FMath::Min(depth, (int)UE_ARRAY_COUNT(depthStats) - 1)] += selectedNodesPerDepth[depth];
+    for (int i = 0; i < (int)UE_ARRAY_COUNT(depthStats); i++)
+        SET_DWORD_STAT_FName(depthStats[i], depthCounts[i]);
+#endif
+
+    SET_DWORD_STAT(STAT_VoxelMesh_VisibleNodes, visibleNodes.Num());
+    SET_DWORD_STAT(STAT_VoxelMesh_SurfaceNodes, surfaceNodes.Num());
+    SET_DWORD_STAT(STAT_VoxelMesh_RemeshedNodes, remeshNodes.Num());
+    SET_DWORD_STAT(STAT_VoxelMesh_RemeshQueued, remeshQueue.Num());
+    SET_DWORD_STAT(STAT_VoxelMesh_DeformationSkipped, visibleNodes.Num() - deformNodes.Num());
+    SET_DWORD_STAT(STAT_VoxelMesh_MarchingCubesSkipped, visibleNodes.Num() - surfaceNodes.Num());
+    SET_DWORD_STAT(STAT_VoxelMesh_TransvoxelSkipped, transvoxelSkipped);
+
+    // Nothing changed and the cut is the same, the proxy already draws the right meshes
+    TSharedPtr<FVoxelProxyNodeDiff> proxyDiff = AcquirePooled(proxyDiffPool);
+    proxyDiff->Reset();
+    if (bReselect || remeshNodes.Num() > 0 || bProxyResync)
+        BuildProxyNodeDiff(surfaceNodes, *proxyDiff);
+
+    SET_DWORD_STAT(STAT_VoxelMesh_ProxyAdded, proxyDiff->added.Num());
+    SET_DWORD_STAT(STAT_VoxelMesh_ProxyRemoved, proxyDiff->removed.Num());
+    SET_DWORD_STAT(STAT_VoxelMesh_ProxyChanged, proxyDiff->changed.Num());
+
+    if (proxyDiff->IsEmpty() && computeUpdateDataNodes.Num() == 0 && computeTransvoxelData.Num() == 0) return;
+    InvokeVoxelRenderer(computeUpdateDataNodes, computeTransvoxelData, proxyDiff);
 }
 
-void GetNodesAdjacent(TArray<OctreeNode*>& adjNodes, OctreeNode* node, TArray<OctreeNode*> visibleNodes, FIntVector offset) {
-    FVector nodeScale = node->GetNodeSize();
-    for (OctreeNode* checkNode : visibleNodes) {
-        if (checkNode == node) continue;
+// Keys of a node set and of all their ancestors, so overlap with the set is a walk up the queried key's ancestors
+struct FVoxelKeyCover {
+    TVoxelFrameSet<uint64> keys;
+    TVoxelFrameSet<uint64> ancestors;
 
-        if (AreAdjacent(checkNode, node, offset))
-            adjNodes.Add(checkNode);
+    void Add(uint64 key) {
+        keys.Add(key);
+        for (uint64 ancestor = MortonCode::GetParent(key); ancestor != 0; ancestor = MortonCode::GetParent(ancestor))
+            ancestors.Add(ancestor);
     }
-}
 
-int GetAdjacencyIndex(OctreeNode* node, OctreeNode* adjacentNode, int offsetIndex)
-{
-    FIntVector offset = neighborOffsets[offsetIndex];
-    const float epsilon = 0.0001f;
+    bool Overlaps(uint64 key) const {
+        if (ancestors.Contains(key)) return true;
+        for (uint64 ancestor = key; ancestor != 0; ancestor = MortonCode::GetParent(ancestor)) {
+            if (keys.Contains(ancestor)) return true;
+        }
+        return false;
+    }
+};
+
+// Nodes are only handed to the proxy once their mesh is current, until then whatever they replace stays drawn: a node
+// that left the cut is retained while a queued node overlaps it, and meshed nodes overlapping a retained one are held
+// back so a region swaps LOD in one step. A node is changed when it was remeshed since the proxy last saw it or was
+// given a different resource set by residency.
+void UVoxelMeshComponent::BuildProxyNodeDiff(const TVoxelFrameArray<OctreeNode*>& surfaceNodes, FVoxelProxyNodeDiff& outDiff) {
+    outDiff.bReset = bProxyResync;
+    // Until this reset reaches it the proxy draws the nodes it had, so their pins last until now
+    if (bProxyResync)
+        tree->UnpinAllNodes();
+
+    TVoxelFrameSet<int32> surfaceIndices;
+    surfaceIndices.Reserve(surfaceNodes.Num());
+    for (OctreeNode* node : surfaceNodes)
+        surfaceIndices.Add(node->GetIndex());
+
+    FVoxelKeyCover queued;
+    for (const RemeshJob& job : remeshQueue)
+        queued.Add(job.node->GetKey());
+
+    FVoxelKeyCover retained;
+    for (auto it = proxyNodeStates.CreateIterator(); it; ++it) {
+        if (surfaceIndices.Contains(it.Key())) continue;
+        uint64 key = tree->GetNodeKey(it.Key());
+        if (queued.Overlaps(key)) {
+            retained.Add(key);
+            continue;
+        }
+        outDiff.removed.Add(key);
+        tree->SetNodePinned(it.Key(), false);
+        it.RemoveCurrent();
+    }
 
-    const AABB& boundsA = adjacentNode->GetBounds();
-    const AABB& boundsB = node->GetBounds();
+    for (OctreeNode* node : surfaceNodes) {
+        int32 index = node->GetIndex();
+        if (!tree->IsNodeMeshCurrent(index)) continue;
 
-    int mainAxis = (offset.X != 0) ? 0 : (offset.Y != 0) ? 1 : 2;
+        ProxyNodeState* state = proxyNodeStates.Find(index);
+        if (!state && retained.Overlaps(node->GetKey())) continue;
 
-    int axisA = (mainAxis + 1) % 3;
-    int axisB = (mainAxis + 2) % 3;
+        uint32 meshedVersion = tree->GetNodeMeshedVersion(index);
+        VoxelRenderHandle renderResources = node->GetRenderResources();
+        if (state && state->meshedVersion == meshedVersion && state->renderResources == renderResources) continue;
 
-    FIntVector2 index;
-    index.X = boundsA.max[axisA] + epsilon >= boundsB.max[axisA] ? 1 : 0;
-    index.Y = boundsA.max[axisB] + epsilon >= boundsB.max[axisB] ? 1 : 0;
+        FVoxelProxyUpdateDataNode proxyNode(node->GetDepth(), node);
+        if (!proxyNode.BuildDataCache()) continue;
 
-    int flatIndex = index.X + (index.Y * 2);
-    return flatIndex;
+        if (state) outDiff.changed.Emplace(proxyNode);
+        else outDiff.added.Emplace(proxyNode);
+        proxyNodeStates.Add(index, { meshedVersion, renderResources });
+        tree->SetNodePinned(index, true);
+    }
+    bProxyResync = false;
 }
 
-bool UVoxelMeshComponent::BalanceNode(TArray<OctreeNode*>& removalStack, TArray<OctreeNode*>& pushStack, TArray<OctreeNode*>& visibleNodes, OctreeNode* node) {
-    if (node->IsLeaf()) return false;
-    node->ResetTransVoxelData();
-    FVector nodeSize = node->GetNodeSize();
+float UVoxelMeshComponent::GetRemeshPriority(OctreeNode* node, const VoxelLODView& view) const {
+    AABB bounds = node->GetBounds();
+    FBox box(FVector(bounds.min.X, bounds.min.Y, bounds.min.Z), FVector(bounds.max.X, bounds.max.Y, bounds.max.Z));
+    float size = bounds.Size().X;
+    float distance = FMath::Sqrt(box.ComputeSquaredDistanceToPoint(view.localPosition));
+    float priority = size / (size + distance);
+
+    int32 index = node->GetIndex();
+    if (!tree->HasNodeBeenMeshed(index))
+        priority *= RemeshNewlyVisibleWeight;
+
+    uint32 editsSinceNodeEdit = tree->GetEditsSinceNodeEdit(index);
+    if (editsSinceNodeEdit != MAX_uint32)
+        priority += RemeshEditWeight / (1.0f + editsSinceNodeEdit);
+    return priority;
+}
 
-    int nodeDepth = node->GetDepth();
+void UVoxelMeshComponent::SetNodeVisible(TArray<OctreeNode*>& nodes, OctreeNode* node) {
+    node->SetVisible(true);
+    nodes.Add(node);
+}
 
-    for (int i = 0; i < 6; i++) {
-        FIntVector offset = neighborOffsets[i];
-        TArray<OctreeNode*> neighbors; 
-        GetNodesAdjacent(neighbors, node, visibleNodes, offset);
+// Publishes the selection launched last frame, then starts a new one if the cut is stale. With voxel.AsyncLOD the
+// selection reads only its input copy and the topology snapshot, so edits and remeshing carry on while it runs.
+// Returns whether cachedVisibleNodes changed this frame.
+bool UVoxelMeshComponent::UpdateLODCut(const VoxelLODView& view) {
+    SCOPE_CYCLE_COUNTER(STAT_VoxelMesh_LODGameThread);
 
-        if (neighbors.Num() == 0)
-            continue;
+    bool bPublished = false;
+    if (lodTask.IsValid()) {
+        {
+            SCOPE_CYCLE_COUNTER(STAT_VoxelMesh_LODTaskWait);
+            lodTask.Wait();
+        }
+        PublishLODSelection(lodTaskResult, lodTaskView, lodTaskEditVersion, lodTaskParamsVersion);
+        lodTask = {};
+        lodTaskResult.Reset();
+        bPublished = true;
+    }
+    if (!IsLODCutStale(view)) return bPublished;
 
-        int deepestAdjacentDepth = 0;
-        OctreeNode* deepestAdjacentNode;
+    if (CVarLegacyLODBalance.GetValueOnGameThread() != 0) {
+        cachedVisibleNodes.Reset();
+        tree->BeginVisibilityEpoch();
+        GetVisibleNodes(cachedVisibleNodes, view);
+        {
+            SCOPE_CYCLE_COUNTER(STAT_VoxelMesh_LODBalance);
+            VoxelLODSelector::BalanceLegacy(cachedVisibleNodes);
+        }
+        FinishLODCut(view, tree->GetEditVersion(), lodParamsVersion);
+        return true;
+    }
 
-        for (OctreeNode* adjNode : neighbors) {
-            int nodeDifference = adjNode->GetDepth() - node->GetDepth();
+    VoxelLODSelectionInput input = MakeLODSelectionInput(view);
+    TSharedPtr<VoxelLODSelectionResult> result = AcquirePooled(lodResultPool);
+    if (CVarAsyncLOD.GetValueOnGameThread() == 0) {
+        VoxelLODSelector::Select(input, *result);
+        PublishLODSelection(result, view, tree->GetEditVersion(), lodParamsVersion);
+        return true;
+    }
 
-            if (nodeDifference > deepestAdjacentDepth) {
-                deepestAdjacentNode = adjNode;
-                deepestAdjacentDepth = nodeDifference;
-            }
+    lodTaskView = view;
+    lodTaskEditVersion = tree->GetEditVersion();
+    lodTaskParamsVersion = lodParamsVersion;
+    // lodTaskResult keeps the result alive until the task is waited on, so the task holds no reference the pool counts
+    lodTaskResult = result;
+    lodTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [input = MoveTemp(input), result = result.Get()]() {
+        VoxelLODSelector::Select(input, *result);
+    });
+    return bPublished;
+}
 
-            if (nodeDifference == 1)
-                node->AssignTransVoxelData(i, adjNode, GetAdjacencyIndex(node, adjNode, i));
-        }
-        if (deepestAdjacentDepth < 2) continue;
+VoxelLODSelectionInput UVoxelMeshComponent::MakeLODSelectionInput(const VoxelLODView& view) {
+    VoxelLODSelectionInput input;
+    input.topology = tree->GetTopologySnapshot();
+    input.view = view;
+    input.bScreenSpaceError = lodSelector == EVoxelLODSelector::ScreenSpaceError;
+    if (!lodHysteresisShared.IsValid())
+        lodHysteresisShared = MakeShared<TArray<float>>(lodHysteresisPerDepth);
+    input.hysteresisPerDepth = lodHysteresisShared;
+    // Shares the published result's ownership, so the pool does not hand it out again while a selection reads it
+    if (lodPublishedResult.IsValid())
+        input.wasRefined = TSharedPtr<const TBitArray<>>(lodPublishedResult, &lodPublishedResult->refined);
+    return input;
+}
 
-        SetChildrenVisible(pushStack, node, 0, deepestAdjacentDepth - 1);
-        node->ResetTransVoxelData();
-        node->SetVisible(false);
-        removalStack.Add(node);
-        return true;
+void UVoxelMeshComponent::PublishLODSelection(const TSharedPtr<VoxelLODSelectionResult>& result, const VoxelLODView& view, uint32 editVersion, uint32 paramsVersion) {
+    cachedVisibleNodes.Reset();
+    tree->ApplyLODSelection(result->visibleNodes, cachedVisibleNodes);
+    lodPublishedResult = result;
+    FinishLODCut(view, editVersion, paramsVersion);
+}
+
+// A selection made with settings that changed while it was running is still shown, but reselected straight away
+void UVoxelMeshComponent::FinishLODCut(const VoxelLODView& view, uint32 editVersion, uint32 paramsVersion) {
+    cachedFinestNodeSize = MAX_flt;
+    for (OctreeNode* node : cachedVisibleNodes) {
+        cachedFinestNodeSize = FMath::Min(cachedFinestNodeSize, node->GetBounds().Size().X);
+        tree->UpdateTransitionSignature(node->GetIndex(), node->GetTransitionSignature());
     }
-    return false;
+    cachedLODView = view;
+    cachedEditVersion = editVersion;
+    bLODCutValid = paramsVersion == lodParamsVersion;
+    INC_DWORD_STAT(STAT_VoxelMesh_LODCutRebuilds);
 }
 
-void UVoxelMeshComponent::BalanceVisibleNodes(TArray<OctreeNode*>& visibleNodes) {
-    TArray<OctreeNode*> removalStack;
-    TArray<OctreeNode*> pushStack;
-    bool reBalance = false;
+// A coarse node swapping LOD changes 2^(maxDepth - depth) times more surface per voxel than a finest node, so its
+// switch is more visible and it gets a wider band: the base band grows by LODHysteresisGrowthPerDepth per level above
+// the finest.
+void UVoxelMeshComponent::SetLODHysteresis(float inHysteresis) {
+    int finestDepth = lodHysteresisPerDepth.Num() - 1;
+    for (int depth = 0; depth <= finestDepth; depth++)
+        lodHysteresisPerDepth[depth] = FMath::Clamp(inHysteresis * (1.0f + LODHysteresisGrowthPerDepth * (finestDepth - depth)), 0.0f, MaxLODHysteresis);
+    lodHysteresisShared.Reset();
+    InvalidateLODCut();
+}
 
-    for (OctreeNode* node : visibleNodes) {
-        reBalance = BalanceNode(removalStack, pushStack, visibleNodes, node);
-        if (reBalance) break;
+void UVoxelMeshComponent::SetLODHysteresis(const TArray<float>& inHysteresisPerDepth) {
+    int count = FMath::Min(inHysteresisPerDepth.Num(), lodHysteresisPerDepth.Num());
+    for (int depth = 0; depth < count; depth++)
+        lodHysteresisPerDepth[depth] = FMath::Clamp(inHysteresisPerDepth[depth], 0.0f, MaxLODHysteresis);
+    lodHysteresisShared.Reset();
+    InvalidateLODCut();
+}
+
+void UVoxelMeshComponent::BenchmarkBuild(int32 iterations) {
+    if (!tree) return;
+    TArray<Octree::BuildTiming> timings;
+    tree->BenchmarkBuild(iterations, timings);
+    if (timings.Num() == 0) {
+        UE_LOG(LogTemp, Log, TEXT("Octree depth %d: no surface subtrees below the split depth to build"), tree->GetMaxDepth());
+        return;
     }
+    for (const Octree::BuildTiming& timing : timings) {
+        UE_LOG(LogTemp, Log, TEXT("Octree depth %d build (%d nodes): %d workers %.3f ms, speedup %.2fx%s"),
+            tree->GetMaxDepth(), timing.nodeCount, timing.workers, timing.seconds * 1000.0, timing.seconds > 0.0 ? timings[0].seconds / timing.seconds : 0.0,
+            timing.nodeCount == timings[0].nodeCount ? TEXT("") : TEXT(", node count differs"));
+    }
+}
 
-    visibleNodes.RemoveAll([&](OctreeNode* n) {
-        return removalStack.Contains(n);
-    });
+// Serial is what the game thread pays to snapshot, select, balance and publish the cut itself. The task is launched
+// first and the serial selection then runs on the game thread while it is in flight, standing in for the rest of the
+// frame, so the task's game thread cost is the launch, any wait left once that work is done and the publish.
+// Capping the depth the selection may refine to emulates the shallower trees, VoxelRendering.Octree.Benchmark.LODSelection
+// covers trees deeper than the live one.
+void UVoxelMeshComponent::BenchmarkLODSelection(int32 iterations) {
+    VoxelLODView view;
+    if (!tree || !BuildLODView(view)) return;
+    if (lodTask.IsValid()) {
+        lodTask.Wait();
+        lodTask = {};
+        lodTaskResult.Reset();
+    }
 
-    for (OctreeNode* node : pushStack) {
-        if (!visibleNodes.Contains(node)) {
-            visibleNodes.Add(node);
+    TArray<OctreeNode*> nodes;
+    for (int depth = 0; depth <= tree->GetMaxDepth(); depth++) {
+        double serialSeconds = 0.0;
+        double launchSeconds = 0.0;
+        double waitSeconds = 0.0;
+        double publishSeconds = 0.0;
+        double workerSeconds = 0.0;
+        for (int32 i = 0; i < iterations; i++) {
+            double start = FPlatformTime::Seconds();
+            VoxelLODSelectionInput taskInput = MakeLODSelectionInput(view);
+            taskInput.maxDepth = depth;
+            double taskSelectSeconds = 0.0;
+            UE::Tasks::TTask<VoxelLODSelectionResult> task = UE::Tasks::Launch(UE_SOURCE_LOCATION, [taskInput = MoveTemp(taskInput), &taskSelectSeconds]() {
+                double selectStart = FPlatformTime::Seconds();
+                VoxelLODSelectionResult taskResult;
+                VoxelLODSelector::Select(taskInput, taskResult);
+                taskSelectSeconds = FPlatformTime::Seconds() - selectStart;
+                return taskResult;
+            });
+            launchSeconds += FPlatformTime::Seconds() - start;
+
+            start = FPlatformTime::Seconds();
+            VoxelLODSelectionInput input = MakeLODSelectionInput(view);
+            input.maxDepth = depth;
+            VoxelLODSelectionResult result;
+            VoxelLODSelector::Select(input, result);
+            nodes.Reset();
+            tree->ApplyLODSelection(result.visibleNodes, nodes);
+            serialSeconds += FPlatformTime::Seconds() - start;
+
+            start = FPlatformTime::Seconds();
+            task.Wait();
+            waitSeconds += FPlatformTime::Seconds() - start;
+            workerSeconds += taskSelectSeconds;
+
+            start = FPlatformTime::Seconds();
+            nodes.Reset();
+            tree->ApplyLODSelection(task.GetResult().visibleNodes, nodes);
+            publishSeconds += FPlatformTime::Seconds() - start;
         }
+
+        double taskSeconds = launchSeconds + waitSeconds + publishSeconds;
+        UE_LOG(LogTemp, Log, TEXT("Voxel LOD benchmark depth %d (%d nodes selected): serial %.3f ms, tasks %.3f ms of game thread time (launch %.3f, wait %.3f, publish %.3f) for %.3f ms of worker time"),
+            depth, nodes.Num(), serialSeconds * 1000.0 / iterations, taskSeconds * 1000.0 / iterations, launchSeconds * 1000.0 / iterations,
+            waitSeconds * 1000.0 / iterations, publishSeconds * 1000.0 / iterations, workerSeconds * 1000.0 / iterations);
     }
 
-    if (reBalance)
-        BalanceVisibleNodes(visibleNodes);
+    // Put the tree back on the cut for the current view, the benchmark overwrote its visibility
+    TSharedPtr<VoxelLODSelectionResult> result = AcquirePooled(lodResultPool);
+    VoxelLODSelector::Select(MakeLODSelectionInput(view), *result);
+    PublishLODSelection(result, view, tree->GetEditVersion(), lodParamsVersion);
 }
 
-void UVoxelMeshComponent::GetVisibleNodes(TArray<OctreeNode*>& nodes, OctreeNode* node) {
-    if (!node) return;
+bool UVoxelMeshComponent::BuildLODView(VoxelLODView& view) {
+    if (!tree->GetRoot()) return false;
 
     if (!playerController)
         playerController = GetWorld()->GetFirstPlayerController();
 
-    APawn* playerPawn = playerController->GetPawn();
-
     FRotator viewRot;
     FVector playerViewLoc;
     playerController->GetPlayerViewPoint(playerViewLoc, viewRot);
 
     FVector playerPos = usePlayerLOD ? playerViewLoc : player->GetActorTransform().GetLocation();
-    FQuat playerForward = viewRot.Quaternion();
-    if (node->IsLeaf()) 
-        SetNodeVisible(nodes, node);
-    else {
+    FTransform treeTransform = tree->GetParentActor()->GetTransform();
+
+    view.localPosition = treeTransform.InverseTransformPosition(playerPos);
+    view.localForward = treeTransform.InverseTransformRotation(viewRot.Quaternion()).GetForwardVector();
+    view.localDistance = viewDistance / treeTransform.GetMaximumAxisScale();
+    view.forwardCheck = usePlayerLOD;
+
+    FVector2D viewportSize(1920.0f, 1080.0f);
+    if (GEngine && GEngine->GameViewport)
+        GEngine->GameViewport->GetViewportSize(viewportSize);
+    float fov = playerController->PlayerCameraManager ? playerController->PlayerCameraManager->GetFOVAngle() : 90.0f;
+    view.projectionScale = (viewportSize.Y / (2.0f * FMath::Tan(FMath::DegreesToRadians(fov) * 0.5f))) * treeTransform.GetMaximumAxisScale();
+    view.errorThreshold = screenSpaceErrorThreshold;
+    return true;
+}
 
-        if (node->RayIntersectVoxelBody(playerPos, playerForward, viewDistance, usePlayerLOD)) {
-            for (int i = 0; i < 8; i++)
-                GetVisibleNodes(nodes, node->children[i]);
+// The planet rotating under a still camera moves the camera in local space, so the cut is only reselected once
+// that movement is a meaningful fraction of the finest node it selected, or the tree has been edited.
+bool UVoxelMeshComponent::IsLODCutStale(const VoxelLODView& view) const {
+    if (!bLODCutValid || cachedEditVersion != tree->GetEditVersion()) return true;
+    if (view.forwardCheck != cachedLODView.forwardCheck || view.projectionScale != cachedLODView.projectionScale) return true;
+
+    float moveThreshold = cachedFinestNodeSize * CVarLODCacheMoveFraction.GetValueOnGameThread();
+    if (FVector::DistSquared(view.localPosition, cachedLODView.localPosition) > FMath::Square(moveThreshold)) return true;
+
+    if (lodSelector == EVoxelLODSelector::ViewRay && view.forwardCheck) {
+        float minDot = FMath::Cos(FMath::DegreesToRadians(CVarLODCacheAngle.GetValueOnGameThread()));
+        if (FVector::DotProduct(view.localForward, cachedLODView.localForward) < minDot) return true;
+    }
+    return false;
+}
+
+void UVoxelMeshComponent::GetVisibleNodes(TArray<OctreeNode*>& nodes, const VoxelLODView& view) {
+    SCOPE_CYCLE_COUNTER(STAT_VoxelMesh_LODSelect);
+    OctreeNode* root = tree->GetRoot();
+    if (!root) return;
+
+    TArray<OctreeNode*, TInlineAllocator<64>> stack;
+    stack.Add(root);
+    while (stack.Num() > 0) {
+        OctreeNode* node = stack.Pop(EAllowShrinking::No);
+        if (node->IsLeaf() || !ShouldRefineNode(node, view)) {
+            SetNodeVisible(nodes, node);
+            continue;
         }
-        else SetNodeVisible(nodes, node);
+        for (int i = 7; i >= 0; i--)
+            stack.Add(node->GetChild(i));
     }
 }
 
+bool UVoxelMeshComponent::ShouldRefineNode(OctreeNode* node, const VoxelLODView& view) {
+    if (lodSelector == EVoxelLODSelector::ViewRay)
+        return node->RayIntersectVoxelBody(view);
+
+    int32 index = node->GetIndex();
+    int depth = node->GetDepth();
+    float hysteresis = lodHysteresisPerDepth.IsValidIndex(depth) ? lodHysteresisPerDepth[depth] : 0.0f;
+    bool refine = node->ExceedsScreenSpaceError(view, hysteresis, tree->WasNodeRefined(index));
+    tree->SetNodeRefined(index, refine);
+    return refine;
+}
+
 void UVoxelMeshComponent::InvokeVoxelRenderPasses() {
     if (!sceneProxy) return;
     if (!sceneProxy->IsInitialized()) return;
 
     CheckVoxelMining();
     if (eraser) {
-        FTransform eraserTransform = eraser->GetActorTransform();
-        tree->ApplyDeformationAtPosition(eraserTransform.GetLocation(), 50.0f, 0.5f);
+        VoxelEditCommand eraserEdit;
+        eraserEdit.op = EVoxelEditOp::Subtract;
+        eraserEdit.position = eraser->GetActorLocation();
+        eraserEdit.radius = 50.0f;
+        eraserEdit.influence = 0.5f;
+        AdvanceStroke(eraserStroke, eraserEdit);
     }
+    ApplyStressEdits(CVarDeltaUploadStress.GetValueOnGameThread());
+    ApplyQueuedEdits();
     if (tree->AreValuesDirty()) tree->UpdateValuesDirty();
+
+    UpdateRenderData();
+}
+
+void UVoxelMeshComponent::UpdateRenderData() {
+    FVoxelFrameArena::FScope arenaScope(frameArena);
+    uint32 heapAllocationsBefore = frameArena.GetHeapAllocationCount();
     SetRenderDataLOD();
+
+    SET_MEMORY_STAT(STAT_VoxelMesh_ArenaUsed, frameArena.GetUsedBytes());
+    SET_MEMORY_STAT(STAT_VoxelMesh_ArenaCapacity, frameArena.GetCapacity());
+    INC_DWORD_STAT_BY(STAT_VoxelMesh_ArenaHeapAllocations, frameArena.GetHeapAllocationCount() - heapAllocationsBefore);
 }
 
-void UVoxelMeshComponent::UpdateSceneProxyNodes(const TArray<FVoxelProxyUpdateDataNode> updateNodes) {
-    sceneProxy->UpdateSelectedNodes(updateNodes);
+#if WITH_DEV_AUTOMATION_TESTS
+// Forces the first few visible surface nodes stale and the cut to be reselected, then runs the render data update
+// until it has done that same work CheckTickAllocationsWarmUps times, which sizes the arena and every pool for it.
+// Rendering commands are flushed before each run so the pooled diff and dispatch are free again, as they are a few
+// frames into play. The last run counts every heap allocation the game thread makes, the engine's task and render
+// command allocators included.
+bool UVoxelMeshComponent::CheckTickAllocations(TickAllocationCheck& outCheck) {
+    if (!tree || !sceneProxy || !sceneProxy->IsInitialized()) return false;
+
+    TArray<int32, TInlineAllocator<CheckTickAllocationsNodes>> forcedNodes;
+    for (int32 run = 0; run <= CheckTickAllocationsWarmUps; run++) {
+        FlushRenderingCommands();
+        forcedNodes.Reset();
+        for (OctreeNode* node : cachedVisibleNodes) {
+            if (forcedNodes.Num() == CheckTickAllocationsNodes) break;
+            int32 index = node->GetIndex();
+            if (node->ClassifyNode() != EVoxelNodeClass::Surface || !tree->IsNodeMeshCurrent(index)) continue;
+            tree->BumpNodeContentVersion(index);
+            forcedNodes.Add(index);
+        }
+        InvalidateLODCut();
+
+        FVoxelHeapAllocationScope heapScope;
+        UpdateRenderData();
+        outCheck.allocations = heapScope.GetAllocationCount();
+    }
+
+    outCheck.forcedNodes = forcedNodes.Num();
+    outCheck.remeshed = 0;
+    for (int32 index : forcedNodes)
+        outCheck.remeshed += tree->IsNodeMeshCurrent(index) ? 1 : 0;
+    return true;
+}
+#endif
+
+void UVoxelMeshComponent::ApplyStressEdits(int32 editCount) {
+    if (editCount <= 0 || !palette) return;
+
+    FTransform treeTransform = tree->GetParentActor()->GetTransform();
+    float halfSize = tree->GetScale() / 2.0f;
+    for (int32 i = 0; i < editCount; i++) {
+        FVector localPosition(FMath::FRandRange(-halfSize, halfSize), FMath::FRandRange(-halfSize, halfSize), FMath::FRandRange(-halfSize, halfSize));
+        VoxelEditCommand command = MakeBrushEdit(FMath::RandBool() ? EVoxelEditOp::Add : EVoxelEditOp::Subtract, treeTransform.TransformPosition(localPosition));
+        command.paintType = 0;
+        EnqueueEdit(command);
+    }
 }
 
+VoxelEditCommand UVoxelMeshComponent::MakeBrushEdit(EVoxelEditOp op, const FVector& position) const {
+    VoxelEditCommand command;
+    command.op = op;
+    command.position = position;
+    // Without a palette the brush has no radius and edits nothing
+    if (!palette) return command;
+
+    command.radius = palette->GetBrushRadius();
+    command.influence = palette->GetBrushPower();
+    command.paintType = command.WritesType() ? palette->GetPaintType() : 0;
+
+    if (palette->GetShapeBrush().IsValid() && !command.IsFilter()) {
+        // Shape brushes stand on the surface with their z axis pointing away from the body's centre
+        FVector up = (position - tree->GetParentActor()->GetActorLocation()).GetSafeNormal();
+        command.shape = EVoxelEditShape::SDF;
+        command.sdfBrush = palette->GetShapeBrush();
+        command.rotation = FQuat::FindBetweenNormals(FVector::UpVector, up.IsNearlyZero() ? FVector::UpVector : up);
+    }
+    return command;
+}
 
-void UVoxelMeshComponent::InvokeVoxelRenderer(TArray<FVoxelComputeUpdateNodeData>& updateData, TArray<FVoxelTransVoxelNodeData>& transVoxelUpdateData, const TArray<FVoxelProxyUpdateDataNode> proxyNodes) {
+void Palette::RefreshShapeBrush() {
+    float radius = brushRadius;
+    switch (brushShape) {
+    case EVoxelBrushShape::Box: shapeBrush = VoxelSDFBrush::MakePrimitive(EVoxelSDFPrimitive::Box, FVector3f(radius)); break;
+    case EVoxelBrushShape::Capsule: shapeBrush = VoxelSDFBrush::MakePrimitive(EVoxelSDFPrimitive::Capsule, FVector3f(radius * 0.5f, radius * 0.5f, 0.0f)); break;
+    case EVoxelBrushShape::Cylinder: shapeBrush = VoxelSDFBrush::MakePrimitive(EVoxelSDFPrimitive::Cylinder, FVector3f(radius, radius * 0.5f, 0.0f)); break;
+    case EVoxelBrushShape::Torus: shapeBrush = VoxelSDFBrush::MakePrimitive(EVoxelSDFPrimitive::Torus, FVector3f(radius * 0.7f, radius * 0.3f, 0.0f)); break;
+    case EVoxelBrushShape::Mesh:
+        shapeBrush = meshVolume.IsValid()
+            ? VoxelSDFBrush::MakeVolume(meshVolume, radius / FMath::Max(meshVolume->GetBounds().GetExtent().GetMax(), UE_KINDA_SMALL_NUMBER))
+            : nullptr;
+        break;
+    default: shapeBrush = nullptr; break;
+    }
+}
 
-    if (!sceneProxy) return;
-    if (!sceneProxy->IsInitialized()) return;
+// The brush switches to the mesh once its volume is built, until then it keeps its current shape
+void UVoxelMeshComponent::SetBrushMesh(UStaticMesh* mesh, int32 resolution) {
+    if (!palette) return;
+    TPair<TObjectKey<UStaticMesh>, int32> key(mesh, resolution);
+    if (TSharedPtr<const VoxelSDFVolume>* cached = meshVolumes.Find(key)) {
+        pendingMeshVolume = {};
+        UseMeshVolume(*cached);
+        return;
+    }
+    LaunchMeshVolumeBuild(mesh, resolution);
+}
 
-    FMarchingCubesDispatchParams Params(1, 1, 1);
-    Params.Input.updateData = { tree };
-    Params.Input.updateData.nodeData = updateData;
-    Params.Input.updateData.transVoxelNodeData = transVoxelUpdateData;
+void UVoxelMeshComponent::UseMeshVolume(const TSharedPtr<const VoxelSDFVolume>& volume) {
+    palette->SetMeshVolume(volume);
+    palette->SetBrushShape(EVoxelBrushShape::Mesh);
+}
 
-    if (!Params.Input.updateData.BuildDataCache())
+// The triangles are copied on the game thread, the volume is brute force over every sample and triangle so it is
+// built on a task. A later request replaces one still building, whose result is then dropped.
+void UVoxelMeshComponent::LaunchMeshVolumeBuild(UStaticMesh* mesh, int32 resolution) {
+    const FStaticMeshRenderData* renderData = mesh ? mesh->GetRenderData() : nullptr;
+    if (!renderData || renderData->LODResources.Num() == 0) return;
+#if !WITH_EDITOR
+    // Cooked meshes only keep their triangles on the CPU with Allow CPU Access set
+    if (!mesh->bAllowCPUAccess) {
+        UE_LOG(LogTemp, Warning, TEXT("Voxel mesh brush %s needs Allow CPU Access"), *mesh->GetName());
         return;
+    }
+#endif
+
+    const FStaticMeshLODResources& lod = renderData->LODResources[0];
+    const FPositionVertexBuffer& positionBuffer = lod.VertexBuffers.PositionVertexBuffer;
+    TArray<FVector3f> positions;
+    positions.SetNumUninitialized(positionBuffer.GetNumVertices());
+    for (uint32 i = 0; i < positionBuffer.GetNumVertices(); i++)
+        positions[i] = positionBuffer.VertexPosition(i);
+    TArray<uint32> indices;
+    lod.IndexBuffer.GetCopy(indices);
+    float padding = mesh->GetBounds().BoxExtent.GetMax() * 0.1f;
+
+    pendingMeshVolume.key = TPair<TObjectKey<UStaticMesh>, int32>(mesh, resolution);
+    pendingMeshVolume.meshName = mesh->GetName();
+    pendingMeshVolume.triangleCount = indices.Num() / 3;
+    pendingMeshVolume.startSeconds = FPlatformTime::Seconds();
+    pendingMeshVolume.task = UE::Tasks::Launch(UE_SOURCE_LOCATION,
+        [positions = MoveTemp(positions), indices = MoveTemp(indices), resolution, padding]() -> TSharedPtr<const VoxelSDFVolume> {
+            return VoxelSDFVolume::BuildFromTriangles(positions, indices, resolution, padding);
+        });
+}
 
-    FMarchingCubesInterface::Dispatch(Params,
-        [WeakThis = TWeakObjectPtr<UVoxelMeshComponent>(this), proxyNodes](FMarchingCubesOutput OutputVal) {
-            if (!WeakThis.IsValid()) return;
-            if (IsEngineExitRequested()) return;
+void UVoxelMeshComponent::FinishMeshVolumeBuild() {
+    if (!pendingMeshVolume.task.IsValid() || !pendingMeshVolume.task.IsCompleted()) return;
 
-            WeakThis->UpdateSceneProxyNodes(proxyNodes);
+    TSharedPtr<const VoxelSDFVolume> volume = pendingMeshVolume.task.GetResult();
+    UE_LOG(LogTemp, Log, TEXT("Voxel mesh brush %s: %d triangles at %d samples per axis ready after %.1f ms"),
+        *pendingMeshVolume.meshName, pendingMeshVolume.triangleCount, pendingMeshVolume.key.Value, (FPlatformTime::Seconds() - pendingMeshVolume.startSeconds) * 1000.0);
+    if (volume.IsValid()) {
+        meshVolumes.Add(pendingMeshVolume.key, volume);
+        if (palette) UseMeshVolume(volume);
+    }
+    pendingMeshVolume = {};
+}
+
+// Edits pushed since the last frame, from this thread or any other, are applied as one coalesced batch
+void UVoxelMeshComponent::ApplyQueuedEdits() {
+    editBatch.Reset();
+    if (editQueue.Drain(editBatch, CVarMaxEditsPerFrame.GetValueOnGameThread()) == 0) return;
+    VoxelEditQueue::Coalesce(editBatch);
+    tree->ApplyEditBatch(editBatch);
+
+    tree->ConsumeDetachedChunks(detachedChunks);
+    AVoxelBody* body = Cast<AVoxelBody>(GetOwner());
+    for (const VoxelDetachedChunk& chunk : detachedChunks) {
+        UE_LOG(LogTemp, Log, TEXT("Voxel chunk detached: %lld samples, volume %.0f, bounds %s"), chunk.sampleCount, chunk.volume, *chunk.bounds.ToString());
+        if (debugNodes)
+            DrawDebugBox(GetWorld(), chunk.bounds.GetCenter(), chunk.bounds.GetExtent(), FColor::Orange, false, 5.0f, 0, 2.0f);
+        if (body)
+            body->onChunkDetached.Broadcast(chunk.bounds, chunk.volume);
+    }
+}
+
+void UVoxelMeshComponent::UpdateSceneProxyNodes(const TSharedPtr<const FVoxelProxyNodeDiff>& diff) {
+    if (!sceneProxy || !diff.IsValid() || diff->IsEmpty()) return;
+    ENQUEUE_RENDER_COMMAND(ApplyVoxelProxyDiff)(
+        [proxy = sceneProxy, diff](FRHICommandListImmediate& RHICmdList) {
+            proxy->ApplyNodeDiff(*diff);
         });
 }
 
+
+void UVoxelMeshComponent::InvokeVoxelRenderer(const TVoxelFrameArray<FVoxelComputeUpdateNodeData>& updateData, const TVoxelFrameArray<FVoxelTransVoxelNodeData>& transVoxelUpdateData, const TSharedPtr<FVoxelProxyNodeDiff>& proxyDiff) {
+
+    // The diff is only valid against what the proxy already holds, so a dropped one forces a full resend
+    if (!sceneProxy || !sceneProxy->IsInitialized()) {
+        proxyNodeStates.Reset();
+        bProxyResync = true;
+        return;
+    }
+
+    // The dispatch outlives the tick, so its copies go into pooled params rather than the frame arena
+    TSharedPtr<FMarchingCubesDispatchParams> params = AcquirePooled(dispatchParamsPool, 1, 1, 1);
+    FVoxelComputeUpdateData& computeUpdateData = params->Input.updateData;
+    computeUpdateData.Reset(tree);
+    computeUpdateData.nodeData.Append(updateData);
+    computeUpdateData.transVoxelNodeData.Append(transVoxelUpdateData);
+
+    if (!computeUpdateData.BuildDataCache()) {
+        proxyNodeStates.Reset();
+        bProxyResync = true;
+        return;
+    }
+
+    // proxyNodeStates already holds this diff, so it goes to the proxy with its own render command rather than the
+    // dispatch's completion, which never runs when the dispatch is dropped. Queued after the dispatch, it still
+    // reaches the proxy only once the passes writing its meshes are recorded.
+    FMarchingCubesInterface::DispatchShared(params);
+    UpdateSceneProxyNodes(proxyDiff);
+}
+
 void UVoxelMeshComponent::TraverseAndDraw() {
     if (!debugNodes) return;
     tree->DebugOctreeNodes(GetWorld());
@@ -3,6 +3,7 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "Octree.h"
+#include "VoxelMeshComponent.h"
 #include "Delegates/DelegateCombinations.h"
 #include "NiagaraFunctionLibrary.h"
 #include "NiagaraSystem.h"
@@ -10,6 +11,7 @@
 
 class UVoxelMeshComponent;
 class UBufferResource;
+class UStaticMesh;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnRefresh);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnDebugToggle);
@@ -21,6 +23,7 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnDensityDelta, float, value);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnViewDelta, float, value);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnRadiusDelta, float, value);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnTypeDelta, int, value);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnChunkDetached, FBox, bounds, float, volume);
 
 UCLASS()
 class VOXELRENDERING_API AVoxelBody : public AActor
@@ -84,12 +87,30 @@ public:
     UFUNCTION(BlueprintCallable, Category = "UI")
     void SetView(float inViewDis);
 
+    UFUNCTION(BlueprintCallable, Category = "UI")
+    void SetBrushShape(EVoxelBrushShape shape);
+
+    UFUNCTION(BlueprintCallable, Category = "UI")
+    void SetBrushMesh(UStaticMesh* mesh, int resolution = 32);
+
+    UFUNCTION(BlueprintCallable, Category = "UI")
+    void SetBrushTool(EVoxelBrushTool tool);
+
     UFUNCTION(BlueprintCallable, Category = "UI")
     void SetBrushType(int type);
 
     UFUNCTION(BlueprintCallable, Category = "UI")
     void ToggleLOD();
 
+    UFUNCTION(BlueprintCallable, Category = "UI")
+    void SetResidencyBudget(int budgetMB, int graceFrames);
+
+    UFUNCTION(BlueprintCallable, Category = "UI")
+    void SetLODSelector(EVoxelLODSelector selector, float errorPixels, float hysteresis);
+
+    UFUNCTION(BlueprintCallable, Category = "UI")
+    void SetLODHysteresisPerDepth(const TArray<float>& hysteresisPerDepth);
+
     static FOnRefresh onRefresh;
     static FOnDebugToggle onDebugToggle;
     static FOnRotateToggle onRotateToggle;
@@ -101,6 +122,10 @@ public:
     static FOnTypeDelta onTypeDelta;
     static FOnViewDelta onViewDelta;
 
+    // Broadcast for every solid piece an edit cuts off from this body, bounds in world space
+    UPROPERTY(BlueprintAssignable, Category = "Events")
+    FOnChunkDetached onChunkDetached;
+
 
     void BeginPlay()
     {
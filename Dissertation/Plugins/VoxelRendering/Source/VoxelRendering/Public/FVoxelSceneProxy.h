@@ -23,24 +23,25 @@ public:
 	virtual void CreateRenderThreadResources(FRHICommandListBase& RHICmdList) override;
 	virtual void DestroyRenderThreadResources() override;
 	virtual void OnTransformChanged(FRHICommandListBase& RHICmdList) override;
-	void UpdateSelectedNodes(const TArray<FVoxelProxyUpdateDataNode>& renderData);
+	void ApplyNodeDiff(const FVoxelProxyNodeDiff& diff);
 
 	void RenderMyCustomPass(FRHICommandListImmediate& RHICmdList, const FScene* Scene, const FSceneView* View);
 	bool IsInitialized();
 	bool CanBeRendered() const { return bCompatiblePlatform; }
 
 	UMaterialInterface* Material;
-	TArray<FVoxelProxyUpdateDataNode> GetVisibleNodes() { return selectedNodes; }
+	TArray<FVoxelProxyUpdateDataNode> GetVisibleNodes() const;
 
 protected:
 	mutable TArray<FMeshBatch> CustomPassMeshBatches;
-	TArray<FVoxelProxyUpdateDataNode> selectedNodes;
+	// Render thread only, persists across frames and is only touched by the entries of each diff
+	TMap<uint64, FVoxelProxyUpdateDataNode> selectedNodes;
 	bool bInitialized = false;
 	bool bCompatiblePlatform = true;
 
 	void SetMeshBatchRenderProxy(FMeshBatch& meshBatch) const;
-	void SetMeshBatchGeneric(FMeshBatch& meshBatch, const FVoxelProxyUpdateDataNode& node, int32 viewIndex, bool bWireframe = false) const;
-	void SetMeshBatchElementsGeneric(FMeshBatch& meshBatch, const FVoxelProxyUpdateDataNode& node, int32 viewIndex) const;
+	void SetMeshBatchGeneric(FMeshBatch& meshBatch, FVoxelVertexFactory* vertexFactory, int32 viewIndex, bool bWireframe = false) const;
+	void SetMeshBatchElementsGeneric(FMeshBatch& meshBatch, FVoxelVertexFactory* vertexFactory, int32 viewIndex) const;
 	void SetMeshBatchElementsUserData(FMeshBatchElement& meshBatch) const;
 
 };
@@ -0,0 +1,138 @@
+#pragma once
+#include "CoreMinimal.h"
+
+/**
+ * Linear allocator for the bookkeeping of one voxel tick. Allocations bump through a single block and are never freed
+ * individually, the whole arena is rewound when the next tick opens its scope. A tick that outgrows the block takes
+ * extra heap blocks, and the next rewind replaces everything with one block sized to that peak, so steady state
+ * ticks allocate nothing. Containers using TVoxelFrameAllocator must not outlive the scope they were filled in.
+ */
+
+class VOXELRENDERING_API FVoxelFrameArena {
+public:
+    FVoxelFrameArena() = default;
+    ~FVoxelFrameArena();
+    FVoxelFrameArena(const FVoxelFrameArena&) = delete;
+    FVoxelFrameArena& operator=(const FVoxelFrameArena&) = delete;
+
+    void* Allocate(SIZE_T size, uint32 alignment);
+    void Reset();
+
+    // Every block ever taken from the heap, the block and any overflow alike
+    uint32 GetHeapAllocationCount() const { return heapAllocationCount; }
+    SIZE_T GetUsedBytes() const { return offset + overflowBytes; }
+    SIZE_T GetCapacity() const { return capacity; }
+
+    // Makes an arena current on this thread for its lifetime and rewinds it, TVoxelFrameAllocator allocates from it
+    class FScope {
+    public:
+        FScope(FVoxelFrameArena& arena);
+        ~FScope();
+    private:
+        FVoxelFrameArena* previous;
+    };
+
+    static FVoxelFrameArena& GetCurrent();
+
+private:
+    static constexpr SIZE_T MinBlockSize = 64 * 1024;
+    static constexpr uint32 MinAlignment = 16;
+
+    uint8* block = nullptr;
+    SIZE_T capacity = 0;
+    SIZE_T offset = 0;
+    TArray<void*, TInlineAllocator<16>> overflowBlocks;
+    SIZE_T overflowBytes = 0;
+    uint32 heapAllocationCount = 0;
+};
+
+#if WITH_DEV_AUTOMATION_TESTS
+/**
+ * Counts the heap allocations the game thread makes while a scope is open, for the tick allocation test only. The
+ * outermost scope wraps GMalloc in a counting proxy and puts the allocator it wrapped back when it closes. The proxy
+ * has static storage, so a thread that read GMalloc just before it was put back still calls into a live allocator.
+ */
+
+class VOXELRENDERING_API FVoxelHeapAllocationScope {
+public:
+    FVoxelHeapAllocationScope();
+    ~FVoxelHeapAllocationScope();
+    FVoxelHeapAllocationScope(const FVoxelHeapAllocationScope&) = delete;
+    FVoxelHeapAllocationScope& operator=(const FVoxelHeapAllocationScope&) = delete;
+
+    // Mallocs and growing reallocs on this thread since the scope opened, nested scopes included
+    uint32 GetAllocationCount() const;
+
+private:
+    uint32 startCount;
+};
+#endif
+
+/**
+ * Container allocator that takes its memory from the current FVoxelFrameArena. Growing copies into a fresh allocation
+ * and abandons the old one until the arena is rewound.
+ */
+template<uint32 Alignment = DEFAULT_ALIGNMENT>
+class TVoxelFrameAllocator {
+public:
+    using SizeType = int32;
+
+    enum { NeedsElementType = true };
+    enum { RequireRangeCheck = true };
+
+    template<typename ElementType>
+    class ForElementType {
+    public:
+        ForElementType() : data(nullptr) {}
+
+        FORCEINLINE void MoveToEmpty(ForElementType& other) {
+            checkSlow(this != &other);
+            data = other.data;
+            other.data = nullptr;
+        }
+
+        FORCEINLINE ElementType* GetAllocation() const { return data; }
+
+        void ResizeAllocation(SizeType currentNum, SizeType newMax, SIZE_T numBytesPerElement) {
+            ElementType* oldData = data;
+            data = nullptr;
+            if (newMax == 0) return;
+
+            uint32 alignment = FMath::Max(Alignment, (uint32)alignof(ElementType));
+            data = (ElementType*)FVoxelFrameArena::GetCurrent().Allocate(newMax * numBytesPerElement, alignment);
+            if (oldData && currentNum)
+                FMemory::Memcpy(data, oldData, FMath::Min(newMax, currentNum) * numBytesPerElement);
+        }
+
+        FORCEINLINE SizeType CalculateSlackReserve(SizeType newMax, SIZE_T numBytesPerElement) const {
+            return DefaultCalculateSlackReserve(newMax, numBytesPerElement, false, Alignment);
+        }
+        FORCEINLINE SizeType CalculateSlackShrink(SizeType newMax, SizeType currentMax, SIZE_T numBytesPerElement) const {
+            return DefaultCalculateSlackShrink(newMax, currentMax, numBytesPerElement, false, Alignment);
+        }
+        FORCEINLINE SizeType CalculateSlackGrow(SizeType newMax, SizeType currentMax, SIZE_T numBytesPerElement) const {
+            return DefaultCalculateSlackGrow(newMax, currentMax, numBytesPerElement, false, Alignment);
+        }
+
+        SIZE_T GetAllocatedSize(SizeType currentMax, SIZE_T numBytesPerElement) const { return currentMax * numBytesPerElement; }
+        bool HasAllocation() const { return !!data; }
+        SizeType GetInitialCapacity() const { return 0; }
+
+    private:
+        ElementType* data;
+    };
+
+    typedef void ForAnyElementType;
+};
+
+template<uint32 Alignment>
+struct TAllocatorTraits<TVoxelFrameAllocator<Alignment>> : TAllocatorTraitsBase<TVoxelFrameAllocator<Alignment>> {
+    enum { IsZeroConstruct = true };
+};
+
+template<typename ElementType>
+using TVoxelFrameArray = TArray<ElementType, TVoxelFrameAllocator<>>;
+
+template<typename ElementType>
+using TVoxelFrameSet = TSet<ElementType, DefaultKeyFuncs<ElementType>,
+    TSetAllocator<TSparseArrayAllocator<TVoxelFrameAllocator<>, TVoxelFrameAllocator<>>, TVoxelFrameAllocator<>>>;
@@ -9,33 +9,71 @@
 #include "VoxelSceneViewExtension.h"
 #include "NiagaraFunctionLibrary.h"
 #include "NiagaraSystem.h"
+#include "Tasks/Task.h"
+#include "VoxelFrameArena.h"
 #include "VoxelMeshComponent.generated.h"
 
 static const float isoLevel = 0.5f;
 class FPrimitiveSceneProxy;
+class UStaticMesh;
+
+UENUM(BlueprintType)
+enum class EVoxelLODSelector : uint8 {
+    ViewRay,            // Refine nodes hit by a viewDistance long ray from the camera towards them
+    ScreenSpaceError    // Refine nodes whose projected voxel size exceeds a pixel threshold
+};
+
+UENUM(BlueprintType)
+enum class EVoxelBrushShape : uint8 {
+    Sphere,
+    Box,
+    Capsule,
+    Cylinder,
+    Torus,
+    Mesh                // The SDF volume of the last mesh given to SetMeshVolume, scaled to the brush radius
+};
+
+UENUM(BlueprintType)
+enum class EVoxelBrushTool : uint8 {
+    Sculpt,             // Left mouse carves, right mouse adds
+    Smooth,
+    Flatten
+};
 
 class Palette {
 public:
     Palette(float inMaxRadius, float inMaxPower, int inMaxType) : 
         brushRadius(30.0f), maxRadius(inMaxRadius), 
         brushPower(0.5f), maxBrushPower(inMaxPower), 
-        paintType(1), maxTypes(inMaxType) {}
+        paintType(1), maxTypes(inMaxType), brushShape(EVoxelBrushShape::Sphere), brushTool(EVoxelBrushTool::Sculpt) {}
 
-    void SetBrushRadius(float inRadius) { brushRadius = FMath::Clamp(inRadius, 0.0f, maxRadius); }
+    void SetBrushRadius(float inRadius) { brushRadius = FMath::Clamp(inRadius, 0.0f, maxRadius); RefreshShapeBrush(); }
+    void SetBrushShape(EVoxelBrushShape inShape) { brushShape = inShape; RefreshShapeBrush(); }
+    void SetMeshVolume(TSharedPtr<const VoxelSDFVolume> inVolume) { meshVolume = inVolume; RefreshShapeBrush(); }
+    void SetBrushTool(EVoxelBrushTool inTool) { brushTool = inTool; }
+    EVoxelBrushTool GetBrushTool() const { return brushTool; }
     void SetPaintType(int inType) { paintType = FMath::Clamp(inType, 0.0f, maxTypes); }
     void SetBrushPower(float inPower) { brushPower = FMath::Clamp(inPower, 0.0f, maxBrushPower); }
 
     float GetBrushPower() const { return brushPower; }
     float GetBrushRadius() const { return brushRadius; }
     int GetPaintType() const { return paintType; }
+    // Null for the sphere, which keeps the sphere and swept capsule edit path
+    const TSharedPtr<const VoxelSDFBrush>& GetShapeBrush() const { return shapeBrush; }
 
 protected:
+    void RefreshShapeBrush();
+
     float brushRadius;
     float maxRadius; 
     float brushPower;
     float maxBrushPower;
     int paintType;
     int maxTypes;
+    EVoxelBrushShape brushShape;
+    EVoxelBrushTool brushTool;
+    TSharedPtr<const VoxelSDFVolume> meshVolume;
+    TSharedPtr<const VoxelSDFBrush> shapeBrush;
 };
 
 
@@ -73,9 +111,37 @@ public:
     void SetBrushDensity(float density) { if (palette) palette->SetBrushPower(density);}
     void SetBrushRadius(float radius) { if (palette) palette->SetBrushRadius(radius);}
     void SetPaintType(int type) { if (palette) palette->SetPaintType(type);}
-    void ToggleLODState() { usePlayerLOD = !usePlayerLOD; }
-    void UpdateSceneProxyNodes(const TArray<FVoxelProxyUpdateDataNode> updateNodes);
-    void SetVisibleDistance(float inVisibleDistance) { viewDistance = inVisibleDistance; }
+    void SetBrushShape(EVoxelBrushShape shape) { if (palette) palette->SetBrushShape(shape); }
+    void SetBrushTool(EVoxelBrushTool tool) { if (palette) palette->SetBrushTool(tool); }
+    void SetBrushMesh(UStaticMesh* mesh, int32 resolution);
+    void ToggleLODState() { usePlayerLOD = !usePlayerLOD; InvalidateLODCut(); }
+    void UpdateSceneProxyNodes(const TSharedPtr<const FVoxelProxyNodeDiff>& diff);
+    void SetVisibleDistance(float inVisibleDistance) { viewDistance = inVisibleDistance; InvalidateLODCut(); }
+    void SetLODSelector(EVoxelLODSelector inSelector, float inErrorThreshold) { lodSelector = inSelector; screenSpaceErrorThreshold = inErrorThreshold; InvalidateLODCut(); }
+    // Overrides the band of each depth given, index 0 is the root, depths past the end keep their band
+    void SetLODHysteresis(const TArray<float>& inHysteresisPerDepth);
+    // The finest depth gets inHysteresis, coarser depths a wider band
+    void SetLODHysteresis(float inHysteresis);
+    void InvalidateLODCut() { bLODCutValid = false; lodParamsVersion++; }
+    void BenchmarkLODSelection(int32 iterations);
+#if WITH_DEV_AUTOMATION_TESTS
+    struct TickAllocationCheck {
+        int32 forcedNodes = 0;
+        int32 remeshed = 0;
+        uint32 allocations = 0;
+    };
+    // Heap allocations of a warm render data update with surface nodes forced stale, false without a scene proxy
+    bool CheckTickAllocations(TickAllocationCheck& outCheck);
+#endif
+    void BenchmarkBuild(int32 iterations);
+    void BenchmarkBrush(TConstArrayView<float> radii, int32 iterations) { if (tree) tree->BenchmarkBrushKernel(radii, iterations); }
+    void BenchmarkSmooth(TConstArrayView<float> radii, int32 iterations) { if (tree) tree->BenchmarkFilterKernel(radii, iterations); }
+    void BenchmarkConnectivity(TConstArrayView<float> radii, int32 iterations) { if (tree) tree->BenchmarkConnectivity(radii, iterations); }
+    const TArray<uint32>& GetSelectedNodesPerDepth() const { return selectedNodesPerDepth; }
+    void SetResidencyBudget(uint64 budgetBytes, uint32 graceFrames) { if (tree) tree->SetResidencyBudget(budgetBytes, graceFrames); }
+    // Safe from any thread, queued edits are applied together at the start of the next voxel update
+    void EnqueueEdit(const VoxelEditCommand& command) { editQueue.Push(command); }
+    VoxelEditCommand MakeBrushEdit(EVoxelEditOp op, const FVector& position) const;
 private:
     UPROPERTY(Transient)
     TObjectPtr<UMaterialInterface> Material;
@@ -87,17 +153,30 @@ protected:
     virtual void BeginPlay() override;
     virtual void BeginDestroy() override;
     virtual void OnRegister() override;
-    void GetVisibleNodes(TArray<OctreeNode*>& nodes, OctreeNode* node);
+    bool BuildLODView(VoxelLODView& outView);
+    bool IsLODCutStale(const VoxelLODView& view) const;
+    bool UpdateLODCut(const VoxelLODView& view);
+    VoxelLODSelectionInput MakeLODSelectionInput(const VoxelLODView& view);
+    void PublishLODSelection(const TSharedPtr<VoxelLODSelectionResult>& result, const VoxelLODView& view, uint32 editVersion, uint32 paramsVersion);
+    void FinishLODCut(const VoxelLODView& view, uint32 editVersion, uint32 paramsVersion);
+    void GetVisibleNodes(TArray<OctreeNode*>& nodes, const VoxelLODView& view);
+    bool ShouldRefineNode(OctreeNode* node, const VoxelLODView& view);
     void InvokeVoxelRenderPasses();
+    void UpdateRenderData();
+    void ApplyStressEdits(int32 editCount);
+    void ApplyQueuedEdits();
     void CheckVoxelMining();
+    void LaunchMeshVolumeBuild(UStaticMesh* mesh, int32 resolution);
+    void FinishMeshVolumeBuild();
+    void UseMeshVolume(const TSharedPtr<const VoxelSDFVolume>& volume);
+    void AdvanceStroke(VoxelEditStroke& stroke, VoxelEditCommand command);
     void RotateAroundAxis(FVector axis, float degreeTick);
     void SetRenderDataLOD();
-    void InvokeVoxelRenderer(TArray<FVoxelComputeUpdateNodeData>& updateData, TArray<FVoxelTransVoxelNodeData>& transVoxelUpdateData, const TArray<FVoxelProxyUpdateDataNode> updateNodes);
+    void InvokeVoxelRenderer(const TVoxelFrameArray<FVoxelComputeUpdateNodeData>& updateData, const TVoxelFrameArray<FVoxelTransVoxelNodeData>& transVoxelUpdateData, const TSharedPtr<FVoxelProxyNodeDiff>& proxyDiff);
+    void BuildProxyNodeDiff(const TVoxelFrameArray<OctreeNode*>& surfaceNodes, FVoxelProxyNodeDiff& outDiff);
+    float GetRemeshPriority(OctreeNode* node, const VoxelLODView& view) const;
     void TraverseAndDraw();
     void SetNodeVisible(TArray<OctreeNode*>& nodes, OctreeNode* node);
-    void SetChildrenVisible(TArray<OctreeNode*>& pushStack, OctreeNode* node, int currentDepth, int targetDepth);
-    bool BalanceNode(TArray<OctreeNode*>& removalStack, TArray<OctreeNode*>& pushStack, TArray<OctreeNode*>& visibleNodes, OctreeNode* node);
-    void BalanceVisibleNodes(TArray<OctreeNode*>&visibleNodes);
     void CheckRotation(float deltaTime);
     void InitMaterial();
 
@@ -108,6 +187,73 @@ protected:
     UNiagaraSystem* vfxSystem;
 
     float viewDistance;
+    EVoxelLODSelector lodSelector;
+    float screenSpaceErrorThreshold;
+    TArray<float> lodHysteresisPerDepth;
+    // Handed to every selection by reference, rebuilt from lodHysteresisPerDepth after it changes
+    TSharedPtr<const TArray<float>> lodHysteresisShared;
+    TArray<uint32> selectedNodesPerDepth;
+
+    // The balanced cut from the last selection, reused until the camera moves far enough in octree local space
+    TArray<OctreeNode*> cachedVisibleNodes;
+    VoxelLODView cachedLODView;
+    float cachedFinestNodeSize;
+    uint32 cachedEditVersion;
+    bool bLODCutValid;
+    uint32 lodParamsVersion;
+
+    // Selection launched last frame and the state it was launched with, published at the start of the next one
+    UE::Tasks::FTask lodTask;
+    TSharedPtr<VoxelLODSelectionResult> lodTaskResult;
+    VoxelLODView lodTaskView;
+    uint32 lodTaskEditVersion;
+    uint32 lodTaskParamsVersion;
+    // The last published selection, the next selection's hysteresis reads its refinement decisions
+    TSharedPtr<const VoxelLODSelectionResult> lodPublishedResult;
+    TArray<TSharedPtr<VoxelLODSelectionResult>> lodResultPool;
+
+    // What the scene proxy was last told to draw per node index, diffed against the surface nodes every update.
+    // Retained nodes left the cut but are drawn until the queued nodes covering them are meshed. Every node held
+    // here is pinned in the tree, so residency never takes the resources of a node the proxy draws.
+    struct ProxyNodeState {
+        uint32 meshedVersion;
+        VoxelRenderHandle renderResources;
+    };
+    TMap<int32, ProxyNodeState> proxyNodeStates;
+    bool bProxyResync;
+
+    // Diffs and dispatches are held by render commands past the tick, so rather than the frame arena they come from
+    // pools refilled once the render thread has let go of them
+    TArray<TSharedPtr<FVoxelProxyNodeDiff>> proxyDiffPool;
+    TArray<TSharedPtr<FMarchingCubesDispatchParams>> dispatchParamsPool;
+
+    // Visible nodes whose mesh is out of date, a max heap on priority. Whatever the frame budget leaves in it is
+    // rebuilt with fresh priorities next frame.
+    struct RemeshJob {
+        OctreeNode* node;
+        float priority;
+    };
+    TArray<RemeshJob> remeshQueue;
+
+    VoxelEditQueue editQueue;
+    TArray<VoxelEditCommand> editBatch;
+    TArray<VoxelDetachedChunk> detachedChunks;
+    VoxelEditStroke miningStroke;
+    VoxelEditStroke eraserStroke;
+    // Mesh brush volumes are slow to build, so each mesh is built once per resolution
+    TMap<TPair<TObjectKey<UStaticMesh>, int32>, TSharedPtr<const VoxelSDFVolume>> meshVolumes;
+    // The volume SetBrushMesh is waiting on, taken up by the first tick after its task completes
+    struct MeshVolumeBuild {
+        UE::Tasks::TTask<TSharedPtr<const VoxelSDFVolume>> task;
+        TPair<TObjectKey<UStaticMesh>, int32> key;
+        FString meshName;
+        int32 triangleCount = 0;
+        double startSeconds = 0.0;
+    };
+    MeshVolumeBuild pendingMeshVolume;
+
+    // Backs the per tick node lists and sets, rewound at the start of every render pass tick
+    FVoxelFrameArena frameArena;
     bool rotatePlanet;
     bool debugNodes;
     bool usePlayerLOD;